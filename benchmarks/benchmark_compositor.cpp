@@ -0,0 +1,568 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/graphics/offscreen/display.h"
+#include "src/server/compositor/default_display_buffer_compositor_factory.h"
+#include "src/server/compositor/stream.h"
+#include "src/server/scene/surface_stack.h"
+#include "src/server/scene/basic_surface.h"
+#include "src/server/report/null_report_factory.h"
+#include "src/renderers/gl/renderer_factory.h"
+
+#include "mir/compositor/display_buffer_compositor.h"
+#include "mir/graphics/buffer_basic.h"
+#include "mir/graphics/damage_source.h"
+#include "mir/graphics/default_display_configuration_policy.h"
+#include "mir/graphics/display_buffer.h"
+#include "mir/graphics/gl_format.h"
+#include "mir/graphics/program.h"
+#include "mir/graphics/program_factory.h"
+#include "mir/graphics/texture.h"
+#include "mir/logging/logger.h"
+#include "mir/renderer/gl/sub_texture_source.h"
+#include "mir/renderer/gl/texture_source.h"
+
+#include <boost/program_options.hpp>
+
+#include MIR_SERVER_GL_H
+#include MIR_SERVER_GLEXT_H
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <experimental/optional>
+#include <iostream>
+#include <new>
+#include <vector>
+
+namespace mc = mir::compositor;
+namespace mg = mir::graphics;
+namespace mgo = mir::graphics::offscreen;
+namespace ms = mir::scene;
+namespace mr = mir::report;
+namespace geom = mir::geometry;
+namespace po = boost::program_options;
+
+namespace
+{
+std::atomic<bool> counting_allocations{false};
+std::atomic<long> allocations{0};
+std::atomic<long> uploaded_pixels{0};
+}
+
+// Counts every thread's allocations, but only while compositing
+void* operator new(std::size_t size)
+{
+    if (counting_allocations.load(std::memory_order_relaxed))
+        allocations.fetch_add(1, std::memory_order_relaxed);
+
+    if (auto const block = std::malloc(size ? size : 1))
+        return block;
+
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* block) noexcept
+{
+    std::free(block);
+}
+
+void operator delete(void* block, std::size_t) noexcept
+{
+    std::free(block);
+}
+
+namespace
+{
+/// Keeps stdout for the results
+class StderrLogger : public mir::logging::Logger
+{
+public:
+    void log(mir::logging::Severity, std::string const& message, std::string const& component) override
+    {
+        std::cerr << component << ": " << message << std::endl;
+    }
+};
+
+MirPixelFormat format_for(float alpha)
+{
+    return alpha < 1.0f ? mir_pixel_format_abgr_8888 : mir_pixel_format_xbgr_8888;
+}
+
+/// Whether glTexSubImage2D() can skip over the unchanged part of each row
+bool unpack_row_length_supported()
+{
+#ifdef GL_UNPACK_ROW_LENGTH
+    return true;
+#else
+    auto const extensions = reinterpret_cast<char const*>(glGetString(GL_EXTENSIONS));
+    auto const version = reinterpret_cast<char const*>(glGetString(GL_VERSION));
+    return (extensions && strstr(extensions, "GL_EXT_unpack_subimage")) ||
+           (version && strncmp(version, "OpenGL ES 3", 11) == 0);
+#endif
+}
+
+#ifdef GL_UNPACK_ROW_LENGTH
+GLenum const unpack_row_length = GL_UNPACK_ROW_LENGTH;
+#else
+GLenum const unpack_row_length = GL_UNPACK_ROW_LENGTH_EXT;
+#endif
+
+/// Like a wl_shm buffer: pixels in client memory that the renderer uploads, in whole or
+/// (when it knows what changed since the last buffer it saw) just the damaged areas
+class ShmBuffer :
+    public mg::BufferBasic,
+    public mg::NativeBufferBase,
+    public mir::renderer::gl::TextureSource,
+    public mir::renderer::gl::SubTextureSource,
+    public mg::DamageSource
+{
+public:
+    ShmBuffer(geom::Size size, MirPixelFormat format) :
+        size_{size}, format{format}, pixels(size.width.as_uint32_t() * size.height.as_uint32_t())
+    {
+    }
+
+    void draw(uint32_t colour, geom::Rectangle const& area)
+    {
+        auto const clipped = area.intersection_with({{0, 0}, size_});
+        auto const width = size_.width.as_int();
+        for (auto y = clipped.top_left.y.as_int(); y != clipped.bottom().as_int(); ++y)
+        {
+            auto const row = pixels.begin() + y * width;
+            std::fill(row + clipped.left().as_int(), row + clipped.right().as_int(), colour);
+        }
+    }
+
+    /// Records what changed since the buffer the client submitted before this one
+    void set_damage(mg::BufferID base, std::vector<geom::Rectangle> const& areas)
+    {
+        damage_base = base;
+        damage = areas;
+    }
+
+    std::shared_ptr<mg::NativeBuffer> native_buffer_handle() const override { return {}; }
+    geom::Size size() const override { return size_; }
+    MirPixelFormat pixel_format() const override { return format; }
+    mg::NativeBufferBase* native_buffer_base() override { return this; }
+
+    void gl_bind_to_texture() override
+    {
+        bind();
+        secure_for_render();
+    }
+
+    void bind() override
+    {
+        GLenum gl_format, type;
+        if (mg::get_gl_pixel_format(format, gl_format, type))
+        {
+            glTexImage2D(GL_TEXTURE_2D, 0, gl_format,
+                         size_.width.as_int(), size_.height.as_int(),
+                         0, gl_format, type, pixels.data());
+            uploaded_pixels.fetch_add(size_.width.as_int() * size_.height.as_int(), std::memory_order_relaxed);
+        }
+    }
+
+    void secure_for_render() override {}
+
+    void upload_areas(std::vector<geom::Rectangle> const& areas) override
+    {
+        GLenum gl_format, type;
+        if (!mg::get_gl_pixel_format(format, gl_format, type))
+            return;
+
+        auto const width = size_.width.as_int();
+        auto const full_rows_only = !unpack_row_length_supported();
+        if (!full_rows_only)
+            glPixelStorei(unpack_row_length, width);
+
+        for (auto const& area : areas)
+        {
+            auto upload = area.intersection_with({{0, 0}, size_});
+
+            // Without GL_UNPACK_ROW_LENGTH we can only express contiguous runs of whole rows
+            if (full_rows_only)
+                upload = geom::Rectangle{{0, upload.top_left.y}, {size_.width, upload.size.height}};
+
+            if (upload.size.width.as_int() <= 0 || upload.size.height.as_int() <= 0)
+                continue;
+
+            auto const x = upload.top_left.x.as_int();
+            auto const y = upload.top_left.y.as_int();
+            glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, upload.size.width.as_int(), upload.size.height.as_int(),
+                            gl_format, type, pixels.data() + y * width + x);
+            uploaded_pixels.fetch_add(
+                upload.size.width.as_int() * upload.size.height.as_int(), std::memory_order_relaxed);
+        }
+
+        if (!full_rows_only)
+            glPixelStorei(unpack_row_length, 0);
+    }
+
+    std::vector<geom::Rectangle> const* damage_since(mg::BufferID previous) const override
+    {
+        if (damage_base && damage_base.value() == previous)
+            return &damage;
+
+        return nullptr;
+    }
+
+private:
+    geom::Size const size_;
+    MirPixelFormat const format;
+    std::vector<uint32_t> pixels;
+    std::experimental::optional<mg::BufferID> damage_base;
+    std::vector<geom::Rectangle> damage;
+};
+
+/// Like an EGL client's buffer: a texture that is already resident, so costs nothing to upload
+class EGLBuffer : public mg::BufferBasic, public mg::NativeBufferBase, public mg::gl::Texture
+{
+public:
+    EGLBuffer(geom::Size size, MirPixelFormat format, uint32_t colour) :
+        size_{size}, format{format}, colour{colour}
+    {
+    }
+
+    ~EGLBuffer()
+    {
+        if (tex_id)
+            glDeleteTextures(1, &tex_id);
+    }
+
+    std::shared_ptr<mg::NativeBuffer> native_buffer_handle() const override { return {}; }
+    geom::Size size() const override { return size_; }
+    MirPixelFormat pixel_format() const override { return format; }
+    mg::NativeBufferBase* native_buffer_base() override { return this; }
+
+    mg::gl::Program const& shader(mg::gl::ProgramFactory& factory) const override
+    {
+        static auto const program = factory.compile_fragment_shader(
+            "",
+            "uniform sampler2D tex;\n"
+            "vec4 sample_to_rgba(in vec2 texcoord)\n"
+            "{\n"
+            "    return texture2D(tex, texcoord);\n"
+            "}\n");
+
+        return *program;
+    }
+
+    Layout layout() const override { return Layout::GL; }
+
+    void bind() override
+    {
+        // The "client" renders once, the first time the compositor needs it
+        bool const needs_initialisation = tex_id == 0;
+        if (needs_initialisation)
+            glGenTextures(1, &tex_id);
+
+        glBindTexture(GL_TEXTURE_2D, tex_id);
+
+        if (needs_initialisation)
+        {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+            GLenum gl_format, type;
+            if (mg::get_gl_pixel_format(format, gl_format, type))
+            {
+                std::vector<uint32_t> const pixels(size_.width.as_uint32_t() * size_.height.as_uint32_t(), colour);
+                glTexImage2D(GL_TEXTURE_2D, 0, gl_format,
+                             size_.width.as_int(), size_.height.as_int(),
+                             0, gl_format, type, pixels.data());
+            }
+        }
+    }
+
+    void add_syncpoint() override {}
+
+private:
+    geom::Size const size_;
+    MirPixelFormat const format;
+    uint32_t const colour;
+    GLuint tex_id{0};
+};
+
+/// A surface whose client submits a new buffer from a ring of three at a fixed rate
+class SyntheticClient
+{
+public:
+    /// An shm client redraws a band covering the fraction damage of its surface for each new buffer
+    SyntheticClient(bool egl, geom::Rectangle const& placement, float alpha, float damage, ms::SurfaceStack& stack) :
+        stream{std::make_shared<mc::Stream>(placement.size, format_for(alpha))},
+        surface{std::make_shared<ms::BasicSurface>(
+            std::string(egl ? "egl client" : "shm client"),
+            placement,
+            mir_pointer_unconfined,
+            std::list<ms::StreamInfo>{{stream, {}, {}}},
+            std::shared_ptr<mg::CursorImage>(),
+            mr::null_scene_report())},
+        size{placement.size},
+        band_height{std::max(1, static_cast<int>(placement.size.height.as_int() * damage))}
+    {
+        for (uint32_t i = 0; i != 3; ++i)
+        {
+            uint32_t const colour = 0x40000000 | (0x3f << (8 * i));
+            if (egl)
+            {
+                buffers.push_back(std::make_shared<EGLBuffer>(placement.size, format_for(alpha), colour));
+            }
+            else
+            {
+                auto const buffer = std::make_shared<ShmBuffer>(placement.size, format_for(alpha));
+                buffer->draw(colour, {{0, 0}, placement.size});
+                shm_buffers.push_back(buffer);
+                buffers.push_back(buffer);
+            }
+        }
+
+        surface->set_alpha(alpha);
+        stack.add_surface(surface, mir::input::InputReceptionMode::normal);
+        update();
+    }
+
+    void update()
+    {
+        auto const previous = buffers[next]->id();
+        next = (next + 1) % buffers.size();
+
+        // An shm client redraws on the CPU; an EGL client's rendering isn't ours to measure
+        if (!shm_buffers.empty())
+        {
+            // The band moves down the surface, wrapping round at the bottom
+            auto const rows = size.height.as_int();
+            geom::Rectangle const band{{0, (frames * band_height) % rows}, {size.width, band_height}};
+            uint32_t const colour = 0x40000000 | (frames++ & 0xffffff);
+
+            // The buffer last held what was submitted a ring ago, so what changed since then needs redrawing
+            recent_bands.push_back(band);
+            if (recent_bands.size() > buffers.size())
+                recent_bands.pop_front();
+            for (auto const& area : recent_bands)
+                shm_buffers[next]->draw(colour, area);
+
+            shm_buffers[next]->set_damage(previous, {band});
+        }
+
+        stream->submit_buffer(buffers[next]);
+    }
+
+private:
+    std::shared_ptr<mc::Stream> const stream;
+    std::shared_ptr<ms::BasicSurface> const surface;
+    std::vector<std::shared_ptr<mg::Buffer>> buffers;
+    std::vector<std::shared_ptr<ShmBuffer>> shm_buffers;
+    geom::Size const size;
+    int const band_height;
+    std::deque<geom::Rectangle> recent_bands;
+    std::size_t next{0};
+    uint32_t frames{0};
+};
+
+std::chrono::nanoseconds cpu_time()
+{
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec};
+}
+}
+
+int main(int argc, char* argv[])
+try
+{
+    int shm_clients{8};
+    int egl_clients{0};
+    int width{320};
+    int height{240};
+    float overlap{0.25f};
+    float alpha{1.0f};
+    float damage{0.25f};
+    float update_rate{60.0f};
+    int frames{600};
+    int warmup_frames{30};
+
+    po::options_description desc(
+        "Composites synthetic clients to an offscreen display and reports the compositor's throughput");
+    desc.add_options()
+        ("help,h", "displays this message")
+        ("shm-clients", po::value<int>(&shm_clients)->default_value(shm_clients), "clients whose buffers are uploaded")
+        ("egl-clients", po::value<int>(&egl_clients)->default_value(egl_clients), "clients whose buffers are textures")
+        ("width", po::value<int>(&width)->default_value(width), "width of each client's surface")
+        ("height", po::value<int>(&height)->default_value(height), "height of each client's surface")
+        ("overlap", po::value<float>(&overlap)->default_value(overlap), "fraction of each surface its neighbours cover [0,1]")
+        ("alpha", po::value<float>(&alpha)->default_value(alpha), "surface opacity; below 1 surfaces are blended")
+        ("damage", po::value<float>(&damage)->default_value(damage),
+            "fraction (0,1] of each shm surface its client redraws for each new buffer")
+        ("update-rate", po::value<float>(&update_rate)->default_value(update_rate),
+            "new buffers per second from each client (frames are composited at 60Hz)")
+        ("frames", po::value<int>(&frames)->default_value(frames), "frames to measure")
+        ("warmup-frames", po::value<int>(&warmup_frames)->default_value(warmup_frames), "frames to composite first")
+        ("json", "print the results as a single JSON object, for tracking regressions");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help"))
+    {
+        std::cout << desc << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    if (shm_clients < 0 || egl_clients < 0 || width <= 0 || height <= 0 || frames <= 0 || warmup_frames < 0 ||
+        overlap < 0.0f || overlap > 1.0f || alpha < 0.0f || alpha > 1.0f || damage <= 0.0f || damage > 1.0f ||
+        update_rate < 0.0f)
+    {
+        std::cerr << desc << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    mir::logging::set_logger(std::make_shared<StderrLogger>());
+
+    // Render with Mesa's software rasteriser unless told otherwise: CI has no GPU
+    setenv("EGL_PLATFORM", "surfaceless", 0);
+    setenv("LIBGL_ALWAYS_SOFTWARE", "1", 0);
+
+    auto const display = std::make_shared<mgo::Display>(
+        EGL_DEFAULT_DISPLAY,
+        std::make_shared<mg::CloneDisplayConfigurationPolicy>(),
+        mr::null_display_report());
+
+    mg::DisplaySyncGroup* group{nullptr};
+    mg::DisplayBuffer* display_buffer{nullptr};
+    display->for_each_display_sync_group([&](mg::DisplaySyncGroup& g)
+        {
+            group = &g;
+            g.for_each_display_buffer([&](mg::DisplayBuffer& db) { display_buffer = &db; });
+        });
+
+    mc::DefaultDisplayBufferCompositorFactory compositor_factory{
+        std::make_shared<mir::renderer::gl::RendererFactory>(),
+        mr::null_compositor_report()};
+    auto const compositor = compositor_factory.create_compositor_for(*display_buffer);
+    std::string const gl_renderer{reinterpret_cast<char const*>(glGetString(GL_RENDERER))};
+
+    ms::SurfaceStack stack{mr::null_scene_report()};
+    stack.register_compositor(compositor.get());
+
+    // Tile the surfaces across the display, each covering 'overlap' of the last
+    auto const area = display_buffer->view_area();
+    int const step_x = std::max(1, static_cast<int>(width * (1.0f - overlap)));
+    int const step_y = std::max(1, static_cast<int>(height * (1.0f - overlap)));
+    int const columns = std::max(1, (area.size.width.as_int() - width) / step_x + 1);
+    int const rows = std::max(1, (area.size.height.as_int() - height) / step_y + 1);
+
+    std::vector<std::unique_ptr<SyntheticClient>> clients;
+    for (int i = 0; i != shm_clients + egl_clients; ++i)
+    {
+        geom::Rectangle const placement{
+            {area.top_left.x.as_int() + (i % columns) * step_x, area.top_left.y.as_int() + (i / columns % rows) * step_y},
+            {width, height}};
+        clients.push_back(std::make_unique<SyntheticClient>(i >= shm_clients, placement, alpha, damage, stack));
+    }
+
+    // Frames are on a virtual 60Hz timeline so that runs are repeatable
+    auto const update_clients = [&](int frame)
+        {
+            if (frame > 0 && static_cast<int>(frame * update_rate / 60) != static_cast<int>((frame - 1) * update_rate / 60))
+            {
+                for (auto const& client : clients)
+                    client->update();
+            }
+        };
+
+    for (int frame = 0; frame != warmup_frames; ++frame)
+    {
+        update_clients(frame);
+        compositor->composite(stack.scene_elements_for(compositor.get()));
+        group->post();
+    }
+
+    std::chrono::nanoseconds busy{0};
+    std::chrono::nanoseconds busy_cpu{0};
+    long frame_allocations{0};
+    long frame_uploaded_pixels{0};
+    for (int frame = warmup_frames; frame != warmup_frames + frames; ++frame)
+    {
+        update_clients(frame);
+
+        auto const cpu_before_frame = cpu_time();
+        auto const start = std::chrono::steady_clock::now();
+        allocations = 0;
+        uploaded_pixels = 0;
+        counting_allocations = true;
+
+        compositor->composite(stack.scene_elements_for(compositor.get()));
+        group->post();
+
+        counting_allocations = false;
+        busy += std::chrono::steady_clock::now() - start;
+        frame_allocations += allocations;
+        frame_uploaded_pixels += uploaded_pixels;
+        busy_cpu += cpu_time() - cpu_before_frame;
+    }
+    stack.unregister_compositor(compositor.get());
+
+    double const seconds = std::chrono::duration<double>(busy).count();
+    double const frames_per_second = frames / seconds;
+    double const cpu_us_per_frame = std::chrono::duration<double, std::micro>(busy_cpu).count() / frames;
+    double const allocations_per_frame = static_cast<double>(frame_allocations) / frames;
+    double const uploaded_pixels_per_frame = static_cast<double>(frame_uploaded_pixels) / frames;
+
+    if (vm.count("json"))
+    {
+        std::cout << "{"
+            << "\"renderer\": \"" << gl_renderer << "\", "
+            << "\"shm_clients\": " << shm_clients << ", "
+            << "\"egl_clients\": " << egl_clients << ", "
+            << "\"width\": " << width << ", "
+            << "\"height\": " << height << ", "
+            << "\"overlap\": " << overlap << ", "
+            << "\"alpha\": " << alpha << ", "
+            << "\"damage\": " << damage << ", "
+            << "\"update_rate\": " << update_rate << ", "
+            << "\"frames\": " << frames << ", "
+            << "\"frames_per_second\": " << frames_per_second << ", "
+            << "\"cpu_us_per_frame\": " << cpu_us_per_frame << ", "
+            << "\"allocations_per_frame\": " << allocations_per_frame << ", "
+            << "\"uploaded_pixels_per_frame\": " << uploaded_pixels_per_frame
+            << "}" << std::endl;
+    }
+    else
+    {
+        std::cout << "Renderer: " << gl_renderer << std::endl;
+        std::cout << "Composited " << frames << " frames of " << shm_clients << " shm and " << egl_clients
+                  << " EGL clients (" << width << "x" << height << ", " << overlap * 100 << "% overlap, alpha "
+                  << alpha << ", " << damage * 100 << "% damage, " << update_rate << " updates/s)" << std::endl;
+        std::cout << "  " << frames_per_second << " frames/s" << std::endl;
+        std::cout << "  " << cpu_us_per_frame << " us CPU time/frame" << std::endl;
+        std::cout << "  " << allocations_per_frame << " allocations/frame" << std::endl;
+        std::cout << "  " << uploaded_pixels_per_frame << " pixels uploaded/frame" << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
+catch (std::exception const& e)
+{
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
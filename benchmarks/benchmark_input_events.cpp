@@ -0,0 +1,112 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/input/default_event_builder.h"
+#include "src/server/input/surface_input_dispatcher.h"
+#include "mir/input/scene.h"
+#include "mir/input/surface.h"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+namespace mi = mir::input;
+namespace geom = mir::geometry;
+
+namespace
+{
+struct StubSurface : mi::Surface
+{
+    StubSurface(geom::Rectangle const& bounds) : bounds{bounds} {}
+
+    std::string name() const override { return {}; }
+    geom::Rectangle input_bounds() const override { return bounds; }
+    bool input_area_contains(geom::Point const& point) const override { return bounds.contains(point); }
+    std::shared_ptr<mir::graphics::CursorImage> cursor_image() const override { return {}; }
+    mi::InputReceptionMode reception_mode() const override { return mi::InputReceptionMode::normal; }
+    void consume(MirEvent const*) override { ++consumed; }
+
+    geom::Rectangle const bounds;
+    int consumed{0};
+};
+
+struct StubScene : mi::Scene
+{
+    void for_each(std::function<void(std::shared_ptr<mi::Surface> const&)> const& callback) override
+    {
+        for (auto const& surface : surfaces)
+            callback(surface);
+    }
+
+    void add_observer(std::shared_ptr<mir::scene::Observer> const&) override {}
+    void remove_observer(std::weak_ptr<mir::scene::Observer> const&) override {}
+    void add_input_visualization(std::shared_ptr<mir::graphics::Renderable> const&) override {}
+    void remove_input_visualization(std::weak_ptr<mir::graphics::Renderable> const&) override {}
+    void emit_scene_changed() override {}
+
+    std::vector<std::shared_ptr<mi::Surface>> surfaces;
+};
+
+template<typename F>
+long long events_per_second(int event_count, F f)
+{
+    auto const start = std::chrono::steady_clock::now();
+    for (int i = 0; i < event_count; ++i)
+        f(i);
+    auto const duration = std::chrono::steady_clock::now() - start;
+
+    return event_count * 1000000000LL / std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3)
+    {
+        std::cout<<"Usage: "<<argv[0]<<" <number of surfaces> <number of events>"<<std::endl;
+        exit(1);
+    }
+
+    int const surface_count = std::atoi(argv[1]);
+    int const event_count = std::atoi(argv[2]);
+
+    // A grid of tiled windows on a 1920x1080 screen
+    auto const scene = std::make_shared<StubScene>();
+    for (int i = 0; i < surface_count; ++i)
+        scene->surfaces.push_back(std::make_shared<StubSurface>(geom::Rectangle{{(i % 8) * 240, (i / 8 % 8) * 135}, {240, 135}}));
+
+    mi::DefaultEventBuilder builder{0, nullptr};
+
+    // 1kHz pointer motion wandering over the screen
+    auto const motion = [&](int i)
+        {
+            return builder.pointer_event(
+                std::chrono::milliseconds{i}, mir_pointer_action_motion, 0,
+                (i * 7) % 1920, (i * 3) % 1080, 0, 0, 7, 3);
+        };
+
+    auto const built = events_per_second(event_count, [&](int i) { motion(i); });
+
+    mi::SurfaceInputDispatcher dispatcher{scene};
+    dispatcher.start();
+    auto const dispatched = events_per_second(event_count, [&](int i) { dispatcher.dispatch(motion(i)); });
+    dispatcher.stop();
+
+    std::cout<<"Built "<<built<<" pointer events/s"<<std::endl;
+    std::cout<<"Built and dispatched to "<<surface_count<<" surfaces "<<dispatched<<" pointer events/s"<<std::endl;
+    exit(0);
+}
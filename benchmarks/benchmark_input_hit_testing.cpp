@@ -0,0 +1,111 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/input/surface_spatial_index.h"
+#include "mir/input/surface.h"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace mi = mir::input;
+namespace geom = mir::geometry;
+
+namespace
+{
+struct StubSurface : mi::Surface
+{
+    StubSurface(geom::Rectangle const& bounds) : bounds{bounds} {}
+
+    std::string name() const override { return {}; }
+    geom::Rectangle input_bounds() const override { return bounds; }
+    bool input_area_contains(geom::Point const& point) const override { return bounds.contains(point); }
+    std::shared_ptr<mir::graphics::CursorImage> cursor_image() const override { return {}; }
+    mi::InputReceptionMode reception_mode() const override { return mi::InputReceptionMode::normal; }
+    void consume(MirEvent const*) override {}
+
+    geom::Rectangle const bounds;
+};
+
+/// What SurfaceInputDispatcher did before: ask every surface, keeping the topmost
+std::shared_ptr<mi::Surface> linear_surface_at(
+    std::vector<std::shared_ptr<mi::Surface>> const& surfaces,
+    geom::Point point)
+{
+    std::shared_ptr<mi::Surface> top_target;
+    for (auto const& surface : surfaces)
+    {
+        if (surface->input_area_contains(point))
+            top_target = surface;
+    }
+    return top_target;
+}
+
+template<typename F>
+long long nanoseconds_per_query(std::vector<geom::Point> const& points, F surface_at)
+{
+    auto const start = std::chrono::steady_clock::now();
+    for (auto const& point : points)
+        surface_at(point);
+    auto const duration = std::chrono::steady_clock::now() - start;
+
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count() / points.size();
+}
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3)
+    {
+        std::cout<<"Usage: "<<argv[0]<<" <number of surfaces> <number of queries>"<<std::endl;
+        exit(1);
+    }
+
+    int const surface_count = std::atoi(argv[1]);
+    int const query_count = std::atoi(argv[2]);
+
+    // Windows of assorted sizes scattered over a 4K screen
+    std::mt19937 random{42};
+    std::uniform_int_distribution<int> x{0, 3839}, y{0, 2159}, size{50, 1200};
+
+    std::vector<std::shared_ptr<mi::Surface>> surfaces;
+    for (int i = 0; i < surface_count; ++i)
+        surfaces.push_back(std::make_shared<StubSurface>(geom::Rectangle{{x(random), y(random)}, {size(random), size(random)}}));
+
+    std::vector<geom::Point> points;
+    for (int i = 0; i < query_count; ++i)
+        points.push_back({x(random), y(random)});
+
+    mi::SurfaceSpatialIndex index;
+    index.restack(surfaces);
+
+    for (auto const& point : points)
+    {
+        if (index.surface_at(point) != linear_surface_at(surfaces, point))
+        {
+            std::cout<<"Mismatch at "<<point<<std::endl;
+            exit(1);
+        }
+    }
+
+    auto const linear = nanoseconds_per_query(points, [&](geom::Point p) { return linear_surface_at(surfaces, p); });
+    auto const indexed = nanoseconds_per_query(points, [&](geom::Point p) { return index.surface_at(p); });
+
+    std::cout<<"Hit testing "<<surface_count<<" surfaces: linear "<<linear<<"ns, indexed "<<indexed<<"ns per query"<<std::endl;
+    exit(0);
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_GEOMETRY_REGION_H_
+#define MIR_GEOMETRY_REGION_H_
+
+#include "mir/geometry/rectangle.h"
+
+#include <iosfwd>
+#include <vector>
+
+namespace mir
+{
+namespace geometry
+{
+
+/**
+ * An arbitrary set of pixels, such as the visible part of a window.
+ *
+ * Like a pixman region this is stored as horizontal bands, each a run of
+ * rows holding the same sorted, non-touching spans. Vertically adjacent
+ * bands always differ, so equal regions have equal representations.
+ */
+class Region
+{
+public:
+    Region();
+    Region(Rectangle const& rect);
+    Region(std::vector<Rectangle> const& rects);
+    /* We want to keep implicit copy and move methods */
+
+    bool empty() const;
+    Rectangle bounding_rectangle() const;
+    /// The region as non-overlapping rectangles, top to bottom then left to right
+    std::vector<Rectangle> rectangles() const;
+
+    bool contains(Rectangle const& rect) const;
+    bool overlaps(Rectangle const& rect) const;
+
+    Region& unite(Region const& other);
+    Region& subtract(Region const& other);
+    Region& intersect(Region const& other);
+
+    bool operator==(Region const& other) const;
+    bool operator!=(Region const& other) const;
+
+private:
+    struct Band
+    {
+        int top;
+        int bottom;
+        /// Pairs of [left, right) x coordinates
+        std::vector<int> edges;
+    };
+
+    /// Combines two sets of bands keeping the pixels for which keep(in_a, in_b) holds
+    static std::vector<Band> combine(
+        std::vector<Band> const& a,
+        std::vector<Band> const& b,
+        bool (*keep)(bool in_a, bool in_b));
+
+    std::vector<Band> bands;
+};
+
+std::ostream& operator<<(std::ostream& out, Region const& value);
+
+}
+}
+
+#endif /* MIR_GEOMETRY_REGION_H_ */
@@ -0,0 +1,58 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_GRAPHICS_DAMAGE_SOURCE_H_
+#define MIR_GRAPHICS_DAMAGE_SOURCE_H_
+
+#include "mir/graphics/buffer_id.h"
+#include "mir/geometry/rectangle.h"
+
+#include <vector>
+
+namespace mir
+{
+namespace graphics
+{
+
+/**
+ * Implemented by buffers (via Buffer::native_buffer_base()) that know which
+ * parts of their content changed relative to an earlier buffer from the
+ * same source.
+ */
+class DamageSource
+{
+public:
+    virtual ~DamageSource() = default;
+
+    /**
+     * The areas, in buffer coordinates, whose content differs from that of
+     * the buffer identified by previous.
+     *
+     * \return  nullptr if the difference is not known, in which case the whole
+     *          buffer must be treated as changed
+     */
+    virtual std::vector<geometry::Rectangle> const* damage_since(BufferID previous) const = 0;
+
+protected:
+    DamageSource() = default;
+    DamageSource(DamageSource const&) = delete;
+    DamageSource& operator=(DamageSource const&) = delete;
+};
+
+}
+}
+
+#endif /* MIR_GRAPHICS_DAMAGE_SOURCE_H_ */
@@ -20,6 +20,7 @@
 #define MIR_GRAPHICS_RENDERABLE_H_
 
 #include <mir/geometry/rectangle.h>
+#include <mir/geometry/region.h>
 #include <glm/glm.hpp>
 #include <memory>
 #include <vector>
@@ -70,6 +71,17 @@ public:
 
     virtual bool shaped() const = 0;  // meaning the pixel format has alpha
 
+    /**
+     * The part of screen_position() (in screen coordinates) that the client
+     * has promised is opaque, even though the pixel format has alpha. This
+     * may be drawn without blending, and hides anything beneath it unless
+     * alpha() makes the whole renderable translucent.
+     *
+     * Only meaningful for untransformed renderables. The default is empty:
+     * nothing is promised to be opaque beyond what shaped() implies.
+     */
+    virtual geometry::Region opaque_region() const { return {}; }
+
     virtual unsigned int swap_interval() const = 0;
 protected:
     Renderable() = default;
@@ -20,6 +20,7 @@
 #define MIR_RENDERER_RENDERER_H_
 
 #include "mir/geometry/rectangle.h"
+#include "mir/geometry/rectangles.h"
 #include "mir/graphics/renderable.h"
 #include "mir_toolkit/common.h"
 #include <glm/glm.hpp>
@@ -36,6 +37,15 @@ public:
 
     virtual void set_viewport(geometry::Rectangle const& rect) = 0;
     virtual void set_output_transform(glm::mat2 const&) = 0;
+    /**
+     * Sets the areas of the viewport that have changed since the previous
+     * frame. The next render() need only redraw these (plus whatever the
+     * renderer itself knows to be stale). If this is not called before
+     * render() the whole viewport is assumed to be damaged.
+     *
+     * The default implementation ignores the damage and redraws everything.
+     */
+    virtual void set_damage(geometry::Rectangles const& /*damage*/) {}
     virtual void render(graphics::RenderableList const&) const = 0;
     virtual void suspend() = 0; // called when render() is skipped
 
@@ -0,0 +1,57 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_RENDERER_GL_SUB_TEXTURE_SOURCE_H_
+#define MIR_RENDERER_GL_SUB_TEXTURE_SOURCE_H_
+
+#include "mir/geometry/rectangle.h"
+
+#include <vector>
+
+namespace mir
+{
+namespace renderer
+{
+namespace gl
+{
+
+/**
+ * Implemented by buffers whose content can be uploaded piecemeal into a
+ * texture that already holds an image of the same size and pixel format.
+ */
+class SubTextureSource
+{
+public:
+    virtual ~SubTextureSource() = default;
+
+    /**
+     * Uploads the given areas (in buffer coordinates) of the buffer into the
+     * texture bound to GL_TEXTURE_2D, leaving the rest of it untouched.
+     * The texture storage is not reallocated.
+     */
+    virtual void upload_areas(std::vector<geometry::Rectangle> const& areas) = 0;
+
+protected:
+    SubTextureSource() = default;
+    SubTextureSource(SubTextureSource const&) = delete;
+    SubTextureSource& operator=(SubTextureSource const&) = delete;
+};
+
+}
+}
+}
+
+#endif /* MIR_RENDERER_GL_SUB_TEXTURE_SOURCE_H_ */
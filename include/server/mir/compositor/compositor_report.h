@@ -21,6 +21,8 @@
 
 #include "mir/graphics/renderable.h"
 
+#include <chrono>
+
 namespace mir
 {
 namespace compositor
@@ -35,6 +37,10 @@ public:
     virtual void renderables_in_frame(SubCompositorId id, graphics::RenderableList const& renderables) = 0;
     virtual void rendered_frame(SubCompositorId id) = 0;
     virtual void finished_frame(SubCompositorId id) = 0;
+    /// The finished frame has been posted to the display
+    virtual void posted_frame(SubCompositorId /*id*/) {}
+    /// The frame was posted 'lateness' after the vblank it was scheduled for
+    virtual void missed_deadline(SubCompositorId /*id*/, std::chrono::nanoseconds /*lateness*/) {}
     virtual void started() = 0;
     virtual void stopped() = 0;
     virtual void scheduled() = 0;
@@ -52,6 +52,8 @@ public:
     virtual std::shared_ptr<graphics::CursorImage> cursor_image() const = 0;
     virtual InputReceptionMode reception_mode() const = 0;
     virtual void consume(MirEvent const* event) = 0;
+    /// A rectangle enclosing every point input_area_contains() may accept
+    virtual geometry::Rectangle input_area_bounds() const { return input_bounds(); }
 
 protected:
     Surface() = default;
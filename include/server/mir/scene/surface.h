@@ -41,6 +41,8 @@ struct StreamInfo
     std::shared_ptr<compositor::BufferStream> stream;
     geometry::Displacement displacement;
     optional_value<geometry::Size> size;
+    /// Areas (relative to the stream) the client guarantees to be opaque
+    std::vector<geometry::Rectangle> opaque_region{};
 };
 
 class SurfaceObserver;
@@ -63,7 +65,13 @@ public:
     /// Size of the surface including window frame (if any)
     virtual geometry::Size size() const = 0;
 
-    virtual graphics::RenderableList generate_renderables(compositor::CompositorID id) const = 0; 
+    virtual graphics::RenderableList generate_renderables(compositor::CompositorID id) const = 0;
+    /// As generate_renderables(), but appending to a list whose storage the caller reuses
+    virtual void append_renderables(compositor::CompositorID id, graphics::RenderableList& list) const
+    {
+        for (auto& renderable : generate_renderables(id))
+            list.push_back(std::move(renderable));
+    }
     virtual int buffers_ready_for_compositor(void const* compositor_id) const = 0;
 
     virtual MirWindowType type() const = 0;
@@ -25,11 +25,13 @@
 #include "mir/frontend/buffer_stream_id.h"
 #include "mir/geometry/point.h"
 #include "mir/geometry/displacement.h"
+#include "mir/geometry/rectangle.h"
 #include "mir/graphics/buffer_properties.h"
 #include "mir/graphics/display_configuration.h"
 
 #include <string>
 #include <memory>
+#include <vector>
 
 namespace mir
 {
@@ -45,6 +47,8 @@ struct StreamSpecification
     frontend::BufferStreamId stream_id;
     geometry::Displacement displacement;
     optional_value<geometry::Size> size;
+    /// Areas (relative to the stream) the client guarantees to be opaque
+    std::vector<geometry::Rectangle> opaque_region{};
 };
 
 struct StreamCursor
@@ -37,8 +37,75 @@
 #include <capnp/serialize.h>
 
 
+#include <mutex>
+#include <new>
+#include <vector>
+
 namespace ml = mir::logging;
 
+namespace
+{
+/// Spare event storage, kept to save a trip to the heap per input event
+class EventStorage
+{
+public:
+    void* allocate(std::size_t size)
+    {
+        if (size == sizeof(MirEvent))
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            if (!spare.empty())
+            {
+                auto const block = spare.back();
+                spare.pop_back();
+                return block;
+            }
+        }
+
+        return ::operator new(size);
+    }
+
+    void deallocate(void* block, std::size_t size) noexcept
+    {
+        if (size == sizeof(MirEvent))
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            if (spare.size() < max_spare)
+            {
+                spare.push_back(block);
+                return;
+            }
+        }
+
+        ::operator delete(block);
+    }
+
+private:
+    /// Enough to cover a burst of events queued for clients
+    static std::size_t const max_spare = 64;
+
+    std::mutex mutex;
+    std::vector<void*> spare = [] { std::vector<void*> v; v.reserve(max_spare); return v; }();
+};
+
+// Deliberately leaked: events may be freed during static destruction
+EventStorage& event_storage()
+{
+    static auto const storage = new EventStorage;
+    return *storage;
+}
+}
+
+void* MirEvent::operator new(std::size_t size)
+{
+    return event_storage().allocate(size);
+}
+
+void MirEvent::operator delete(void* event, std::size_t size) noexcept
+{
+    event_storage().deallocate(event, size);
+}
+
 MirEvent::MirEvent(MirEvent const& e)
 {
     auto reader = e.event.asReader();
@@ -0,0 +1,250 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mir/geometry/region.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace geom = mir::geometry;
+
+namespace
+{
+int const no_edge = std::numeric_limits<int>::max();
+
+/// Combines two sorted lists of span edges keeping x for which keep(in_a, in_b) holds
+void combine_spans(
+    std::vector<int> const& a,
+    std::vector<int> const& b,
+    bool (*keep)(bool in_a, bool in_b),
+    std::vector<int>& result)
+{
+    size_t i = 0, j = 0;
+    bool in_a = false, in_b = false, in_result = false;
+
+    while (i != a.size() || j != b.size())
+    {
+        auto const x = std::min(i != a.size() ? a[i] : no_edge, j != b.size() ? b[j] : no_edge);
+
+        // Spans never touch, so each list has at most one edge at x
+        if (i != a.size() && a[i] == x) { in_a = !in_a; ++i; }
+        if (j != b.size() && b[j] == x) { in_b = !in_b; ++j; }
+
+        if (keep(in_a, in_b) != in_result)
+        {
+            in_result = !in_result;
+            result.push_back(x);
+        }
+    }
+}
+}
+
+geom::Region::Region() = default;
+
+geom::Region::Region(Rectangle const& rect)
+{
+    if (rect.size.width.as_int() > 0 && rect.size.height.as_int() > 0)
+    {
+        bands.push_back(
+            {rect.top().as_int(), rect.bottom().as_int(), {rect.left().as_int(), rect.right().as_int()}});
+    }
+}
+
+geom::Region::Region(std::vector<Rectangle> const& rects)
+{
+    for (auto const& rect : rects)
+        unite(rect);
+}
+
+bool geom::Region::empty() const
+{
+    return bands.empty();
+}
+
+geom::Rectangle geom::Region::bounding_rectangle() const
+{
+    if (bands.empty())
+        return {};
+
+    auto left = no_edge;
+    auto right = std::numeric_limits<int>::min();
+    for (auto const& band : bands)
+    {
+        left = std::min(left, band.edges.front());
+        right = std::max(right, band.edges.back());
+    }
+
+    return {{left, bands.front().top}, {right - left, bands.back().bottom - bands.front().top}};
+}
+
+std::vector<geom::Rectangle> geom::Region::rectangles() const
+{
+    std::vector<Rectangle> result;
+    for (auto const& band : bands)
+    {
+        for (size_t i = 0; i != band.edges.size(); i += 2)
+        {
+            result.push_back(
+                {{band.edges[i], band.top}, {band.edges[i+1] - band.edges[i], band.bottom - band.top}});
+        }
+    }
+    return result;
+}
+
+bool geom::Region::contains(Rectangle const& rect) const
+{
+    auto const left = rect.left().as_int();
+    auto const right = rect.right().as_int();
+    auto const bottom = rect.bottom().as_int();
+    auto y = rect.top().as_int();
+
+    if (left >= right || y >= bottom)
+        return true;
+
+    for (auto const& band : bands)
+    {
+        if (band.bottom <= y)
+            continue;
+
+        if (band.top > y)
+            return false;   // A gap between bands
+
+        bool spanned = false;
+        for (size_t i = 0; i != band.edges.size() && band.edges[i] <= left; i += 2)
+        {
+            if (band.edges[i+1] >= right)
+            {
+                spanned = true;
+                break;
+            }
+        }
+
+        if (!spanned)
+            return false;
+
+        y = band.bottom;
+        if (y >= bottom)
+            return true;
+    }
+
+    return false;
+}
+
+bool geom::Region::overlaps(Rectangle const& rect) const
+{
+    auto const left = rect.left().as_int();
+    auto const right = rect.right().as_int();
+    auto const top = rect.top().as_int();
+    auto const bottom = rect.bottom().as_int();
+
+    for (auto const& band : bands)
+    {
+        if (band.bottom <= top)
+            continue;
+
+        if (band.top >= bottom)
+            break;
+
+        for (size_t i = 0; i != band.edges.size() && band.edges[i] < right; i += 2)
+        {
+            if (band.edges[i+1] > left)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+geom::Region& geom::Region::unite(Region const& other)
+{
+    bands = combine(bands, other.bands, [](bool in_a, bool in_b) { return in_a || in_b; });
+    return *this;
+}
+
+geom::Region& geom::Region::subtract(Region const& other)
+{
+    if (!other.bands.empty())
+        bands = combine(bands, other.bands, [](bool in_a, bool in_b) { return in_a && !in_b; });
+    return *this;
+}
+
+geom::Region& geom::Region::intersect(Region const& other)
+{
+    bands = combine(bands, other.bands, [](bool in_a, bool in_b) { return in_a && in_b; });
+    return *this;
+}
+
+bool geom::Region::operator==(Region const& other) const
+{
+    return std::equal(
+        bands.begin(), bands.end(), other.bands.begin(), other.bands.end(),
+        [](Band const& a, Band const& b)
+        {
+            return a.top == b.top && a.bottom == b.bottom && a.edges == b.edges;
+        });
+}
+
+bool geom::Region::operator!=(Region const& other) const
+{
+    return !(*this == other);
+}
+
+auto geom::Region::combine(
+    std::vector<Band> const& a,
+    std::vector<Band> const& b,
+    bool (*keep)(bool in_a, bool in_b)) -> std::vector<Band>
+{
+    static std::vector<int> const no_spans;
+
+    std::vector<Band> result;
+    std::vector<int> spans;
+    size_t i = 0, j = 0;
+    auto y = std::numeric_limits<int>::min();
+
+    // Sweep down through the rows where either input is unchanged
+    while (i != a.size() || j != b.size())
+    {
+        if (i != a.size() && a[i].bottom <= y) { ++i; continue; }
+        if (j != b.size() && b[j].bottom <= y) { ++j; continue; }
+
+        bool const in_a = i != a.size() && a[i].top <= y;
+        bool const in_b = j != b.size() && b[j].top <= y;
+
+        auto next = no_edge;
+        if (i != a.size())
+            next = std::min(next, in_a ? a[i].bottom : a[i].top);
+        if (j != b.size())
+            next = std::min(next, in_b ? b[j].bottom : b[j].top);
+
+        if (in_a || in_b)
+        {
+            spans.clear();
+            combine_spans(in_a ? a[i].edges : no_spans, in_b ? b[j].edges : no_spans, keep, spans);
+
+            if (!spans.empty())
+            {
+                if (!result.empty() && result.back().bottom == y && result.back().edges == spans)
+                    result.back().bottom = next;
+                else
+                    result.push_back({y, next, spans});
+            }
+        }
+
+        y = next;
+    }
+
+    return result;
+}
@@ -19,7 +19,9 @@
 
 #include "recently_used_cache.h"
 #include "mir/graphics/buffer.h"
+#include "mir/graphics/damage_source.h"
 #include "mir/renderer/gl/texture_source.h"
+#include "mir/renderer/gl/sub_texture_source.h"
 
 #include <stdexcept>
 #include <boost/throw_exception.hpp>
@@ -29,52 +31,203 @@ namespace mgl = mir::gl;
 namespace geom = mir::geometry;
 namespace mrgl = mir::renderer::gl;
 
+namespace
+{
+std::size_t const initial_capacity{16};
+}
+
+std::size_t mgl::RecentlyUsedCache::home_of(mg::Renderable::ID id) const
+{
+    // Renderable IDs are mostly pointers, whose low bits are all alike
+    auto const hash = reinterpret_cast<uintptr_t>(id) * uint64_t{0x9e3779b97f4a7c15};
+    return (hash >> 17) & (slots.size() - 1);
+}
+
+void mgl::RecentlyUsedCache::rehash(std::size_t capacity)
+{
+    auto old_slots = std::move(slots);
+    slots = std::vector<Slot>(capacity);
+    removed_slots = 0;
+
+    for (auto& old_slot : old_slots)
+    {
+        if (old_slot.state != SlotState::full)
+            continue;
+
+        auto i = home_of(old_slot.key);
+        while (slots[i].state == SlotState::full)
+            i = (i + 1) & (slots.size() - 1);
+
+        slots[i] = std::move(old_slot);
+    }
+}
+
+mgl::RecentlyUsedCache::Slot* mgl::RecentlyUsedCache::find_slot(mg::Renderable::ID id)
+{
+    if (!slots.empty())
+    {
+        for (auto i = home_of(id); slots[i].state != SlotState::empty; i = (i + 1) & (slots.size() - 1))
+        {
+            if (slots[i].state == SlotState::full && slots[i].key == id)
+                return &slots[i];
+        }
+    }
+
+    return nullptr;
+}
+
+mgl::RecentlyUsedCache::Entry& mgl::RecentlyUsedCache::entry_for(mg::Renderable::ID id)
+{
+    if (auto const slot = find_slot(id))
+        return slot->entry;
+
+    // Keep at least a quarter of the slots empty, so that probes stay short
+    if ((full_slots + removed_slots + 1) * 4 > slots.size() * 3)
+        rehash(slots.empty() ? initial_capacity : slots.size() * 2);
+
+    auto i = home_of(id);
+    while (slots[i].state == SlotState::full)
+        i = (i + 1) & (slots.size() - 1);
+
+    if (slots[i].state == SlotState::removed)
+        --removed_slots;
+    ++full_slots;
+
+    slots[i].state = SlotState::full;
+    slots[i].key = id;
+    slots[i].entry = Entry{};
+    return slots[i].entry;
+}
+
+void mgl::RecentlyUsedCache::mark_used(Entry& entry, mg::Renderable::ID id)
+{
+    if (entry.last_used != generation)
+    {
+        entry.last_used = generation;
+        used_now.push_back(id);
+    }
+}
+
+void mgl::RecentlyUsedCache::give_texture_to(Entry& entry, geom::Size size, MirPixelFormat format)
+{
+    for (auto spare = spare_textures.begin(); spare != spare_textures.end(); ++spare)
+    {
+        if (spare->size == size && spare->format == format)
+        {
+            entry.texture = std::move(spare->texture);
+            entry.size = size;
+            entry.format = format;
+            entry.cpu_upload = true;
+            entry.recycled = true;
+            spare_textures.erase(spare);
+            return;
+        }
+    }
+
+    entry.texture = std::make_shared<Texture>();
+}
+
 std::shared_ptr<mgl::Texture> mgl::RecentlyUsedCache::load(mg::Renderable const& renderable)
 {
     auto const& buffer = renderable.buffer();
     auto buffer_id = buffer->id();
-    auto& texture = textures[renderable.id()];
+    auto& texture = entry_for(renderable.id());
+    mark_used(texture, renderable.id());
+    if (!texture.texture)
+        give_texture_to(texture, buffer->size(), buffer->pixel_format());
     texture.texture->bind();
 
     auto const texture_source = dynamic_cast<mrgl::TextureSource*>(buffer->native_buffer_base());
     if (!texture_source)
         BOOST_THROW_EXCEPTION(std::logic_error("Buffer does not support GL rendering"));
 
-    if ((texture.last_bound_buffer != buffer_id) || (!texture.valid_binding))
+    bool const valid_binding = texture.has_binding && texture.bound_epoch == epoch;
+    if ((texture.last_bound_buffer != buffer_id) || (!valid_binding))
     {
-        texture_source->bind();
+        auto const sub_texture_source =
+            dynamic_cast<mrgl::SubTextureSource*>(buffer->native_buffer_base());
+
+        // Sub-uploading into a texture bound to a client's buffer would write into that buffer
+        if (sub_texture_source && texture.cpu_upload && (valid_binding || texture.recycled) &&
+            texture.size == buffer->size() && texture.format == buffer->pixel_format())
+        {
+            // The texture already holds the previous buffer's image, so only upload what changed
+            auto const damage_source = dynamic_cast<mg::DamageSource*>(buffer->native_buffer_base());
+            auto const damage = damage_source && valid_binding ?
+                damage_source->damage_since(texture.last_bound_buffer) : nullptr;
+
+            if (damage)
+                sub_texture_source->upload_areas(*damage);
+            else
+                sub_texture_source->upload_areas({{{0, 0}, texture.size}});
+        }
+        else
+        {
+            texture_source->bind();
+            texture.cpu_upload = sub_texture_source != nullptr;
+            texture.size = buffer->size();
+            texture.format = buffer->pixel_format();
+        }
         texture.resource = buffer;
         texture.last_bound_buffer = buffer_id;
     }
     texture_source->secure_for_render();
 
-    texture.valid_binding = true;
-    texture.used = true;
+    texture.has_binding = true;
+    texture.recycled = false;
+    texture.bound_epoch = epoch;
 
     return texture.texture;
 }
 
+void mgl::RecentlyUsedCache::touch(mg::Renderable const& renderable)
+{
+    if (auto const slot = find_slot(renderable.id()))
+        mark_used(slot->entry, slot->key);
+}
+
 void mgl::RecentlyUsedCache::invalidate()
 {
-    for (auto &t : textures)
-        t.second.valid_binding = false;
+    ++epoch;
 }
 
 void mgl::RecentlyUsedCache::drop_unused()
 {
-    auto t = textures.begin();
-    while (t != textures.end())
+    // Spares live for one frame: long enough for a replacement renderable to appear
+    spare_textures.clear();
+
+    for (auto const id : used_now)
     {
-        auto& tex = t->second;
-        tex.resource.reset();
-        if (tex.used)
-        {
-            tex.used = false;
-            ++t;
-        }
-        else
-        {
-            t = textures.erase(t);
-        }
+        if (auto const slot = find_slot(id))
+            slot->entry.resource.reset();
+    }
+
+    // Whatever was used last generation but not in this one has gone
+    for (auto const id : used_before)
+    {
+        auto const slot = find_slot(id);
+        if (!slot || slot->entry.last_used == generation)
+            continue;
+
+        auto& entry = slot->entry;
+
+        // A texture bound to a client's buffer can't be handed on: uploading
+        // into it would write into that client's buffer
+        if (entry.has_binding && entry.cpu_upload)
+            spare_textures.push_back({std::move(entry.texture), entry.size, entry.format});
+
+        slot->entry = Entry{};
+        slot->state = SlotState::removed;
+        --full_slots;
+        ++removed_slots;
     }
+
+    used_before.swap(used_now);
+    used_now.clear();
+
+    // Clear out the removed markers once they make up most of the table
+    if (removed_slots > full_slots && removed_slots * 4 > slots.size())
+        rehash(slots.size());
+
+    ++generation;
 }
@@ -24,7 +24,11 @@
 #include "mir/gl/texture.h"
 #include "mir/graphics/buffer_id.h"
 #include "mir/graphics/renderable.h"
-#include <unordered_map>
+#include "mir/geometry/size.h"
+#include "mir_toolkit/common.h"
+
+#include <cstdint>
+#include <vector>
 
 namespace mir
 {
@@ -35,23 +39,70 @@ class RecentlyUsedCache : public TextureCache
 {
 public:
     std::shared_ptr<Texture> load(graphics::Renderable const& renderable) override;
+    void touch(graphics::Renderable const& renderable) override;
     void invalidate() override;
     void drop_unused() override;
 
 private:
     struct Entry
     {
-        Entry()
-         : texture(std::make_shared<Texture>())
-        {}
         std::shared_ptr<Texture> texture;
         graphics::BufferID last_bound_buffer;
-        bool used{true};
-        bool valid_binding{false};
+        /// The drop_unused() generation this was last loaded in
+        uint64_t last_used{0};
+        /// The invalidate() epoch the texture was last bound in; older bindings are stale
+        uint64_t bound_epoch{0};
+        bool has_binding{false};
+        /// The texture was recycled from another renderable, so only its storage is of use
+        bool recycled{false};
+        /// The texture's storage holds pixels uploaded from the CPU, rather than
+        /// being bound to a client's buffer (e.g. through an EGLImage)
+        bool cpu_upload{false};
+        /// The size and format of the image last uploaded with a full bind()
+        geometry::Size size;
+        MirPixelFormat format{mir_pixel_format_invalid};
         std::shared_ptr<graphics::Buffer> resource;
     };
 
-    std::unordered_map<graphics::Renderable::ID, Entry> textures;
+    enum class SlotState : uint8_t { empty, full, removed };
+
+    struct Slot
+    {
+        SlotState state{SlotState::empty};
+        graphics::Renderable::ID key{nullptr};
+        Entry entry;
+    };
+
+    /// Textures of renderables that went away, for reuse by any that appear
+    struct SpareTexture
+    {
+        std::shared_ptr<Texture> texture;
+        geometry::Size size;
+        MirPixelFormat format;
+    };
+
+    Slot* find_slot(graphics::Renderable::ID id);
+    Entry& entry_for(graphics::Renderable::ID id);
+    void mark_used(Entry& entry, graphics::Renderable::ID id);
+    void give_texture_to(Entry& entry, geometry::Size size, MirPixelFormat format);
+    void rehash(std::size_t capacity);
+    std::size_t home_of(graphics::Renderable::ID id) const;
+
+    // An open-addressed table with linear probing: lookups walk contiguous
+    // memory, and removing an entry leaves a "removed" marker, not a free.
+    std::vector<Slot> slots;
+    std::size_t full_slots{0};
+    std::size_t removed_slots{0};
+
+    std::vector<SpareTexture> spare_textures;
+
+    // Every entry in the table was used in this generation or the last, so
+    // drop_unused() need only look at these rather than scan the table
+    std::vector<graphics::Renderable::ID> used_now;
+    std::vector<graphics::Renderable::ID> used_before;
+
+    uint64_t generation{1};
+    uint64_t epoch{1};
 };
 }
 }
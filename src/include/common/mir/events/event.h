@@ -25,6 +25,7 @@
 
 #include <capnp/message.h>
 
+#include <cstddef>
 #include <cstring>
 
 struct MirEvent
@@ -73,10 +74,19 @@ struct MirEvent
     static mir::EventUPtr deserialize(std::string const& bytes);
     static std::string serialize(MirEvent const* event);
 
+    // Events are created and destroyed at input rates, so their storage is recycled
+    static void* operator new(std::size_t size);
+    static void operator delete(void* event, std::size_t size) noexcept;
+
 protected:
     MirEvent() = default;
 
-    ::capnp::MallocMessageBuilder message;
+    /// Enough for any input event, so building one doesn't need a segment from the heap
+    static std::size_t const inline_segment_words = 128;
+
+    // MallocMessageBuilder requires its first segment zeroed
+    ::capnp::word inline_segment[inline_segment_words]{};
+    ::capnp::MallocMessageBuilder message{kj::arrayPtr(inline_segment, inline_segment_words)};
     mir::capnp::Event::Builder event{message.initRoot<mir::capnp::Event>()};
 };
 
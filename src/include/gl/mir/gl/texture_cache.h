@@ -43,6 +43,13 @@ public:
      */
     virtual std::shared_ptr<Texture> load(graphics::Renderable const&) = 0;
 
+    /**
+     * Keeps the texture of a renderable that is still on screen but wasn't
+     * loaded (e.g. because it was outside the area repainted) from being
+     * dropped. Does nothing if there's no texture for the renderable.
+     */
+    virtual void touch(graphics::Renderable const&) = 0;
+
     /**
      * Mark all entries in the cache as out-of-date to ensure fresh textures
      * are loaded next time. This function _must_ be implemented in a way that
@@ -53,7 +53,9 @@ extern char const* const fatal_except_opt;
 extern char const* const debug_opt;
 extern char const* const composite_delay_opt;
 extern char const* const enable_key_repeat_opt;
+extern char const* const input_batch_budget_opt;
 extern char const* const x11_display_opt;
+extern char const* const x11_prespawn_delay_opt;
 extern char const* const wayland_extensions_opt;
 extern char const* const wayland_extensions_value;
 
@@ -65,6 +67,7 @@ extern char const* const enable_key_repeat_opt;
 extern char const* const off_opt_value;
 extern char const* const log_opt_value;
 extern char const* const lttng_opt_value;
+extern char const* const histogram_opt_value;
 
 extern char const* const platform_graphics_lib;
 extern char const* const platform_input_lib;
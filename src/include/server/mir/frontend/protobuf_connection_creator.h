@@ -23,10 +23,13 @@
 #include "mir/frontend/connections.h"
 
 #include <atomic>
+#include <chrono>
 
 namespace mir
 {
 namespace graphics { class PlatformIpcOperations; }
+namespace cookie { class Authority; }
+namespace time { class AlarmFactory; }
 namespace frontend
 {
 class MessageProcessorReport;
@@ -48,7 +51,10 @@ public:
         std::shared_ptr<ProtobufIpcFactory> const& ipc_factory,
         std::shared_ptr<SessionAuthorizer> const& session_authorizer,
         std::shared_ptr<graphics::PlatformIpcOperations> const& operations,
-        std::shared_ptr<MessageProcessorReport> const& report);
+        std::shared_ptr<cookie::Authority> const& cookie_authority,
+        std::shared_ptr<MessageProcessorReport> const& report,
+        std::shared_ptr<time::AlarmFactory> const& alarm_factory = {},
+        std::chrono::milliseconds input_batch_budget = std::chrono::milliseconds{0});
     ~ProtobufConnectionCreator() noexcept;
 
     void create_connection_for(
@@ -66,7 +72,10 @@ private:
     std::shared_ptr<ProtobufIpcFactory> const ipc_factory;
     std::shared_ptr<SessionAuthorizer> const session_authorizer;
     std::shared_ptr<graphics::PlatformIpcOperations> const operations;
+    std::shared_ptr<cookie::Authority> const cookie_authority;
     std::shared_ptr<MessageProcessorReport> const report;
+    std::shared_ptr<time::AlarmFactory> const alarm_factory;
+    std::chrono::milliseconds const input_batch_budget;
     std::atomic<int> next_session_id;
     std::shared_ptr<detail::Connections<detail::SocketConnection>> const connections;
 };
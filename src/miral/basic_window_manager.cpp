@@ -21,6 +21,7 @@
 
 #include "miral/window_manager_tools.h"
 
+#include <mir/log.h>
 #include <mir/scene/session.h>
 #include <mir/scene/surface.h>
 #include <mir/scene/surface_creation_parameters.h>
@@ -47,13 +48,36 @@ struct miral::BasicWindowManager::Locker
     ~Locker()
     {
         policy->advise_end();
+
+        std::vector<std::function<void()>> deferred;
+        deferred.swap(self->deferred_until_unlocked);
+        lock.unlock();
+
+        // This is a destructor, so don't let a failed action escape
+        for (auto const& action : deferred)
+        {
+            try
+            {
+                action();
+            }
+            catch (...)
+            {
+                mir::log(
+                    mir::logging::Severity::warning,
+                    "miral",
+                    std::current_exception(),
+                    "Exception running window management work deferred until unlocked");
+            }
+        }
     }
 
-    std::lock_guard<std::mutex> const lock;
+    BasicWindowManager* const self;
+    std::unique_lock<std::mutex> lock;
     WindowManagementPolicy* const policy;
 };
 
 miral::BasicWindowManager::Locker::Locker(BasicWindowManager* self) :
+    self{self},
     lock{self->mutex},
     policy{self->policy.get()}
 {
@@ -110,19 +134,41 @@ auto miral::BasicWindowManager::add_surface(
     std::function<frontend::SurfaceId(std::shared_ptr<scene::Session> const& session, scene::SurfaceCreationParameters const& params)> const& build)
 -> frontend::SurfaceId
 {
-    Locker lock{this};
-
-    auto& session_info = info_for(session);
+    WindowSpecification spec;
+    {
+        Locker lock{this};
+        auto& session_info = info_for(session);
+        spec = policy->place_new_window(session_info, place_new_surface(session_info, params));
+    }
 
-    WindowSpecification const& spec = policy->place_new_window(session_info, place_new_surface(session_info, params));
+    // Building the scene surface doesn't need the window management state, so
+    // don't hold up input handling while it happens
     scene::SurfaceCreationParameters parameters;
     spec.update(parameters);
     auto const surface_id = build(session, parameters);
+
+    Locker lock{this};
+
+    // The session may have been removed while the surface was built
+    auto const app = app_info.find(session);
+    if (app == app_info.end())
+    {
+        deferred_until_unlocked.push_back(
+            [session, surface_id] { session->destroy_surface(surface_id); });
+        return surface_id;
+    }
+
+    auto& session_info = app->second;
     Window const window{session, session->surface(surface_id)};
     auto& window_info = this->window_info.emplace(window, WindowInfo{window, spec}).first->second;
 
     if (spec.parent().is_set() && spec.parent().value().lock())
-        window_info.parent(info_for(spec.parent().value()).window());
+    {
+        // The parent may have been removed while the surface was built
+        auto const parent_info = this->window_info.find(spec.parent().value());
+        if (parent_info != this->window_info.end())
+            window_info.parent(parent_info->second.window());
+    }
 
     if (spec.userdata().is_set())
         window_info.userdata() = spec.userdata().value();
@@ -157,8 +203,13 @@ auto miral::BasicWindowManager::add_surface(
 
     std::shared_ptr<scene::Surface> const scene_surface = window_info.window();
     scene_surface->add_observer(std::make_shared<shell::SurfaceReadyObserver>(
-        [this, &window_info](std::shared_ptr<scene::Session> const&, std::shared_ptr<scene::Surface> const&)
-            { Locker lock{this}; policy->handle_window_ready(window_info); },
+        [this, window](std::shared_ptr<scene::Session> const&, std::shared_ptr<scene::Surface> const&)
+            {
+                Locker lock{this};
+                auto const info = this->window_info.find(std::weak_ptr<scene::Surface>(window));
+                if (info != this->window_info.end())
+                    policy->handle_window_ready(info->second);
+            },
         session,
         scene_surface));
 
@@ -223,7 +274,10 @@ void miral::BasicWindowManager::remove_window(Application const& application, mi
     fullscreen_surfaces.erase(info.window());
     maximized_surfaces.erase(info.window());
 
-    application->destroy_surface(info.window());
+    // The scene surface is destroyed once the lock is released: input handling
+    // shouldn't wait on that, and the window is already gone from our state
+    deferred_until_unlocked.push_back(
+        [application, window = info.window()] { application->destroy_surface(window); });
 
     // NB erase() invalidates info, but we want to keep access to "parent".
     auto const parent = info.parent();
@@ -368,7 +422,7 @@ void miral::BasicWindowManager::handle_request_move(
     std::shared_ptr<mir::scene::Surface> const& surface,
     uint64_t timestamp)
 {
-    std::lock_guard<decltype(mutex)> lock(mutex);
+    Locker lock{this};
     if (timestamp >= last_input_event_timestamp && last_input_event)
     {
         policy->handle_request_move(info_for(surface), mir_event_get_input_event(last_input_event));
@@ -381,7 +435,7 @@ void miral::BasicWindowManager::handle_request_resize(
     uint64_t timestamp,
     MirResizeEdge edge)
 {
-    std::lock_guard<decltype(mutex)> lock(mutex);
+    Locker lock{this};
     if (timestamp >= last_input_event_timestamp && last_input_event)
     {
         policy->handle_request_resize(info_for(surface), mir_event_get_input_event(last_input_event), edge);
@@ -748,8 +802,13 @@ void miral::BasicWindowManager::focus_prev_within_application()
 auto miral::BasicWindowManager::window_at(geometry::Point cursor) const
 -> Window
 {
-    auto surface_at = focus_controller->surface_at(cursor);
-    return surface_at ? info_for(surface_at).window() : Window{};
+    auto const surface_at = focus_controller->surface_at(cursor);
+    if (!surface_at)
+        return Window{};
+
+    // Surfaces are added to (and removed from) the scene without holding our lock
+    auto const info = window_info.find(surface_at);
+    return info != window_info.end() ? info->second.window() : Window{};
 }
 
 auto miral::BasicWindowManager::active_output()
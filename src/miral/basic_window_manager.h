@@ -36,8 +36,10 @@
 #include <boost/bimap.hpp>
 #include <boost/bimap/multiset_of.hpp>
 
+#include <functional>
 #include <map>
 #include <mutex>
+#include <vector>
 
 namespace mir
 {
@@ -226,6 +228,10 @@ private:
     std::set<Window> fullscreen_surfaces;
     std::set<Window> maximized_surfaces;
 
+    // Work that needs doing, but not under the lock (e.g. destroying scene surfaces).
+    // Run by the current Locker after releasing the lock.
+    std::vector<std::function<void()>> deferred_until_unlocked;
+
     friend class Workspace;
     using wwbimap_t = boost::bimap<
         boost::bimaps::multiset_of<std::weak_ptr<Workspace>, std::owner_less<std::weak_ptr<Workspace>>>,
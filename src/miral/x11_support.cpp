@@ -37,6 +37,11 @@ void miral::X11Support::operator()(mir::Server& server) const
     server.add_configuration_option(
         mo::x11_display_opt,
         "DISPLAY socket to use for experimental X11 support (default: none).", mir::OptionType::integer);
+
+    server.add_configuration_option(
+        mo::x11_prespawn_delay_opt,
+        "Milliseconds after startup, or after an idle X server exits, to start one in readiness for "
+        "the next X11 client. -1 starts it only when a client connects.", -1);
 }
 
 miral::X11Support::~X11Support() = default;
@@ -38,10 +38,13 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <EGL/egl.h>
+#include <EGL/eglext.h>
 
 #include <boost/throw_exception.hpp>
 #include <stdexcept>
 #include <cmath>
+#include <cstddef>
+#include <cstring>
 #include <sstream>
 
 namespace mg = mir::graphics;
@@ -49,6 +52,49 @@ namespace mgl = mir::gl;
 namespace mrg = mir::renderer::gl;
 namespace geom = mir::geometry;
 
+namespace
+{
+/*
+ * The deepest buffer queue we expect to see. Buffers older than this get
+ * repainted in full, which is always correct, just not optimal.
+ */
+auto const max_buffer_age = 4u;
+
+/*
+ * Each damaged area costs a full pass over the renderables, so beyond a
+ * handful it is cheaper to just repaint their bounding rectangle.
+ */
+auto const max_scissor_passes = 4u;
+
+/*
+ * Partly hidden or partly opaque renderables are drawn a piece at a time,
+ * which costs a draw call per piece but saves overdraw and blending.
+ */
+auto const max_clip_passes = 16u;
+
+/// Presents a renderable as having no alpha channel, so that it's drawn without blending
+class OpaqueRenderable : public mg::Renderable
+{
+public:
+    OpaqueRenderable(mg::Renderable const& renderable)
+        : renderable{renderable}
+    {
+    }
+
+    ID id() const override { return renderable.id(); }
+    std::shared_ptr<mg::Buffer> buffer() const override { return renderable.buffer(); }
+    geom::Rectangle screen_position() const override { return renderable.screen_position(); }
+    float alpha() const override { return renderable.alpha(); }
+    glm::mat4 transformation() const override { return renderable.transformation(); }
+    bool shaped() const override { return false; }
+    geom::Region opaque_region() const override { return renderable.screen_position(); }
+    unsigned int swap_interval() const override { return renderable.swap_interval(); }
+
+private:
+    mg::Renderable const& renderable;
+};
+}
+
 mrg::CurrentRenderTarget::CurrentRenderTarget(mg::DisplayBuffer* display_buffer)
     : render_target{
         dynamic_cast<renderer::gl::RenderTarget*>(display_buffer->native_display_buffer())}
@@ -358,6 +404,9 @@ mrg::Renderer::Renderer(graphics::DisplayBuffer& display_buffer)
             auto val = eglQueryString(disp, s.id);
             mir::log_info(std::string(s.label) + ": " + (val ? val : ""));
         }
+
+        auto const extensions = eglQueryString(disp, EGL_EXTENSIONS);
+        buffer_age_supported = extensions && strstr(extensions, "EGL_EXT_buffer_age");
     }
 
     struct {GLenum id; char const* label;} const glstrings[] =
@@ -388,6 +437,9 @@ mrg::Renderer::Renderer(graphics::DisplayBuffer& display_buffer)
     mir::log_info("GL framebuffer bits: RGBA=%d%d%d%d, depth=%d, stencil=%d",
                   rbits, gbits, bbits, abits, dbits, sbits);
 
+    // Each frame's vertices are streamed into one buffer, rather than
+    // uploaded from client memory with every draw call
+    glGenBuffers(1, &vertex_buffer);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     set_viewport(display_buffer.view_area());
@@ -396,6 +448,8 @@ mrg::Renderer::Renderer(graphics::DisplayBuffer& display_buffer)
 mrg::Renderer::~Renderer()
 {
     render_target.ensure_current();
+    if (vertex_buffer)
+        glDeleteBuffers(1, &vertex_buffer);
 }
 
 void mrg::Renderer::tessellate(std::vector<mgl::Primitive>& primitives,
@@ -409,15 +463,69 @@ void mrg::Renderer::render(mg::RenderableList const& renderables) const
 {
     render_target.bind();
 
+    // Without damage information we can't trust any buffer contents
+    if (!damage_set)
+        damage_history.clear();
+    damage_set = false;
+
+    // A back buffer of age N needs the damage of the last N frames repainted
+    auto const age = buffer_age();
+    bool const partial = age > 0 && static_cast<unsigned>(age) <= damage_history.size();
+
     glClearColor(clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
     glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-    glClear(GL_COLOR_BUFFER_BIT);
+
+    // Work out which parts of each renderable aren't hidden behind others
+    auto const visible = visible_regions(renderables);
+
+    reset_draw_state();
+    upload_vertices(renderables);
 
     ++frameno;
-    for (auto const& r : renderables)
+    if (partial)
     {
-        draw(*r);
+        geom::Rectangles repaint;
+        for (auto i = 0; i != age; ++i)
+        {
+            for (auto const& area : damage_history[i])
+                repaint.add(area);
+        }
+
+        if (repaint.size() > max_scissor_passes)
+            repaint = geom::Rectangles{repaint.bounding_rectangle()};
+
+        glEnable(GL_SCISSOR_TEST);
+        for (auto const& area : repaint)
+        {
+            scissor_to(area);
+            glClear(GL_COLOR_BUFFER_BIT);
+
+            for (auto i = 0u; i != renderables.size(); ++i)
+            {
+                batch_to_draw = i < batches.size() ? &batches[i] : nullptr;
+                draw_visible(*renderables[i], visible[i], area, true);
+            }
+        }
+        glDisable(GL_SCISSOR_TEST);
     }
+    else
+    {
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        for (auto i = 0u; i != renderables.size(); ++i)
+        {
+            batch_to_draw = i < batches.size() ? &batches[i] : nullptr;
+            draw_visible(*renderables[i], visible[i], viewport, false);
+        }
+    }
+    batch_to_draw = nullptr;
+
+    reset_draw_state();
+
+    // Renderables outside the repainted area (or hidden) weren't loaded, but
+    // are still on screen and shouldn't lose their textures
+    for (auto const& renderable : renderables)
+        texture_cache->touch(*renderable);
 
     render_target.swap_buffers();
 
@@ -429,6 +537,148 @@ void mrg::Renderer::render(mg::RenderableList const& renderables) const
         mir::log_debug("GL error: %d", gl_error);
 }
 
+void mrg::Renderer::upload_vertices(mg::RenderableList const& renderables) const
+{
+    batches.clear();
+    batched_primitives.clear();
+    frame_vertices.clear();
+
+    if (!vertex_buffer)
+        return;
+
+    batches.reserve(renderables.size());
+    for (auto const& renderable : renderables)
+    {
+        primitives.clear();
+        tessellate(primitives, *renderable);
+
+        Batch batch{batched_primitives.size(), batched_primitives.size()};
+        for (auto const& p : primitives)
+        {
+            batched_primitives.push_back(
+                {p.type, static_cast<GLint>(frame_vertices.size()), static_cast<GLsizei>(p.nvertices)});
+            frame_vertices.insert(frame_vertices.end(), p.vertices, p.vertices + p.nvertices);
+        }
+        batch.end = batched_primitives.size();
+        batches.push_back(batch);
+    }
+
+    // Respecifying the whole store lets the driver orphan last frame's
+    // vertices rather than wait for the GPU to finish with them
+    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+    glBufferData(GL_ARRAY_BUFFER, frame_vertices.size() * sizeof(mgl::Vertex),
+                 frame_vertices.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void mrg::Renderer::reset_draw_state() const
+{
+    if (vertex_attribs_program)
+    {
+        glDisableVertexAttribArray(vertex_attribs_program->texcoord_attr);
+        glDisableVertexAttribArray(vertex_attribs_program->position_attr);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    vertex_attribs_program = nullptr;
+    current_program = nullptr;
+    blend_state = std::experimental::nullopt;
+}
+
+auto mrg::Renderer::visible_regions(mg::RenderableList const& renderables) const
+    -> std::vector<std::experimental::optional<geom::Region>>
+{
+    std::vector<std::experimental::optional<geom::Region>> visible(renderables.size());
+    geom::Region coverage;
+
+    for (auto i = renderables.size(); i-- != 0;)
+    {
+        auto const& r = *renderables[i];
+
+        // Transformed renderables may draw anywhere, so we don't try to clip them
+        if (r.transformation() != glm::mat4(1))
+            continue;
+
+        auto const position = r.screen_position();
+        visible[i] = geom::Region{position}.subtract(coverage);
+
+        // Nothing is below the bottom renderable for it to cover
+        if (i != 0 && r.alpha() == 1.0f)
+        {
+            if (!r.shaped())
+                coverage.unite(position);
+            else
+                coverage.unite(r.opaque_region());
+        }
+    }
+
+    return visible;
+}
+
+void mrg::Renderer::draw_visible(
+    mg::Renderable const& renderable,
+    std::experimental::optional<geom::Region> const& visible,
+    geom::Rectangle const& area,
+    bool scissoring) const
+{
+    if (!visible)
+    {
+        draw(renderable);
+        return;
+    }
+
+    auto const& clipped_position = renderable.screen_position().intersection_with(area);
+    auto const parts = geom::Region{*visible}.intersect(area);
+
+    if (parts.empty())
+        return;
+
+    // Parts the client promises are opaque can be drawn without blending
+    auto unblended = renderable.opaque_region();
+    if (!unblended.empty() && renderable.alpha() == 1.0f && renderable.shaped())
+        unblended.intersect(parts);
+    else
+        unblended = geom::Region{};
+
+    auto const opaque_parts = unblended.rectangles();
+    auto const blended_parts = geom::Region{parts}.subtract(unblended).rectangles();
+
+    // Only scissor when the renderable is partly hidden or partly opaque, and not into too many pieces
+    if (opaque_parts.size() + blended_parts.size() > max_clip_passes ||
+        gl_viewport.width <= 0 || gl_viewport.height <= 0 ||
+        (opaque_parts.empty() && blended_parts.size() == 1 && blended_parts.front() == clipped_position))
+    {
+        draw(renderable);
+        return;
+    }
+
+    if (!scissoring)
+        glEnable(GL_SCISSOR_TEST);
+
+    if (!opaque_parts.empty())
+    {
+        // The wrapper draws with the renderable's own batch of vertices
+        OpaqueRenderable const opaque{renderable};
+
+        for (auto const& part : opaque_parts)
+        {
+            scissor_to(part);
+            draw(opaque);
+        }
+    }
+
+    for (auto const& part : blended_parts)
+    {
+        scissor_to(part);
+        draw(renderable);
+    }
+
+    if (scissoring)
+        scissor_to(area);
+    else
+        glDisable(GL_SCISSOR_TEST);
+}
+
 void mrg::Renderer::draw(mg::Renderable const& renderable) const
 {
     auto const texture = std::dynamic_pointer_cast<mg::gl::Texture>(renderable.buffer());
@@ -476,7 +726,12 @@ void mrg::Renderer::draw(mg::Renderable const& renderable) const
 
     auto const& prog = *maybe_prog;
 
-    glUseProgram(prog.id);
+    if (&prog != current_program)
+    {
+        glUseProgram(prog.id);
+        current_program = &prog;
+    }
+
     if (prog.last_used_frameno != frameno)
     {   // Avoid reloading the screen-global uniforms on every renderable
         // TODO: We actually only need to bind these *once*, right? Not once per frame?
@@ -522,81 +777,117 @@ void mrg::Renderer::draw(mg::Renderable const& renderable) const
     if (prog.alpha_uniform >= 0)
         glUniform1f(prog.alpha_uniform, renderable.alpha());
 
-    glEnableVertexAttribArray(prog.position_attr);
-    glEnableVertexAttribArray(prog.texcoord_attr);
+    // Renderables tessellated by render() draw from the shared vertex buffer
+    auto const batch = batch_to_draw;
+    bool const batched = batch != nullptr;
 
-    primitives.clear();
-    tessellate(primitives, renderable);
+    if (!batched || vertex_attribs_program != &prog)
+    {
+        if (vertex_attribs_program)
+        {
+            glDisableVertexAttribArray(vertex_attribs_program->texcoord_attr);
+            glDisableVertexAttribArray(vertex_attribs_program->position_attr);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            vertex_attribs_program = nullptr;
+        }
+
+        glEnableVertexAttribArray(prog.position_attr);
+        glEnableVertexAttribArray(prog.texcoord_attr);
+
+        if (batched)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+            glVertexAttribPointer(prog.position_attr, 3, GL_FLOAT,
+                                  GL_FALSE, sizeof(mgl::Vertex),
+                                  reinterpret_cast<GLvoid const*>(offsetof(mgl::Vertex, position)));
+            glVertexAttribPointer(prog.texcoord_attr, 2, GL_FLOAT,
+                                  GL_FALSE, sizeof(mgl::Vertex),
+                                  reinterpret_cast<GLvoid const*>(offsetof(mgl::Vertex, texcoord)));
+            vertex_attribs_program = &prog;
+        }
+        else
+        {
+            primitives.clear();
+            tessellate(primitives, renderable);
+        }
+    }
 
     // if we fail to load the texture, we need to carry on (part of lp:1629275)
     try
     {
-        typedef struct  // Represents parameters of glBlendFuncSeparate()
-        {
-            GLenum src_rgb, dst_rgb, src_alpha, dst_alpha;
-        } BlendSeparate;
-
-        BlendSeparate client_blend;
+        BlendState blend;
 
         // These renderable method names could be better (see LP: #1236224)
         if (renderable.shaped())  // Client is RGBA:
         {
-            client_blend = {GL_ONE, GL_ONE_MINUS_SRC_ALPHA,
-                            GL_ONE, GL_ONE_MINUS_SRC_ALPHA};
+            blend = {GL_ONE, GL_ONE_MINUS_SRC_ALPHA,
+                     GL_ONE, GL_ONE_MINUS_SRC_ALPHA};
         }
         else if (renderable.alpha() == 1.0f)  // RGBX and no window translucency:
         {
-            client_blend = {GL_ONE,  GL_ZERO,
-                            GL_ZERO, GL_ONE};  // Avoid using src_alpha!
+            blend = {GL_ONE,  GL_ZERO,
+                     GL_ZERO, GL_ONE};  // Avoid using src_alpha!
         }
         else
         {   // Client is RGBX but we also have window translucency.
             // The texture alpha channel is possibly uninitialized so we must be
             // careful and avoid using SRC_ALPHA (LP: #1423462).
-            client_blend = {GL_ONE,  GL_ONE_MINUS_CONSTANT_ALPHA,
-                            GL_ZERO, GL_ONE};
+            blend = {GL_ONE,  GL_ONE_MINUS_CONSTANT_ALPHA,
+                     GL_ZERO, GL_ONE};
             glBlendColor(0.0f, 0.0f, 0.0f, renderable.alpha());
         }
 
-        for (auto const& p : primitives)
+        if (surface_tex)
         {
-            BlendSeparate blend;
-
-            blend = client_blend;
-            if (surface_tex)
-            {
-                surface_tex->bind();
-            }
-            else
-            {
-                texture->bind();
-            }
+            surface_tex->bind();
+        }
+        else
+        {
+            texture->bind();
+        }
 
-            glVertexAttribPointer(prog.position_attr, 3, GL_FLOAT,
-                                  GL_FALSE, sizeof(mgl::Vertex),
-                                  &p.vertices[0].position);
-            glVertexAttribPointer(prog.texcoord_attr, 2, GL_FLOAT,
-                                  GL_FALSE, sizeof(mgl::Vertex),
-                                  &p.vertices[0].texcoord);
+        if (blend.dst_rgb == GL_ZERO)
+        {
+            if (!blend_state || blend_state->dst_rgb != GL_ZERO)
+                glDisable(GL_BLEND);
+        }
+        else if (!blend_state ||
+                 blend_state->src_rgb != blend.src_rgb || blend_state->dst_rgb != blend.dst_rgb ||
+                 blend_state->src_alpha != blend.src_alpha || blend_state->dst_alpha != blend.dst_alpha)
+        {
+            if (!blend_state || blend_state->dst_rgb == GL_ZERO)
+                glEnable(GL_BLEND);
+            glBlendFuncSeparate(blend.src_rgb,   blend.dst_rgb,
+                                blend.src_alpha, blend.dst_alpha);
+        }
+        blend_state = blend;
 
-            if (blend.dst_rgb == GL_ZERO)
+        if (batched)
+        {
+            for (auto i = batch->begin; i != batch->end; ++i)
             {
-                glDisable(GL_BLEND);
+                auto const& p = batched_primitives[i];
+                glDrawArrays(p.type, p.first, p.count);
             }
-            else
+        }
+        else
+        {
+            for (auto const& p : primitives)
             {
-                glEnable(GL_BLEND);
-                glBlendFuncSeparate(blend.src_rgb,   blend.dst_rgb,
-                                    blend.src_alpha, blend.dst_alpha);
+                glVertexAttribPointer(prog.position_attr, 3, GL_FLOAT,
+                                      GL_FALSE, sizeof(mgl::Vertex),
+                                      &p.vertices[0].position);
+                glVertexAttribPointer(prog.texcoord_attr, 2, GL_FLOAT,
+                                      GL_FALSE, sizeof(mgl::Vertex),
+                                      &p.vertices[0].texcoord);
+                glDrawArrays(p.type, 0, p.nvertices);
             }
+        }
 
-            glDrawArrays(p.type, 0, p.nvertices);
-
-            if (texture)
-            {
-                // We're done with the texture for now
-                texture->add_syncpoint();
-            }
+        if (texture)
+        {
+            // We're done with the texture for now
+            texture->add_syncpoint();
         }
     }
     catch (std::exception const& ex)
@@ -604,8 +895,62 @@ void mrg::Renderer::draw(mg::Renderable const& renderable) const
         report_exception();
     }
 
-    glDisableVertexAttribArray(prog.texcoord_attr);
-    glDisableVertexAttribArray(prog.position_attr);
+    // Client-side vertex arrays are only valid for this draw
+    if (!batched)
+    {
+        glDisableVertexAttribArray(prog.texcoord_attr);
+        glDisableVertexAttribArray(prog.position_attr);
+    }
+}
+
+void mrg::Renderer::set_damage(geometry::Rectangles const& damage)
+{
+    damage_history.push_front(damage);
+    if (damage_history.size() > max_buffer_age)
+        damage_history.pop_back();
+    damage_set = true;
+}
+
+int mrg::Renderer::buffer_age() const
+{
+    if (!buffer_age_supported || gl_viewport.width <= 0 || gl_viewport.height <= 0)
+        return 0;
+
+    // EGL knows nothing of the contents of framebuffer objects
+    GLint framebuffer = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+    if (framebuffer != 0)
+        return 0;
+
+    auto const surf = eglGetCurrentSurface(EGL_DRAW);
+    EGLint age = 0;
+    if (surf == EGL_NO_SURFACE ||
+        !eglQuerySurface(eglGetCurrentDisplay(), surf, EGL_BUFFER_AGE_EXT, &age))
+        return 0;
+
+    return age;
+}
+
+void mrg::Renderer::scissor_to(geometry::Rectangle const& area) const
+{
+    auto const to_window = [this](geom::Point const& p)
+        {
+            auto const ndc = display_transform * screen_to_gl_coords *
+                             glm::vec4(p.x.as_int(), p.y.as_int(), 0, 1);
+            return glm::vec2{
+                gl_viewport.x + (ndc[0] / ndc[3] + 1.0f) * gl_viewport.width / 2.0f,
+                gl_viewport.y + (ndc[1] / ndc[3] + 1.0f) * gl_viewport.height / 2.0f};
+        };
+
+    auto const a = to_window(area.top_left);
+    auto const b = to_window(area.bottom_right());
+
+    GLint const left = std::floor(std::min(a[0], b[0]));
+    GLint const bottom = std::floor(std::min(a[1], b[1]));
+    GLint const right = std::ceil(std::max(a[0], b[0]));
+    GLint const top = std::ceil(std::max(a[1], b[1]));
+
+    glScissor(left, bottom, right - left, top - bottom);
 }
 
 void mrg::Renderer::set_viewport(geometry::Rectangle const& rect)
@@ -684,7 +1029,15 @@ void mrg::Renderer::update_gl_viewport()
         GLint offset_y = (buf_height - reduced_height) / 2;
 
         glViewport(offset_x, offset_y, reduced_width, reduced_height);
+        gl_viewport = {offset_x, offset_y, reduced_width, reduced_height};
     }
+    else
+    {
+        gl_viewport = {0, 0, 0, 0};
+    }
+
+    // Whatever is in the buffers was drawn with the old geometry
+    damage_history.clear();
 }
 
 void mrg::Renderer::set_output_transform(glm::mat2 const& t)
@@ -700,5 +1053,6 @@ void mrg::Renderer::set_output_transform(glm::mat2 const& t)
 void mrg::Renderer::suspend()
 {
     texture_cache->invalidate();
+    damage_history.clear();
 }
 
@@ -23,13 +23,16 @@
 
 #include <mir/renderer/renderer.h>
 #include <mir/geometry/rectangle.h>
+#include <mir/geometry/rectangles.h>
+#include <mir/geometry/region.h>
 #include <mir/graphics/buffer_id.h>
 #include <mir/graphics/renderable.h>
 #include <mir/gl/primitive.h>
 #include "mir/renderer/gl/render_target.h"
 
 #include MIR_SERVER_GL_H
-#include <unordered_map>
+#include <deque>
+#include <experimental/optional>
 #include <unordered_set>
 #include <vector>
 
@@ -65,6 +68,7 @@ public:
     // These are called with a valid GL context:
     void set_viewport(geometry::Rectangle const& rect) override;
     void set_output_transform(glm::mat2 const&) override;
+    void set_damage(geometry::Rectangles const& damage) override;
     void render(graphics::RenderableList const&) const override;
 
     // This is called _without_ a GL context:
@@ -128,6 +132,24 @@ protected:
 private:
     void update_gl_viewport();
 
+    /// The age of the back buffer (as EGL_EXT_buffer_age) or 0 if unknown
+    int buffer_age() const;
+    /// Convert logical screen coordinates into a glScissor() box
+    void scissor_to(geometry::Rectangle const& area) const;
+    /// The parts of each renderable not covered by opaque ones above it (if known)
+    std::vector<std::experimental::optional<geometry::Region>>
+        visible_regions(graphics::RenderableList const& renderables) const;
+    /// draw() the renderable, skipping any parts hidden by others if it's worthwhile
+    void draw_visible(
+        graphics::Renderable const& renderable,
+        std::experimental::optional<geometry::Region> const& visible,
+        geometry::Rectangle const& area,
+        bool scissoring) const;
+    /// Tessellate every renderable into the shared vertex buffer for this frame
+    void upload_vertices(graphics::RenderableList const& renderables) const;
+    /// Forget the GL state tracked across draw() calls, disabling any vertex attributes
+    void reset_draw_state() const;
+
     class ProgramFactory;
     std::unique_ptr<ProgramFactory> const program_factory;
     std::unique_ptr<mir::gl::TextureCache> const texture_cache;
@@ -135,6 +157,42 @@ private:
     glm::mat4 screen_to_gl_coords;
     glm::mat4 display_transform;
     std::vector<mir::gl::Primitive> mutable primitives;
+
+    /// A primitive's vertices within vertex_buffer
+    struct BatchedPrimitive
+    {
+        GLenum type;
+        GLint first;
+        GLsizei count;
+    };
+    /// The [begin, end) range of a renderable's primitives in batched_primitives
+    struct Batch
+    {
+        size_t begin;
+        size_t end;
+    };
+    GLuint vertex_buffer{0};
+    std::vector<mir::gl::Vertex> mutable frame_vertices;
+    std::vector<BatchedPrimitive> mutable batched_primitives;
+    /// Indexed in parallel with the RenderableList being rendered
+    std::vector<Batch> mutable batches;
+    /// The batch of the renderable being drawn, or null to tessellate it in draw()
+    mutable Batch const* batch_to_draw{nullptr};
+
+    /// Parameters of glBlendFuncSeparate(), or a disabled blend when dst_rgb is GL_ZERO
+    struct BlendState
+    {
+        GLenum src_rgb, dst_rgb, src_alpha, dst_alpha;
+    };
+    mutable Program const* current_program{nullptr};
+    mutable Program const* vertex_attribs_program{nullptr};
+    std::experimental::optional<BlendState> mutable blend_state;
+
+    struct { GLint x, y, width, height; } gl_viewport{0, 0, 0, 0};
+    bool buffer_age_supported{false};
+    /// Damage of recent frames, most recent first, for buffer age repaints
+    std::deque<geometry::Rectangles> mutable damage_history;
+    bool mutable damage_set{false};
 };
 
 }
@@ -28,14 +28,20 @@
 #include "mir/compositor/display_buffer_compositor_factory.h"
 #include "mir/graphics/transformation.h"
 #include "mir/compositor/display_buffer_compositor.h"
+#include "mir/compositor/scene.h"
+#include "mir/scene/legacy_scene_change_notification.h"
 #include "mir/geometry/rectangles.h"
 #include "mir/raii.h"
 
 #include <boost/throw_exception.hpp>
 
+#include <atomic>
+#include <unordered_set>
+
 namespace mc = mir::compositor;
 namespace mf = mir::frontend;
 namespace mg = mir::graphics;
+namespace ms = mir::scene;
 namespace geom = mir::geometry;
 
 namespace
@@ -82,17 +88,26 @@ public:
       display_buffer_compositor{db_compositor_factory.create_compositor_for(*display_buffer)},
       virtual_output{make_virtual_output(display, capture_region)},
       queue_size(capture_size),
-      mirror_mode(mirror_mode)
+      mirror_mode(mirror_mode),
+      damage_observer{std::make_shared<ms::LegacySceneChangeNotification>(
+          [this] { ++scene_generation; },
+          [this, capture_region](int, geom::Rectangle const& damage)
+          {
+              if (damage.overlaps(capture_region))
+                  ++scene_generation;
+          })}
     {
         for (auto buffer : buffers)
             free_queue.schedule(buffer);
 
         scene->register_compositor(this);
+        scene->add_observer(damage_observer);
         if (virtual_output)
             virtual_output->enable();
     }
     ~ScreencastSessionContext()
     {
+        scene->remove_observer(damage_observer);
         scene->unregister_compositor(this);
     }
 
@@ -116,6 +131,17 @@ public:
     void capture(std::shared_ptr<mg::Buffer> const& buffer)
     {
         std::lock_guard<decltype(mutex)> lk(mutex);
+
+        // If nothing in the region has changed since this buffer was last
+        // captured to, it already holds the capture.
+        auto const generation = scene_generation.load();
+        if (generation == captured_generation &&
+            captured_buffers.count(buffer->id()) &&
+            scene->frames_pending(this) == 0)
+        {
+            return;
+        }
+
         if (buffer->size() != display_buffer->renderbuffer_size())
             display_buffer->set_renderbuffer_size(buffer->size());
        
@@ -144,6 +170,13 @@ public:
 
         display_buffer->set_transformation(mg::transformation(mirror_mode));
         display_buffer->commit();
+
+        if (generation != captured_generation)
+        {
+            captured_buffers.clear();
+            captured_generation = generation;
+        }
+        captured_buffers.insert(buffer->id());
     }
 
 private:
@@ -158,6 +191,13 @@ private:
     std::shared_ptr<mg::Buffer> last_captured_buffer;
     geom::Size queue_size;
     MirMirrorMode mirror_mode;
+
+    /// Counts the scene changes and damage affecting the captured region
+    std::atomic<uint64_t> scene_generation{1};
+    std::shared_ptr<ms::LegacySceneChangeNotification> const damage_observer;
+    /// The buffers holding a capture of captured_generation
+    uint64_t captured_generation{0};
+    std::unordered_set<mg::BufferID> captured_buffers;
 };
 
 
@@ -24,15 +24,64 @@
 #include "mir/graphics/renderable.h"
 #include "mir/graphics/display_buffer.h"
 #include "mir/graphics/buffer.h"
+#include "mir/graphics/damage_source.h"
+#include "mir/geometry/displacement.h"
 #include "mir/compositor/buffer_stream.h"
 #include "mir/renderer/renderer.h"
 #include "occlusion.h"
 #include <mutex>
 #include <cstdlib>
 #include <algorithm>
+#include <exception>
 
 namespace mc = mir::compositor;
 namespace mg = mir::graphics;
+namespace geom = mir::geometry;
+
+namespace
+{
+void add_clipped(geom::Rectangles& damage, geom::Rectangle const& area, geom::Rectangle const& view_area)
+{
+    auto const clipped = area.intersection_with(view_area);
+    if (clipped.size.width.as_int() > 0 && clipped.size.height.as_int() > 0)
+        damage.add(clipped);
+}
+
+/// Adds the parts of renderable that changed since it showed the previous buffer
+void add_buffer_damage(
+    geom::Rectangles& damage,
+    mg::Renderable const& renderable,
+    mg::BufferID previous,
+    geom::Rectangle const& view_area)
+{
+    auto const position = renderable.screen_position();
+
+    try
+    {
+        auto const buffer = renderable.buffer();
+        auto const source = buffer ? dynamic_cast<mg::DamageSource*>(buffer->native_buffer_base()) : nullptr;
+
+        // We only know how to map unscaled buffers to the screen
+        if (source && buffer->size() == position.size)
+        {
+            if (auto const changed = source->damage_since(previous))
+            {
+                for (auto area : *changed)
+                {
+                    area.top_left = position.top_left + (area.top_left - geom::Point{});
+                    add_clipped(damage, area, view_area);
+                }
+                return;
+            }
+        }
+    }
+    catch (std::exception const&)
+    {
+    }
+
+    add_clipped(damage, position, view_area);
+}
+}
 
 mc::DefaultDisplayBufferCompositor::DefaultDisplayBufferCompositor(
     mg::DisplayBuffer& display_buffer,
@@ -76,11 +125,18 @@ void mc::DefaultDisplayBufferCompositor::composite(mc::SceneElementSequence&& sc
     {
         report->renderables_in_frame(this, renderable_list);
         renderer->suspend();
+
+        // Whatever the renderer last drew is no longer on screen
+        last_frame_valid = false;
     }
     else
     {
-        renderer->set_output_transform(display_buffer.transformation());
+        auto const output_transform = display_buffer.transformation();
+        update_damage(renderable_list, view_area, output_transform);
+
+        renderer->set_output_transform(output_transform);
         renderer->set_viewport(view_area);
+        renderer->set_damage(damage);
         renderer->render(renderable_list);
 
         report->renderables_in_frame(this, renderable_list);
@@ -102,3 +158,127 @@ void mc::DefaultDisplayBufferCompositor::composite(mc::SceneElementSequence&& sc
 
     report->finished_frame(this);
 }
+
+/*
+ * Work out which parts of the output differ from the last frame we rendered
+ * by comparing what is to be drawn with what was drawn. This catches damage
+ * from every source (buffer commits, moves, resizes, restacking, alpha
+ * changes, surfaces appearing and vanishing) without needing to plumb
+ * notifications from each of them through to here.
+ */
+void mc::DefaultDisplayBufferCompositor::update_damage(
+    mg::RenderableList const& renderables,
+    geom::Rectangle const& view_area,
+    glm::mat2 const& output_transform)
+{
+    damage.clear();
+    this_frame.clear();
+
+    bool full_damage =
+        !last_frame_valid ||
+        view_area != last_view_area ||
+        output_transform != last_output_transform;
+
+    for (auto const& renderable : renderables)
+    {
+        mg::BufferID buffer_id;
+        try
+        {
+            if (auto const buffer = renderable->buffer())
+                buffer_id = buffer->id();
+        }
+        catch (std::exception const&)
+        {
+            // The renderer deals with unusable buffers, we just need the rest
+        }
+
+        this_frame.push_back(RenderedState{
+            renderable->id(),
+            renderable->screen_position(),
+            buffer_id,
+            renderable->alpha(),
+            renderable->shaped(),
+            renderable->transformation() != glm::mat4(1)});
+
+        // We can't cheaply bound the area touched by a transformed renderable
+        if (this_frame.back().transformed)
+            full_damage = true;
+    }
+
+    if (!full_damage)
+    {
+        for (auto const& previous : last_frame)
+        {
+            if (previous.transformed)
+                full_damage = true;
+        }
+    }
+
+    if (full_damage)
+    {
+        damage.add(view_area);
+    }
+    else
+    {
+        last_frame_index.clear();
+        for (auto i = 0u; i != last_frame.size(); ++i)
+            last_frame_index.emplace_back(last_frame[i].id, i);
+        std::sort(last_frame_index.begin(), last_frame_index.end());
+        last_frame_seen.assign(last_frame.size(), false);
+
+        std::size_t highest_previous_index = 0;
+
+        for (auto i = 0u; i != this_frame.size(); ++i)
+        {
+            auto const& current = this_frame[i];
+            auto const match = std::lower_bound(
+                last_frame_index.begin(), last_frame_index.end(),
+                std::make_pair(current.id, std::size_t{0}));
+
+            if (match == last_frame_index.end() || match->first != current.id)
+            {
+                add_clipped(damage, current.position, view_area);
+                continue;
+            }
+
+            auto const previous_index = match->second;
+            auto const& previous = last_frame[previous_index];
+            last_frame_seen[previous_index] = true;
+
+            if (previous.position != current.position ||
+                previous.alpha != current.alpha ||
+                previous.shaped != current.shaped)
+            {
+                if (previous.position != current.position)
+                    add_clipped(damage, previous.position, view_area);
+                add_clipped(damage, current.position, view_area);
+            }
+            else if (previous.buffer != current.buffer)
+            {
+                add_buffer_damage(damage, *renderables[i], previous.buffer, view_area);
+            }
+            else if (previous_index < highest_previous_index)
+            {
+                /*
+                 * This renderable used to be below one that is now below it,
+                 * so the two have been restacked. Whatever changed lies in
+                 * their intersection, which is within this renderable.
+                 */
+                add_clipped(damage, current.position, view_area);
+            }
+
+            highest_previous_index = std::max(highest_previous_index, previous_index);
+        }
+
+        for (auto i = 0u; i != last_frame.size(); ++i)
+        {
+            if (!last_frame_seen[i])
+                add_clipped(damage, last_frame[i].position, view_area);
+        }
+    }
+
+    std::swap(last_frame, this_frame);
+    last_view_area = view_area;
+    last_output_transform = output_transform;
+    last_frame_valid = true;
+}
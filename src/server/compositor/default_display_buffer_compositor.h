@@ -21,7 +21,14 @@
 
 #include "mir/compositor/display_buffer_compositor.h"
 #include "mir/compositor/compositor_report.h"
+#include "mir/geometry/rectangles.h"
+#include "mir/graphics/buffer_id.h"
+#include "mir/graphics/renderable.h"
+
+#include <glm/glm.hpp>
 #include <memory>
+#include <utility>
+#include <vector>
 
 namespace mir
 {
@@ -49,9 +56,35 @@ public:
     void composite(SceneElementSequence&& scene_sequence) override;
 
 private:
+    /// What we need to remember of a renderable to tell if it needs redrawing
+    struct RenderedState
+    {
+        graphics::Renderable::ID id;
+        geometry::Rectangle position;
+        graphics::BufferID buffer;
+        float alpha;
+        bool shaped;
+        bool transformed;
+    };
+
+    void update_damage(
+        graphics::RenderableList const& renderables,
+        geometry::Rectangle const& view_area,
+        glm::mat2 const& output_transform);
+
     graphics::DisplayBuffer& display_buffer;
     std::shared_ptr<renderer::Renderer> const renderer;
     std::shared_ptr<CompositorReport> const report;
+
+    /* Damage tracking state, reused between frames to avoid reallocation */
+    bool last_frame_valid{false};
+    geometry::Rectangle last_view_area;
+    glm::mat2 last_output_transform;
+    std::vector<RenderedState> last_frame;
+    std::vector<RenderedState> this_frame;
+    std::vector<std::pair<graphics::Renderable::ID, std::size_t>> last_frame_index;
+    std::vector<bool> last_frame_seen;
+    geometry::Rectangles damage;
 };
 
 }
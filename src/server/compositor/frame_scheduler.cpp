@@ -0,0 +1,110 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "frame_scheduler.h"
+
+namespace mc = mir::compositor;
+namespace mt = mir::time;
+
+namespace
+{
+/// Leeway for wake-up latency and frames that take longer than usual to render
+std::chrono::microseconds const deadline_margin{2000};
+
+/// Shorter than any real display's refresh period (400Hz). Gaps between
+/// posts shorter than this mean post() isn't waiting for vblank at all.
+std::chrono::microseconds const min_period{2500};
+}
+
+bool mc::FrameScheduler::synchronised() const
+{
+    return period >= min_period;
+}
+
+mt::Timestamp mc::FrameScheduler::start_time(mt::Timestamp now) const
+{
+    if (!synchronised())
+        return now;
+
+    auto const budget = render_time + deadline_margin;
+    if (budget >= period)
+        return now;
+
+    // Aim for the first vblank we can still render in time for
+    return next_vblank(now + budget) - budget;
+}
+
+mt::Duration mc::FrameScheduler::frame_posted(
+    mt::Timestamp started,
+    mt::Timestamp rendered,
+    mt::Timestamp posted,
+    bool continuous)
+{
+    mt::Duration lateness{};
+
+    if (synchronised())
+    {
+        // The vblank start_time() would have aimed this frame at
+        auto const target = next_vblank(started + render_time + deadline_margin);
+
+        // post() returns at a vblank, so anything much past the target missed it
+        if (posted - target > period / 2)
+            lateness = posted - target;
+    }
+
+    // Follow increases in render time at once, but decreases only gradually
+    auto const render_sample = rendered - started;
+    if (render_sample > render_time)
+        render_time = render_sample;
+    else
+        render_time -= (render_time - render_sample) / 8;
+
+    if (continuous && last_vblank != mt::Timestamp{})
+    {
+        auto const interval = posted - last_vblank;
+
+        if (!synchronised() || interval < period * 3 / 4)
+        {
+            period = interval;
+        }
+        else if (interval < period * 3 / 2)
+        {
+            period += (interval - period) / 8;
+        }
+        else
+        {
+            // A whole number of periods is just missed vblanks. Anything else
+            // means our estimate was wrong (or the mode changed).
+            auto const frames = (interval + period / 2) / period;
+            auto const error = interval - frames * period;
+            if (error > period / 8 || error < -period / 8)
+                period = interval;
+        }
+    }
+
+    last_vblank = posted;
+
+    return lateness;
+}
+
+mt::Timestamp mc::FrameScheduler::next_vblank(mt::Timestamp t) const
+{
+    if (t <= last_vblank)
+        return last_vblank;
+
+    auto const frames = (t - last_vblank + period - mt::Duration{1}) / period;
+    return last_vblank + frames * period;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_COMPOSITOR_FRAME_SCHEDULER_H_
+#define MIR_COMPOSITOR_FRAME_SCHEDULER_H_
+
+#include "mir/time/types.h"
+
+namespace mir
+{
+namespace compositor
+{
+
+/**
+ * Paces the frames of one DisplaySyncGroup against its vblanks.
+ *
+ * On platforms where post() waits for the page flip, the time it returns
+ * marks a vblank. From these the scheduler learns the refresh period and
+ * phase, and how long compositing takes, so that each frame can be started
+ * just in time for the next vblank. Starting late means client buffers that
+ * arrive in the meantime still make it to the screen, and the scene we
+ * sample is as fresh as possible when it is scanned out.
+ *
+ * Not thread safe; it belongs to a single compositing thread.
+ */
+class FrameScheduler
+{
+public:
+    FrameScheduler() = default;
+
+    /// Whether the refresh cycle is known well enough to pace frames
+    bool synchronised() const;
+
+    /// When to start compositing a frame that is ready to go at 'now'
+    time::Timestamp start_time(time::Timestamp now) const;
+
+    /**
+     * Records a frame that started compositing at 'started', finished
+     * rendering at 'rendered' and whose post() returned at 'posted'.
+     *
+     * 'continuous' means the frame was started without waiting for new
+     * work after the previous post(), so the gap between the two posts
+     * measures the refresh period.
+     *
+     * \returns how far past its target vblank the frame was posted, or
+     *          zero if it was on time (or we don't know the target).
+     */
+    time::Duration frame_posted(
+        time::Timestamp started,
+        time::Timestamp rendered,
+        time::Timestamp posted,
+        bool continuous);
+
+private:
+    /// The first predicted vblank at or after 't'
+    time::Timestamp next_vblank(time::Timestamp t) const;
+
+    time::Duration period{};
+    time::Timestamp last_vblank;
+    time::Duration render_time{};
+};
+
+}
+}
+
+#endif // MIR_COMPOSITOR_FRAME_SCHEDULER_H_
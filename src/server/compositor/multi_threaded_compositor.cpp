@@ -17,6 +17,7 @@
  */
 
 #include "multi_threaded_compositor.h"
+#include "frame_scheduler.h"
 #include "mir/graphics/display.h"
 #include "mir/graphics/display_buffer.h"
 #include "mir/compositor/display_buffer_compositor.h"
@@ -64,6 +65,7 @@ public:
         running{true},
         frames_scheduled{0},
         force_sleep{fixed_composite_delay},
+        pace_frames{fixed_composite_delay < std::chrono::milliseconds::zero()},
         display_listener{display_listener},
         report{report},
         started_future{started.get_future()}
@@ -115,9 +117,26 @@ public:
             std::unique_lock<std::mutex> lock{run_mutex};
             while (running)
             {
+                /*
+                 * If there's still work from the last frame we go straight on
+                 * to the next, and the time between posts is a refresh period.
+                 */
+                bool const continuous = frames_scheduled > 0;
+
                 /* Wait until compositing has been scheduled or we are stopped */
                 run_cv.wait(lock, [&]{ return (frames_scheduled > 0) || !running; });
 
+                /*
+                 * Frame pacing: start compositing as late as we can and still
+                 * make the next vblank. Buffers clients submit in the meantime
+                 * make it into this frame rather than the next.
+                 */
+                if (running && pace_frames)
+                {
+                    auto const start = scheduler.start_time(std::chrono::steady_clock::now());
+                    run_cv.wait_until(lock, start, [&]{ return !running; });
+                }
+
                 /*
                  * Check if we are running before compositing, since we may have
                  * been stopped while waiting for the run_cv above.
@@ -135,23 +154,36 @@ public:
                     not_posted_yet = false;
                     lock.unlock();
 
+                    auto const started = std::chrono::steady_clock::now();
                     for (auto& tuple : compositors)
                     {
                         auto& compositor = std::get<1>(tuple);
                         compositor->composite(scene->scene_elements_for(compositor.get()));
                     }
+                    auto const rendered = std::chrono::steady_clock::now();
                     group.post();
+                    auto const posted = std::chrono::steady_clock::now();
+
+                    auto const lateness = scheduler.frame_posted(started, rendered, posted, continuous);
+                    for (auto& tuple : compositors)
+                    {
+                        report->posted_frame(std::get<1>(tuple).get());
+                        if (lateness > lateness.zero())
+                            report->missed_deadline(std::get<1>(tuple).get(), lateness);
+                    }
 
                     /*
                      * "Predictive bypass" optimization: If the last frame was
                      * bypassed/overlayed or you simply have a fast GPU, it is
                      * beneficial to sleep for most of the next frame. This reduces
                      * the latency between snapshotting the scene and post()
-                     * completing by almost a whole frame.
+                     * completing by almost a whole frame. When we know when the
+                     * vblanks are, pacing the next frame does this for us.
                      */
-                    auto delay = force_sleep >= std::chrono::milliseconds::zero() ?
-                                 force_sleep : group.recommended_sleep();
-                    std::this_thread::sleep_for(delay);
+                    if (!pace_frames)
+                        std::this_thread::sleep_for(force_sleep);
+                    else if (!scheduler.synchronised())
+                        std::this_thread::sleep_for(group.recommended_sleep());
 
                     lock.lock();
 
@@ -237,6 +269,8 @@ private:
     bool running;
     int frames_scheduled;
     std::chrono::milliseconds force_sleep{-1};
+    bool const pace_frames;
+    FrameScheduler scheduler;
     std::mutex run_mutex;
     std::condition_variable run_cv;
     std::shared_ptr<DisplayListener> const display_listener;
@@ -17,11 +17,13 @@
  */
 
 #include "mir/geometry/rectangle.h"
+#include "mir/geometry/region.h"
 #include "mir/compositor/scene_element.h"
 #include "mir/graphics/renderable.h"
 #include "occlusion.h"
 
-#include <vector>
+#include <algorithm>
+#include <cmath>
 
 using namespace mir::geometry;
 using namespace mir::graphics;
@@ -29,37 +31,76 @@ using namespace mir::compositor;
 
 namespace
 {
+/*
+ * The screen area a renderable may draw to, or nothing if that's unknown.
+ * Transformations are applied about the centre of screen_position(), and as
+ * long as they leave z alone they're plain 2D affine transformations.
+ */
+bool bounds_of(Renderable const& renderable, Rectangle& bounds)
+{
+    static glm::mat4 const identity(1);
+
+    bounds = renderable.screen_position();
+
+    auto const transformation = renderable.transformation();
+    if (transformation == identity)
+        return true;
+
+    if (transformation[0][2] != 0 || transformation[1][2] != 0 || transformation[3][2] != 0 ||
+        transformation[0][3] != 0 || transformation[1][3] != 0 || transformation[3][3] != 1)
+        return false;  // Weirdly transformed. Assume never occluded.
+
+    auto const half_width = bounds.size.width.as_int() / 2.0f;
+    auto const half_height = bounds.size.height.as_int() / 2.0f;
+    glm::vec4 const centre{bounds.top_left.x.as_int() + half_width, bounds.top_left.y.as_int() + half_height, 0, 0};
+
+    auto left = INFINITY, right = -INFINITY, top = INFINITY, bottom = -INFINITY;
+    for (auto const& corner : {glm::vec4{-half_width, -half_height, 0, 1}, glm::vec4{half_width, -half_height, 0, 1},
+                               glm::vec4{-half_width, half_height, 0, 1}, glm::vec4{half_width, half_height, 0, 1}})
+    {
+        auto const p = transformation * corner + centre;
+        left = std::min(left, p.x);
+        right = std::max(right, p.x);
+        top = std::min(top, p.y);
+        bottom = std::max(bottom, p.y);
+    }
+
+    auto const x = static_cast<int>(std::floor(left));
+    auto const y = static_cast<int>(std::floor(top));
+    bounds = {{x, y}, {static_cast<int>(std::ceil(right)) - x, static_cast<int>(std::ceil(bottom)) - y}};
+    return true;
+}
+
 bool renderable_is_occluded(
     Renderable const& renderable, 
     Rectangle const& area,
-    std::vector<Rectangle>& coverage)
+    Region& coverage)
 {
     static glm::mat4 const identity(1);
     static Rectangle const empty{};
 
-    if (renderable.transformation() != identity)
-        return false;  // Weirdly transformed. Assume never occluded.
+    Rectangle window;
+    if (!bounds_of(renderable, window))
+        return false;
 
-    auto const& window = renderable.screen_position();
     auto const& clipped_window = window.intersection_with(area);
 
     if (clipped_window == empty)
         return true;  // Not in the area; definitely occluded.
 
-    bool occluded = false;
-    for (auto const& r : coverage)
+    // Covered by the union of everything above it, not just by any one window
+    if (coverage.contains(clipped_window))
+        return true;
+
+    if (renderable.transformation() == identity && renderable.alpha() == 1.0f)
     {
-        if (r.contains(clipped_window))
-        {
-            occluded = true;
-            break;
-        }
+        if (!renderable.shaped())
+            coverage.unite(clipped_window);
+        else
+            coverage.unite(renderable.opaque_region().intersect(clipped_window));
     }
 
-    if (!occluded && renderable.alpha() == 1.0f && !renderable.shaped())
-        coverage.push_back(clipped_window);
-
-    return occluded;
+    return false;
 }
 }
 
@@ -67,23 +108,18 @@ SceneElementSequence mir::compositor::filter_occlusions_from(
     SceneElementSequence& elements,
     Rectangle const& area)
 {
-    SceneElementSequence occluded;
-    std::vector<Rectangle> coverage;
+    Region coverage;
 
-    auto it = elements.rbegin();
-    while (it != elements.rend())
-    {
-        auto const renderable = (*it)->renderable();
-        if (renderable_is_occluded(*renderable, area, coverage))
-        {
-            occluded.insert(occluded.begin(), *it);
-            it = SceneElementSequence::reverse_iterator(elements.erase(std::prev(it.base())));
-        }
-        else
-        {
-            it++;
-        }
-    }
+    // Work top down, as only what's above a renderable can hide it
+    std::vector<bool> hidden(elements.size());
+    for (auto i = elements.size(); i-- != 0;)
+        hidden[i] = renderable_is_occluded(*elements[i]->renderable(), area, coverage);
+
+    SceneElementSequence occluded;
+    SceneElementSequence visible;
+    for (auto i = 0u; i != elements.size(); ++i)
+        (hidden[i] ? occluded : visible).push_back(elements[i]);
 
+    elements.swap(visible);
     return occluded;
 }
@@ -44,7 +44,10 @@ mir::DefaultServerConfiguration::the_connection_creator()
                 new_ipc_factory(session_authorizer),
                 session_authorizer,
                 the_graphics_platform()->make_ipc_operations(),
-                the_message_processor_report());
+                the_cookie_authority(),
+                the_message_processor_report(),
+                the_main_loop(),
+                std::chrono::milliseconds{the_options()->get<int>(options::input_batch_budget_opt)});
         });
 }
 
@@ -124,6 +127,7 @@ mir::DefaultServerConfiguration::the_prompt_connection_creator()
                 new_ipc_factory(session_authorizer),
                 session_authorizer,
                 the_graphics_platform()->make_ipc_operations(),
+                the_cookie_authority(),
                 the_message_processor_report());
         });
 }
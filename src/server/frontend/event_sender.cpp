@@ -18,6 +18,9 @@
 
 #include "event_sender.h"
 #include "mir/events/event.h"
+#include "mir/events/input_event.h"
+#include "mir/events/resize_event.h"
+#include "mir/cookie/authority.h"
 #include "mir/frontend/client_constants.h"
 #include "mir/graphics/display_configuration.h"
 #include "mir/variable_length_array.h"
@@ -32,6 +35,8 @@
 
 #include "mir/graphics/buffer.h"
 #include "mir/client_visible_error.h"
+#include "mir/time/alarm.h"
+#include "mir/time/alarm_factory.h"
 
 #include "mir_protobuf_wire.pb.h"
 #include "mir_protobuf.pb.h"
@@ -42,23 +47,137 @@ namespace mev = mir::events;
 namespace mp = mir::protobuf;
 namespace mi = mir::input;
 
+namespace
+{
+// A client that has fallen behind only needs the latest of these
+bool is_transient(MirEvent const* event, uint64_t& supersede_key)
+{
+    switch (mir_event_get_type(event))
+    {
+    case mir_event_type_input:
+    {
+        // Motion carries relative movement as well as a position, so queued
+        // motion may be dropped for a slow client but is not superseded
+        auto const input_event = mir_event_get_input_event(event);
+        supersede_key = 0;
+        return mir_input_event_get_type(input_event) == mir_input_event_type_pointer &&
+            mir_pointer_event_action(mir_input_event_get_pointer_event(input_event)) == mir_pointer_action_motion;
+    }
+    case mir_event_type_resize:
+        supersede_key = (static_cast<uint64_t>(mir_event_type_resize) << 32) | static_cast<uint32_t>(event->to_resize()->surface_id());
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Events that are soon followed by others, so can wait to go out with them
+bool is_motion(MirEvent const* event)
+{
+    if (mir_event_get_type(event) != mir_event_type_input)
+        return false;
+
+    auto const input_event = mir_event_get_input_event(event);
+    switch (mir_input_event_get_type(input_event))
+    {
+    case mir_input_event_type_pointer:
+        return mir_pointer_event_action(mir_input_event_get_pointer_event(input_event)) == mir_pointer_action_motion;
+    case mir_input_event_type_touch:
+    {
+        auto const touch_event = mir_input_event_get_touch_event(input_event);
+        for (auto i = 0u; i != mir_touch_event_point_count(touch_event); ++i)
+        {
+            if (mir_touch_event_action(touch_event, i) != mir_touch_action_change)
+                return false;
+        }
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+// Keeps a stream of motion that never pauses from being held back indefinitely
+int const max_batched_events{64};
+}
+
 mfd::EventSender::EventSender(
     std::shared_ptr<MessageSender> const& socket_sender,
-    std::shared_ptr<mg::PlatformIpcOperations> const& buffer_packer) :
+    std::shared_ptr<mg::PlatformIpcOperations> const& buffer_packer,
+    std::shared_ptr<mir::cookie::Authority> const& cookie_authority) :
+    EventSender(socket_sender, buffer_packer, cookie_authority, nullptr, std::chrono::milliseconds{0})
+{
+}
+
+mfd::EventSender::EventSender(
+    std::shared_ptr<MessageSender> const& socket_sender,
+    std::shared_ptr<mg::PlatformIpcOperations> const& buffer_packer,
+    std::shared_ptr<mir::cookie::Authority> const& cookie_authority,
+    std::shared_ptr<mir::time::AlarmFactory> const& alarm_factory,
+    std::chrono::milliseconds input_batch_budget) :
     sender(socket_sender),
-    buffer_packer(buffer_packer)
+    buffer_packer(buffer_packer),
+    cookie_authority(cookie_authority),
+    input_batch_budget(input_batch_budget),
+    batch(std::make_unique<mp::EventSequence>())
 {
+    if (alarm_factory && input_batch_budget > std::chrono::milliseconds{0})
+    {
+        flush_alarm = alarm_factory->create_alarm(
+            [this]
+            {
+                std::lock_guard<std::mutex> lock{batch_mutex};
+                send_batch_locked(lock);
+            });
+    }
 }
 
+mfd::EventSender::~EventSender() = default;
+
 void mfd::EventSender::handle_event(EventUPtr&& event)
 {
-    // In future we might send multiple events, or insert them into messages
-    // containing other responses, but for now we send them individually.
+    // Input events are built without cookies, as most consumers never ask for
+    // them. A client might, so sign any event that should have one here.
+    if (mir_event_get_type(event.get()) == mir_event_type_input)
+    {
+        auto const input_event = event->to_input();
+        if (mir_input_event_has_cookie(input_event) && input_event->cookie().empty())
+        {
+            auto const cookie = cookie_authority->make_cookie(mir_input_event_get_event_time(input_event));
+            input_event->set_cookie(cookie->serialize());
+        }
+    }
+
+    // Unless input is batched, each event goes out in a message of its own
+    if (flush_alarm)
+    {
+        std::lock_guard<std::mutex> lock{batch_mutex};
+
+        uint64_t supersede_key;
+        batch_is_transient = batch_is_transient && is_transient(event.get(), supersede_key) && !supersede_key;
+        batch->add_event()->set_raw(MirEvent::serialize(event.get()));
+
+        if (is_motion(event.get()) && batch->event_size() < max_batched_events)
+        {
+            if (batch->event_size() == 1)
+                flush_alarm->reschedule_in(input_batch_budget);
+            return;
+        }
+
+        // Anything else goes out now, taking the motion before it along
+        send_batch_locked(lock);
+        return;
+    }
+
     mp::EventSequence seq;
     mp::Event *ev = seq.add_event();
     ev->set_raw(MirEvent::serialize(event.get()));
 
-    send_event_sequence(seq, {});
+    uint64_t supersede_key;
+    if (is_transient(event.get(), supersede_key))
+        send_event_sequence(seq, {}, true, supersede_key);
+    else
+        send_event_sequence(seq, {});
 }
 
 void mfd::EventSender::handle_display_config_change(
@@ -101,7 +220,34 @@ void mfd::EventSender::handle_input_config_change(MirInputConfig const& config)
     send_event_sequence(seq, {});
 }
 
-void mfd::EventSender::send_event_sequence(mp::EventSequence& seq, FdSets const& fds)
+void mfd::EventSender::send_event_sequence(
+    mp::EventSequence& seq, FdSets const& fds, bool transient, uint64_t supersede_key)
+{
+    if (flush_alarm)
+    {
+        // Held back input still goes out ahead of what follows it
+        std::lock_guard<std::mutex> lock{batch_mutex};
+        send_batch_locked(lock);
+        send_now(seq, fds, transient, supersede_key);
+    }
+    else
+    {
+        send_now(seq, fds, transient, supersede_key);
+    }
+}
+
+void mfd::EventSender::send_batch_locked(std::lock_guard<std::mutex> const&)
+{
+    if (batch->event_size() == 0)
+        return;
+
+    send_now(*batch, {}, batch_is_transient, 0);
+    batch->Clear();
+    batch_is_transient = true;
+}
+
+void mfd::EventSender::send_now(
+    mp::EventSequence& seq, FdSets const& fds, bool transient, uint64_t supersede_key)
 {
     mir::VariableLengthArray<frontend::serialization_buffer_size>
         send_buffer{static_cast<size_t>(seq.ByteSize())};
@@ -115,7 +261,10 @@ void mfd::EventSender::send_event_sequence(mp::EventSequence& seq, FdSets const&
 
     try
     {
-        sender->send(reinterpret_cast<char*>(send_buffer.data()), send_buffer.size(), fds);
+        if (transient)
+            sender->send_transient(reinterpret_cast<char*>(send_buffer.data()), send_buffer.size(), supersede_key);
+        else
+            sender->send(reinterpret_cast<char*>(send_buffer.data()), send_buffer.size(), fds);
     }
     catch (std::exception const& error)
     {
@@ -21,11 +21,16 @@
 
 #include "mir/frontend/event_sink.h"
 #include "mir/frontend/fd_sets.h"
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 
 namespace mir
 {
 namespace graphics { class PlatformIpcOperations; }
+namespace cookie { class Authority; }
+namespace time { class Alarm; class AlarmFactory; }
 namespace protobuf
 {
 class EventSequence;
@@ -42,7 +47,18 @@ class EventSender : public  mir::frontend::EventSink
 public:
     explicit EventSender(
         std::shared_ptr<MessageSender> const& socket_sender,
-        std::shared_ptr<graphics::PlatformIpcOperations> const& buffer_packer);
+        std::shared_ptr<graphics::PlatformIpcOperations> const& buffer_packer,
+        std::shared_ptr<cookie::Authority> const& cookie_authority);
+    /// Holds pointer and touch motion back for up to input_batch_budget, to go
+    /// out in one message with whatever input follows
+    EventSender(
+        std::shared_ptr<MessageSender> const& socket_sender,
+        std::shared_ptr<graphics::PlatformIpcOperations> const& buffer_packer,
+        std::shared_ptr<cookie::Authority> const& cookie_authority,
+        std::shared_ptr<time::AlarmFactory> const& alarm_factory,
+        std::chrono::milliseconds input_batch_budget);
+    ~EventSender();
+
     void handle_event(EventUPtr&& event) override;
     void handle_lifecycle_event(MirLifecycleState state) override;
     void handle_display_config_change(graphics::DisplayConfiguration const& config) override;
@@ -55,11 +71,21 @@ public:
     void update_buffer(graphics::Buffer&) override;
 
 private:
-    void send_event_sequence(protobuf::EventSequence&, FdSets const&);
+    void send_event_sequence(
+        protobuf::EventSequence&, FdSets const&, bool transient = false, uint64_t supersede_key = 0);
+    void send_now(protobuf::EventSequence&, FdSets const&, bool transient, uint64_t supersede_key);
+    void send_batch_locked(std::lock_guard<std::mutex> const&);
     void send_buffer(protobuf::EventSequence&, graphics::Buffer&, graphics::BufferIpcMsgType);
 
     std::shared_ptr<MessageSender> const sender;
     std::shared_ptr<graphics::PlatformIpcOperations> const buffer_packer;
+    std::shared_ptr<cookie::Authority> const cookie_authority;
+
+    std::chrono::milliseconds const input_batch_budget;
+    std::mutex batch_mutex;
+    std::unique_ptr<protobuf::EventSequence> const batch;
+    bool batch_is_transient{true};
+    std::unique_ptr<time::Alarm> flush_alarm;
 };
 
 }
@@ -20,6 +20,7 @@
 
 #include "mir/frontend/fd_sets.h"
 
+#include <cstdint>
 #include <sys/types.h>
 
 namespace mir
@@ -31,6 +32,18 @@ class MessageSender
 public:
     virtual void send(char const* data, size_t length, FdSets const& fds) = 0;
 
+    /**
+     * Send a message that only matters until the client catches up.
+     *
+     * While it waits behind a slow client it may be dropped, and a later
+     * message with the same non-zero supersede_key replaces it.
+     */
+    virtual void send_transient(char const* data, size_t length, uint64_t supersede_key)
+    {
+        (void)supersede_key;
+        send(data, length, {});
+    }
+
 protected:
     MessageSender() = default;
     virtual ~MessageSender() = default;
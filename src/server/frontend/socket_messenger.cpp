@@ -25,8 +25,12 @@
 #include <boost/throw_exception.hpp>
 
 #include <errno.h>
+#include <poll.h>
 #include <string.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <functional>
 #include <stdexcept>
 
 namespace mf = mir::frontend;
@@ -34,15 +38,44 @@ namespace mfd = mf::detail;
 namespace bs = boost::system;
 namespace ba = boost::asio;
 
-mfd::SocketMessenger::SocketMessenger(std::shared_ptr<ba::local::stream_protocol::socket> const& socket)
+namespace
+{
+bool can_write_to(int socket_fd)
+{
+    pollfd writable{socket_fd, POLLOUT, 0};
+    return poll(&writable, 1, 0) == 1 && (writable.revents & POLLOUT);
+}
+
+// The caller's fds need only last for the call, so queued ones are duplicated
+mf::FdSets duplicate(mf::FdSets const& fd_sets)
+{
+    mf::FdSets duplicates;
+    for (auto const& fds : fd_sets)
+    {
+        duplicates.emplace_back();
+        for (auto const& fd : fds)
+        {
+            auto const duplicate_fd = dup(fd);
+            if (duplicate_fd < 0)
+                BOOST_THROW_EXCEPTION(std::runtime_error("Failed to duplicate fd: " + std::string(strerror(errno))));
+            duplicates.back().emplace_back(duplicate_fd);
+        }
+    }
+    return duplicates;
+}
+}
+
+mfd::SocketMessenger::SocketMessenger(
+    std::shared_ptr<ba::local::stream_protocol::socket> const& socket,
+    size_t max_queued_bytes)
     : socket(socket),
-      socket_fd{IntOwnedFd{socket->native_handle()}}
+      socket_fd{IntOwnedFd{socket->native_handle()}},
+      max_queued_bytes{max_queued_bytes}
 {
     // Make the socket non-blocking to avoid hanging the server when a client
-    // is unresponsive. Also increase the send buffer size to 64KiB to allow
-    // more leeway for transient client freezes.
+    // is unresponsive: what the socket won't take is queued. Also increase the
+    // send buffer size to 64KiB to allow more leeway for transient client freezes.
     // See https://bugs.launchpad.net/mir/+bug/1350207
-    // TODO: Rework the messenger to support asynchronous sends
     socket->non_blocking(true);
     boost::asio::socket_base::send_buffer_size option(64*1024);
     socket->set_option(option);
@@ -73,6 +106,27 @@ mf::SessionCredentials mfd::SocketMessenger::client_creds()
 
 void mfd::SocketMessenger::send(char const* data, size_t length, FdSets const& fd_set)
 {
+    std::lock_guard<std::mutex> lg(message_lock);
+    send_locked(lg, data, length, fd_set, false, 0);
+}
+
+void mfd::SocketMessenger::send_transient(char const* data, size_t length, uint64_t supersede_key)
+{
+    std::lock_guard<std::mutex> lg(message_lock);
+    send_locked(lg, data, length, {}, true, supersede_key);
+}
+
+void mfd::SocketMessenger::send_locked(
+    std::lock_guard<std::mutex> const& lg,
+    char const* data,
+    size_t length,
+    FdSets const& fd_set,
+    bool transient,
+    uint64_t supersede_key)
+{
+    if (disconnected)
+        return;
+
     static size_t const header_size{2};
     mir::VariableLengthArray<mf::serialization_buffer_size> whole_message{header_size + length};
 
@@ -80,17 +134,161 @@ void mfd::SocketMessenger::send(char const* data, size_t length, FdSets const& f
     whole_message.data()[1] = static_cast<unsigned char>((length >> 0) & 0xff);
     std::copy(data, data + length, whole_message.data() + header_size);
 
-    std::unique_lock<std::mutex> lg(message_lock);
+    auto const message_begin = reinterpret_cast<char const*>(whole_message.data());
+    auto const message_end = message_begin + whole_message.size();
+
+    // Messages must arrive in the order they are sent (the fds of a message
+    // right after its data), so only the first in line goes straight out
+    if (queue.empty())
+    {
+        QueuedMessage message{{}, 0, {}, 0, transient, supersede_key};
+        message.fds = fd_set;
+
+        bs::error_code error;
+        auto bytes_written = socket->write_some(ba::buffer(message_begin, whole_message.size()), error);
+        if (error == ba::error::would_block)
+            bytes_written = 0;
+        else if (error)
+            BOOST_THROW_EXCEPTION(bs::system_error(error));
+
+        if (bytes_written == whole_message.size())
+        {
+            if (write_out_locked(lg, message))
+                return;
+        }
+        else
+        {
+            // Half a message can't be taken back
+            message.transient = message.transient && bytes_written == 0;
+            message.data.assign(message_begin + bytes_written, message_end);
+        }
+
+        message.fds = duplicate(FdSets(message.fds.begin() + message.fd_sets_sent, message.fds.end()));
+        message.fd_sets_sent = 0;
+        enqueue_locked(lg, std::move(message));
+    }
+    else
+    {
+        enqueue_locked(lg, QueuedMessage{
+            {message_begin, message_end}, 0, duplicate(fd_set), 0, transient, supersede_key});
+    }
+}
+
+bool mfd::SocketMessenger::write_out_locked(std::lock_guard<std::mutex> const&, QueuedMessage& message)
+{
+    while (message.bytes_sent < message.data.size())
+    {
+        bs::error_code error;
+        auto const bytes_written = socket->write_some(
+            ba::buffer(message.data.data() + message.bytes_sent, message.data.size() - message.bytes_sent),
+            error);
+
+        if (error == ba::error::would_block)
+            return false;
+        else if (error)
+            BOOST_THROW_EXCEPTION(bs::system_error(error));
+
+        message.bytes_sent += bytes_written;
+    }
+
+    while (message.fd_sets_sent < message.fds.size())
+    {
+        if (!can_write_to(socket_fd))
+            return false;
+
+        mir::send_fds(socket_fd, message.fds[message.fd_sets_sent]);
+        ++message.fd_sets_sent;
+    }
+
+    return true;
+}
+
+void mfd::SocketMessenger::enqueue_locked(std::lock_guard<std::mutex> const& lg, QueuedMessage&& message)
+{
+    auto const drop_queued = [this](std::function<bool(QueuedMessage const&)> const& unwanted)
+        {
+            auto const first_dropped = std::remove_if(queue.begin(), queue.end(),
+                [&](QueuedMessage const& queued)
+                {
+                    if (!queued.transient || queued.bytes_sent != 0 || !unwanted(queued))
+                        return false;
+
+                    queued_bytes -= queued.data.size();
+                    return true;
+                });
+            queue.erase(first_dropped, queue.end());
+        };
+
+    if (message.transient && message.supersede_key)
+    {
+        auto const key = message.supersede_key;
+        drop_queued([key](QueuedMessage const& queued) { return queued.supersede_key == key; });
+    }
+
+    queued_bytes += message.data.size();
+    queue.push_back(std::move(message));
+
+    if (queued_bytes > max_queued_bytes)
+        drop_queued([](QueuedMessage const&) { return true; });
+
+    if (queued_bytes > max_queued_bytes)
+    {
+        // The client has stopped reading: cutting it off ends its session
+        // rather than letting it hold on to ever more of our memory
+        queue.clear();
+        queued_bytes = 0;
+        disconnected = true;
+
+        bs::error_code ignored;
+        socket->shutdown(ba::socket_base::shutdown_both, ignored);
+        return;
+    }
+
+    wait_for_client_locked(lg);
+}
+
+void mfd::SocketMessenger::wait_for_client_locked(std::lock_guard<std::mutex> const&)
+{
+    if (waiting_for_client || queue.empty())
+        return;
+
+    waiting_for_client = true;
+
+    std::weak_ptr<SocketMessenger> const weak_this{shared_from_this()};
+    socket->async_write_some(
+        ba::null_buffers(),
+        [weak_this](bs::error_code const& error, size_t)
+        {
+            if (auto const self = weak_this.lock())
+                self->on_client_ready(error);
+        });
+}
+
+void mfd::SocketMessenger::on_client_ready(bs::error_code const& error)
+{
+    std::lock_guard<std::mutex> lg(message_lock);
+    waiting_for_client = false;
+
+    try
+    {
+        if (error)
+            BOOST_THROW_EXCEPTION(bs::system_error(error));
 
-    // TODO: This should be asynchronous, but we are not making sure
-    // that a potential call to send_fds is executed _after_ this
-    // function has completed (if it would be executed asynchronously.
-    // NOTE: we rely on this synchronous behavior as per the comment in
-    // mf::SessionMediator::create_surface
-    ba::write(*socket, ba::buffer(whole_message.data(), whole_message.size()));
+        while (!queue.empty() && write_out_locked(lg, queue.front()))
+        {
+            queued_bytes -= queue.front().data.size();
+            queue.pop_front();
+        }
+    }
+    catch (std::exception const&)
+    {
+        // The client has gone: reading from the socket will notice and end the session
+        queue.clear();
+        queued_bytes = 0;
+        return;
+    }
 
-    for (auto const& fds : fd_set)
-        mir::send_fds(socket_fd, fds);
+    wait_for_client_locked(lg);
 }
 
 void mfd::SocketMessenger::async_receive_msg(
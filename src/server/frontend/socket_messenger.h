@@ -21,7 +21,11 @@
 #include "message_sender.h"
 #include "message_receiver.h"
 #include "mir/frontend/session_credentials.h"
+
+#include <deque>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 namespace mir
 {
@@ -29,13 +33,25 @@ namespace frontend
 {
 namespace detail
 {
+/**
+ * Sends without blocking: whatever the socket won't take at once waits in a
+ * queue that is written out as the client reads. A client that lets the
+ * queue grow past max_queued_bytes first loses its transient messages and
+ * then, if that is not enough, is disconnected.
+ */
 class SocketMessenger : public MessageSender,
-                        public MessageReceiver
+                        public MessageReceiver,
+                        public std::enable_shared_from_this<SocketMessenger>
 {
 public:
-    SocketMessenger(std::shared_ptr<boost::asio::local::stream_protocol::socket> const& socket);
+    static size_t const default_max_queued_bytes{1024*1024};
+
+    SocketMessenger(
+        std::shared_ptr<boost::asio::local::stream_protocol::socket> const& socket,
+        size_t max_queued_bytes = default_max_queued_bytes);
 
     void send(char const* data, size_t length, FdSets const& fds) override;
+    void send_transient(char const* data, size_t length, uint64_t supersede_key) override;
 
     void async_receive_msg(MirReadHandler const& handler, boost::asio::mutable_buffers_1 const& buffer) override;
     boost::system::error_code receive_msg(boost::asio::mutable_buffers_1 const& buffer) override;
@@ -48,10 +64,32 @@ private:
     void update_session_creds();
     SessionCredentials creator_creds() const;
 
+    struct QueuedMessage
+    {
+        std::vector<char> data;
+        size_t bytes_sent;
+        FdSets fds;
+        size_t fd_sets_sent;
+        bool transient;
+        uint64_t supersede_key;
+    };
+
+    void send_locked(std::lock_guard<std::mutex> const&,
+        char const* data, size_t length, FdSets const& fds, bool transient, uint64_t supersede_key);
+    bool write_out_locked(std::lock_guard<std::mutex> const&, QueuedMessage& message);
+    void enqueue_locked(std::lock_guard<std::mutex> const&, QueuedMessage&& message);
+    void wait_for_client_locked(std::lock_guard<std::mutex> const&);
+    void on_client_ready(boost::system::error_code const& error);
+
     std::shared_ptr<boost::asio::local::stream_protocol::socket> socket;
     mir::Fd socket_fd;
+    size_t const max_queued_bytes;
 
     std::mutex message_lock;
+    std::deque<QueuedMessage> queue;
+    size_t queued_bytes{0};
+    bool waiting_for_client{false};
+    bool disconnected{false};
     SessionCredentials session_creds{0, 0, 0};
 };
 }
@@ -24,6 +24,7 @@
 #include "mir/optional_value.h"
 
 #include <wayland-server-core.h>
+#include <chrono>
 #include <unordered_map>
 #include <thread>
 #include <vector>
@@ -97,7 +98,8 @@ public:
         std::shared_ptr<SessionAuthorizer> const& session_authorizer,
         bool arw_socket,
         std::unique_ptr<WaylandExtensions> extensions,
-        WaylandProtocolExtensionFilter const& extension_filter);
+        WaylandProtocolExtensionFilter const& extension_filter,
+        std::chrono::milliseconds input_batch_budget = std::chrono::milliseconds{0});
 
     ~WaylandConnector() override;
 
@@ -151,7 +151,8 @@ std::shared_ptr<mf::Connector>
                 the_session_authorizer(),
                 arw_socket,
                 configure_wayland_extensions(wayland_extensions, options->is_set(mo::x11_display_opt), wayland_extension_hooks),
-                wayland_filter);
+                wayland_filter,
+                std::chrono::milliseconds{options->get<int>(mo::input_batch_budget_opt)});
         });
 }
 
@@ -53,16 +53,22 @@ struct NullCursor : mf::WlPointer::Cursor
 
 mf::WlPointer::WlPointer(
     wl_resource* new_resource,
-    std::function<void(WlPointer*)> const& on_destroy)
+    std::function<void(WlPointer*)> const& on_destroy,
+    std::chrono::milliseconds input_batch_budget)
     : Pointer(new_resource),
       display{wl_client_get_display(client)},
       on_destroy{on_destroy},
+      input_batch_budget{input_batch_budget},
       cursor{std::make_unique<NullCursor>()}
 {
+    if (input_batch_budget > std::chrono::milliseconds::zero())
+        flush_timer = wl_event_loop_add_timer(wl_display_get_event_loop(display), &on_flush_timer, this);
 }
 
 mf::WlPointer::~WlPointer()
 {
+    if (flush_timer)
+        wl_event_source_remove(flush_timer);
     if (focused_surface)
         focused_surface.value()->remove_destroy_listener(this);
     on_destroy(this);
@@ -70,7 +76,43 @@ mf::WlPointer::~WlPointer()
 
 void mf::WlPointer::handle_event(MirPointerEvent const* event, WlSurface* surface)
 {
-    switch(mir_pointer_event_action(event))
+    auto const action = mir_pointer_event_action(event);
+
+    if (flush_timer && action == mir_pointer_action_motion)
+    {
+        auto const point = Point{
+            mir_pointer_event_axis_value(event, mir_pointer_axis_x),
+            mir_pointer_event_axis_value(event, mir_pointer_axis_y)};
+        auto const transformed = surface->transform_point(point);
+
+        // Motion within the focused surface merges into one frame; crossing
+        // into another surface needs enter/leave, so goes out as it arrives
+        if (focused_surface && transformed.surface == focused_surface.value())
+        {
+            auto const timestamp = mir_input_event_get_event_time_ms(mir_pointer_event_input_event(event));
+            auto const hscroll = mir_pointer_event_axis_value(event, mir_pointer_axis_hscroll) * 10;
+            auto const vscroll = mir_pointer_event_axis_value(event, mir_pointer_axis_vscroll) * 10;
+
+            if (pending_motion)
+            {
+                pending_motion.value().timestamp = timestamp;
+                pending_motion.value().position = transformed.position;
+                pending_motion.value().hscroll += hscroll;
+                pending_motion.value().vscroll += vscroll;
+            }
+            else
+            {
+                pending_motion = PendingMotion{timestamp, transformed.position, hscroll, vscroll};
+                wl_event_source_timer_update(flush_timer, input_batch_budget.count());
+            }
+            return;
+        }
+    }
+
+    // Anything else must not overtake the motion that preceded it
+    send_pending_motion();
+
+    switch(action)
     {
         case mir_pointer_action_button_down:
         case mir_pointer_action_button_up:
@@ -205,6 +247,7 @@ void mf::WlPointer::handle_leave()
 {
     if (!focused_surface)
         return;
+    send_pending_motion();
     focused_surface.value()->remove_destroy_listener(this);
     auto const serial = wl_display_next_serial(display);
     send_leave_event(
@@ -220,6 +263,45 @@ void mf::WlPointer::handle_frame()
         send_frame_event();
 }
 
+void mf::WlPointer::send_pending_motion()
+{
+    if (!pending_motion)
+        return;
+
+    auto const motion = pending_motion.value();
+    pending_motion = std::experimental::nullopt;
+    wl_event_source_timer_update(flush_timer, 0);
+
+    bool needs_frame = false;
+    if (!last_position || motion.position != last_position.value())
+    {
+        send_motion_event(motion.timestamp, motion.position.x.as_int(), motion.position.y.as_int());
+        last_position = motion.position;
+        needs_frame = true;
+    }
+
+    if (motion.hscroll != 0)
+    {
+        send_axis_event(motion.timestamp, Axis::horizontal_scroll, motion.hscroll);
+        needs_frame = true;
+    }
+
+    if (motion.vscroll != 0)
+    {
+        send_axis_event(motion.timestamp, Axis::vertical_scroll, motion.vscroll);
+        needs_frame = true;
+    }
+
+    if (needs_frame)
+        handle_frame();
+}
+
+int mf::WlPointer::on_flush_timer(void* data)
+{
+    static_cast<WlPointer*>(data)->send_pending_motion();
+    return 0;
+}
+
 namespace
 {
 struct WlStreamCursor : mf::WlPointer::Cursor
@@ -23,6 +23,7 @@
 
 #include "wayland_wrapper.h"
 
+#include <chrono>
 #include <functional>
 
 struct MirInputEvent;
@@ -45,7 +46,8 @@ public:
 
     WlPointer(
         wl_resource* new_resource,
-        std::function<void(WlPointer*)> const& on_destroy);
+        std::function<void(WlPointer*)> const& on_destroy,
+        std::chrono::milliseconds input_batch_budget = std::chrono::milliseconds{0});
 
     ~WlPointer();
 
@@ -61,9 +63,23 @@ private:
     std::experimental::optional<mir::geometry::Point> last_position;
     std::experimental::optional<WlSurface*> focused_surface;
 
+    /// Motion within the focused surface held back for up to input_batch_budget
+    struct PendingMotion
+    {
+        uint32_t timestamp;
+        mir::geometry::Point position;
+        double hscroll;
+        double vscroll;
+    };
+    std::chrono::milliseconds const input_batch_budget;
+    std::experimental::optional<PendingMotion> pending_motion;
+    wl_event_source* flush_timer{nullptr};
+
     void handle_enter(mir::geometry::Point position, WlSurface* surface);
     void handle_leave();
     void handle_frame();
+    void send_pending_motion();
+    static int on_flush_timer(void* data);
 
     void set_cursor(uint32_t serial, std::experimental::optional<wl_resource*> const& surface, int32_t hotspot_x, int32_t hotspot_y) override;
     void release() override;
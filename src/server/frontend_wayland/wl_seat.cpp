@@ -157,7 +157,8 @@ mf::WlSeat::WlSeat(
     wl_display* display,
     std::shared_ptr<mi::InputDeviceHub> const& input_hub,
     std::shared_ptr<mi::Seat> const& seat,
-    std::shared_ptr<mir::Executor> const& executor)
+    std::shared_ptr<mir::Executor> const& executor,
+    std::chrono::milliseconds input_batch_budget)
     :   Global(display, 5),
         keymap{std::make_unique<input::Keymap>()},
         config_observer{
@@ -172,7 +173,8 @@ mf::WlSeat::WlSeat(
         touch_listeners{std::make_shared<ListenerList<WlTouch>>()},
         input_hub{input_hub},
         seat{seat},
-        executor{executor}
+        executor{executor},
+        input_batch_budget{input_batch_budget}
 {
     input_hub->add_observer(config_observer);
 }
@@ -237,7 +239,8 @@ void mf::WlSeat::Instance::get_pointer(wl_resource* new_pointer)
             [listeners = seat->pointer_listeners, client = client](WlPointer* listener)
             {
                 listeners->unregister_listener(client, listener);
-            }});
+            },
+            seat->input_batch_budget});
 }
 
 void mf::WlSeat::Instance::get_keyboard(wl_resource* new_keyboard)
@@ -288,7 +291,8 @@ void mf::WlSeat::Instance::get_touch(wl_resource* new_touch)
             [listeners = seat->touch_listeners, client = client](WlTouch* listener)
             {
                 listeners->unregister_listener(client, listener);
-            }});
+            },
+            seat->input_batch_budget});
 }
 
 void mf::WlSeat::Instance::release()
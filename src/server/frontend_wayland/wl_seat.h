@@ -21,6 +21,7 @@
 
 #include "wayland_wrapper.h"
 
+#include <chrono>
 #include <unordered_map>
 #include <vector>
 #include <functional>
@@ -54,7 +55,8 @@ public:
         wl_display* display,
         std::shared_ptr<mir::input::InputDeviceHub> const& input_hub,
         std::shared_ptr<mir::input::Seat> const& seat,
-        std::shared_ptr<mir::Executor> const& executor);
+        std::shared_ptr<mir::Executor> const& executor,
+        std::chrono::milliseconds input_batch_budget = std::chrono::milliseconds{0});
 
     ~WlSeat();
 
@@ -103,6 +105,9 @@ private:
 
     std::shared_ptr<mir::Executor> const executor;
 
+    /// How long pointer and touch motion may be held back to merge with what follows
+    std::chrono::milliseconds const input_batch_budget;
+
     void bind(wl_resource* new_wl_seat) override;
 
 };
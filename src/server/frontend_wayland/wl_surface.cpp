@@ -38,10 +38,31 @@
 #include "mir/log.h"
 
 #include <algorithm>
+#include <cstdint>
 
 namespace mf = mir::frontend;
 namespace geom = mir::geometry;
 
+namespace
+{
+// Clients commonly damage {0, 0, INT32_MAX, INT32_MAX}, so avoid overflow
+auto clip_to(geom::Size const& size, int32_t x, int32_t y, int32_t width, int32_t height)
+    -> std::experimental::optional<geom::Rectangle>
+{
+    auto const left = std::max<int64_t>(x, 0);
+    auto const top = std::max<int64_t>(y, 0);
+    auto const right = std::min<int64_t>(int64_t{x} + width, size.width.as_int());
+    auto const bottom = std::min<int64_t>(int64_t{y} + height, size.height.as_int());
+
+    if (right <= left || bottom <= top)
+        return {};
+
+    return geom::Rectangle{
+        {static_cast<int>(left), static_cast<int>(top)},
+        {static_cast<int>(right - left), static_cast<int>(bottom - top)}};
+}
+}
+
 mf::WlSurfaceState::Callback::Callback(wl_resource* new_resource)
     : wayland::Callback{new_resource},
       destroyed{deleted_flag_for_resource(resource)}
@@ -59,10 +80,16 @@ void mf::WlSurfaceState::update_from(WlSurfaceState const& source)
     if (source.input_shape)
         input_shape = source.input_shape;
 
+    if (source.opaque_region)
+        opaque_region = source.opaque_region;
+
     frame_callbacks.insert(end(frame_callbacks),
                            begin(source.frame_callbacks),
                            end(source.frame_callbacks));
 
+    surface_damage.insert(end(surface_damage), begin(source.surface_damage), end(source.surface_damage));
+    buffer_damage.insert(end(buffer_damage), begin(source.buffer_damage), end(source.buffer_damage));
+
     if (source.surface_data_invalidated)
         surface_data_invalidated = true;
 }
@@ -71,6 +98,7 @@ bool mf::WlSurfaceState::surface_data_needs_refresh() const
 {
     return offset ||
            input_shape ||
+           opaque_region ||
            surface_data_invalidated;
 }
 
@@ -176,7 +204,7 @@ void mf::WlSurface::populate_surface_data(std::vector<shell::StreamSpecification
 {
     geometry::Displacement offset = parent_offset + offset_;
 
-    buffer_streams.push_back({stream_id, offset, {}});
+    buffer_streams.push_back({stream_id, offset, {}, opaque_region});
     geom::Rectangle surface_rect = {geom::Point{} + offset, buffer_size_.value_or(geom::Size{})};
     if (input_shape)
     {
@@ -248,20 +276,37 @@ void mf::WlSurface::attach(std::experimental::optional<wl_resource*> const& buff
 
 void mf::WlSurface::damage(int32_t x, int32_t y, int32_t width, int32_t height)
 {
-    (void)x;
-    (void)y;
-    (void)width;
-    (void)height;
-    // This isn't essential, but could enable optimizations
+    // Clipping needs the size of the buffer, which may not be attached yet
+    pending.surface_damage.push_back({{x, y}, {width, height}});
 }
 
 void mf::WlSurface::damage_buffer(int32_t x, int32_t y, int32_t width, int32_t height)
 {
-    (void)x;
-    (void)y;
-    (void)width;
-    (void)height;
-    // This isn't essential, but could enable optimizations
+    pending.buffer_damage.push_back({{x, y}, {width, height}});
+}
+
+auto mf::WlSurface::damage_in_buffer_coordinates(WlSurfaceState const& state, geom::Size const& buffer_size) const
+    -> std::vector<geom::Rectangle>
+{
+    std::vector<geom::Rectangle> damage;
+
+    // As we don't (yet) support buffer scale or transform, surface and buffer
+    // coordinates coincide.
+    for (auto const* const source : {&state.surface_damage, &state.buffer_damage})
+    {
+        for (auto const& rect : *source)
+        {
+            if (auto const clipped = clip_to(
+                    buffer_size,
+                    rect.top_left.x.as_int(), rect.top_left.y.as_int(),
+                    rect.size.width.as_int(), rect.size.height.as_int()))
+            {
+                damage.push_back(clipped.value());
+            }
+        }
+    }
+
+    return damage;
 }
 
 void mf::WlSurface::frame(wl_resource* new_callback)
@@ -271,8 +316,10 @@ void mf::WlSurface::frame(wl_resource* new_callback)
 
 void mf::WlSurface::set_opaque_region(std::experimental::optional<wl_resource*> const& region)
 {
-    (void)region;
-    // This isn't essential, but could enable optimizations
+    if (region)
+        pending.opaque_region = WlRegion::from(region.value())->rectangle_vector();
+    else
+        pending.opaque_region = std::vector<geom::Rectangle>{};
 }
 
 void mf::WlSurface::set_input_region(std::experimental::optional<wl_resource*> const& region)
@@ -303,6 +350,9 @@ void mf::WlSurface::commit(WlSurfaceState const& state)
     if (state.input_shape)
         input_shape = state.input_shape.value();
 
+    if (state.opaque_region)
+        opaque_region = state.opaque_region.value();
+
     if (state.buffer)
     {
         wl_resource * buffer = *state.buffer;
@@ -311,6 +361,7 @@ void mf::WlSurface::commit(WlSurfaceState const& state)
         {
             // TODO: unmap surface, and unmap all subsurfaces
             buffer_size_ = std::experimental::nullopt;
+            buffer_id_ = std::experimental::nullopt;
             send_frame_callbacks();
         }
         else
@@ -327,10 +378,18 @@ void mf::WlSurface::commit(WlSurfaceState const& state)
 
             std::shared_ptr<graphics::Buffer> mir_buffer;
 
-            if (wl_shm_buffer_get(buffer))
+            if (auto const shm_buffer = wl_shm_buffer_get(buffer))
             {
+                geom::Size const size{wl_shm_buffer_get_width(shm_buffer), wl_shm_buffer_get_height(shm_buffer)};
+
+                // Without any damage we can't assume the content is unchanged
+                bool const damaged = !state.surface_damage.empty() || !state.buffer_damage.empty();
+
                 mir_buffer = WlShmBuffer::mir_buffer_from_wl_buffer(
                     buffer,
+                    executor,
+                    damaged && buffer_size_ == size ? buffer_id_ : std::experimental::nullopt,
+                    damage_in_buffer_coordinates(state, size),
                     std::move(executor_send_frame_callbacks));
                 tracepoint(
                     mir_server_wayland,
@@ -365,6 +424,7 @@ void mf::WlSurface::commit(WlSurfaceState const& state)
                 state.invalidate_surface_data(); // input shape needs to be recalculated for the new size
             }
             buffer_size_ = mir_buffer->size();
+            buffer_id_ = mir_buffer->id();
             stream->submit_buffer(mir_buffer);
         }
     }
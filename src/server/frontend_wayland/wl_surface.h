@@ -25,10 +25,12 @@
 
 #include "mir/frontend/buffer_stream_id.h"
 #include "mir/frontend/surface_id.h"
+#include "mir/graphics/buffer_id.h"
 
 #include "mir/geometry/displacement.h"
 #include "mir/geometry/size.h"
 #include "mir/geometry/point.h"
+#include "mir/geometry/rectangle.h"
 
 #include <vector>
 #include <map>
@@ -45,11 +47,6 @@ namespace shell
 {
 struct StreamSpecification;
 }
-namespace geometry
-{
-class Rectangle;
-}
-
 namespace frontend
 {
 class BufferStream;
@@ -80,8 +77,14 @@ struct WlSurfaceState
 
     std::experimental::optional<geometry::Displacement> offset;
     std::experimental::optional<std::experimental::optional<std::vector<geometry::Rectangle>>> input_shape;
+    // a null wl_region is an empty opaque region, so this doesn't need to be an optional optional
+    std::experimental::optional<std::vector<geometry::Rectangle>> opaque_region;
     std::vector<std::shared_ptr<Callback>> frame_callbacks;
 
+    // Damage accumulates over cached commits, so these are appended to rather than replaced
+    std::vector<geometry::Rectangle> surface_damage;    // from wl_surface.damage
+    std::vector<geometry::Rectangle> buffer_damage;     // from wl_surface.damage_buffer
+
 private:
     // only set to true if invalidate_surface_data() is called
     // surface_data_needs_refresh() returns true if this is true, or if other things are changed which mandate a refresh
@@ -159,12 +162,17 @@ private:
     WlSurfaceState pending;
     geometry::Displacement offset_;
     std::experimental::optional<geometry::Size> buffer_size_;
+    std::experimental::optional<graphics::BufferID> buffer_id_;
     std::vector<std::shared_ptr<WlSurfaceState::Callback>> frame_callbacks;
     std::experimental::optional<std::vector<mir::geometry::Rectangle>> input_shape;
+    std::vector<mir::geometry::Rectangle> opaque_region;
     std::map<void const*, std::function<void()>> destroy_listeners;
     std::shared_ptr<bool> const destroyed;
 
     void send_frame_callbacks();
+    std::vector<geometry::Rectangle> damage_in_buffer_coordinates(
+        WlSurfaceState const& state,
+        geometry::Size const& buffer_size) const;
 
     void destroy() override;
     void attach(std::experimental::optional<wl_resource*> const& buffer, int32_t x, int32_t y) override;
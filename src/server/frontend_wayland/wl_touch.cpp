@@ -29,14 +29,23 @@ namespace mf = mir::frontend;
 
 mf::WlTouch::WlTouch(
     wl_resource* new_resource,
-    std::function<void(WlTouch*)> const& on_destroy)
+    std::function<void(WlTouch*)> const& on_destroy,
+    std::chrono::milliseconds input_batch_budget)
     : Touch(new_resource),
-      on_destroy{on_destroy}
+      on_destroy{on_destroy},
+      input_batch_budget{input_batch_budget}
 {
+    if (input_batch_budget > std::chrono::milliseconds::zero())
+    {
+        auto const loop = wl_display_get_event_loop(wl_client_get_display(client));
+        flush_timer = wl_event_loop_add_timer(loop, &on_flush_timer, this);
+    }
 }
 
 mf::WlTouch::~WlTouch()
 {
+    if (flush_timer)
+        wl_event_source_remove(flush_timer);
     on_destroy(this);
 }
 
@@ -45,6 +54,39 @@ void mf::WlTouch::handle_event(MirTouchEvent const* touch_ev, WlSurface* main_su
     // TODO: support for touches on subsurfaces
     auto const input_ev = mir_touch_event_input_event(touch_ev);
     auto const ev = mir::client::Event{mir_input_event_get_event(input_ev)};
+    auto const point_count = mir_touch_event_point_count(touch_ev);
+
+    if (flush_timer && point_count > 0)
+    {
+        bool only_motion = true;
+        for (auto i = 0u; i < point_count; ++i)
+        {
+            if (mir_touch_event_action(touch_ev, i) != mir_touch_action_change ||
+                !focused_surface_for_ids.count(mir_touch_event_id(touch_ev, i)))
+            {
+                only_motion = false;
+            }
+        }
+
+        if (only_motion)
+        {
+            if (pending_motion.empty())
+                wl_event_source_timer_update(flush_timer, input_batch_budget.count());
+
+            for (auto i = 0u; i < point_count; ++i)
+            {
+                auto const touch_id = mir_touch_event_id(touch_ev, i);
+                auto const point = geometry::Point{mir_touch_event_axis_value(touch_ev, i, mir_touch_axis_x),
+                                                   mir_touch_event_axis_value(touch_ev, i, mir_touch_axis_y)};
+                pending_motion[touch_id] = focused_surface_for_ids[touch_id]->total_offset() + point;
+            }
+            pending_motion_time = mir_input_event_get_event_time_ms(input_ev);
+            return;
+        }
+    }
+
+    // Downs and ups must not overtake the motion that preceded them
+    send_pending_motion();
 
     for (auto i = 0u; i < mir_touch_event_point_count(touch_ev); ++i)
     {
@@ -127,6 +169,30 @@ void mf::WlTouch::handle_down(mir::geometry::Point position, WlSurface* surface,
                     position.y.as_int());
 }
 
+void mf::WlTouch::send_pending_motion()
+{
+    if (pending_motion.empty())
+        return;
+
+    for (auto const& motion : pending_motion)
+    {
+        send_motion_event(pending_motion_time,
+                          motion.first,
+                          motion.second.x.as_int(),
+                          motion.second.y.as_int());
+    }
+    pending_motion.clear();
+    wl_event_source_timer_update(flush_timer, 0);
+
+    send_frame_event();
+}
+
+int mf::WlTouch::on_flush_timer(void* data)
+{
+    static_cast<WlTouch*>(data)->send_pending_motion();
+    return 0;
+}
+
 void mf::WlTouch::handle_up(uint32_t time, int32_t id)
 {
     focused_surface_for_ids.erase(id);
@@ -23,6 +23,7 @@
 
 #include "mir/geometry/point.h"
 
+#include <chrono>
 #include <map>
 #include <functional>
 
@@ -42,7 +43,8 @@ class WlTouch : public wayland::Touch
 public:
     WlTouch(
         wl_resource* new_resource,
-        std::function<void(WlTouch*)> const& on_destroy);
+        std::function<void(WlTouch*)> const& on_destroy,
+        std::chrono::milliseconds input_batch_budget = std::chrono::milliseconds{0});
 
     ~WlTouch();
 
@@ -52,8 +54,16 @@ private:
     std::function<void(WlTouch*)> on_destroy;
     std::map<int32_t, WlSurface*> focused_surface_for_ids;
 
+    /// Latest position of each moving touch, held back for up to input_batch_budget
+    std::chrono::milliseconds const input_batch_budget;
+    std::map<int32_t, mir::geometry::Point> pending_motion;
+    uint32_t pending_motion_time{0};
+    wl_event_source* flush_timer{nullptr};
+
     void handle_down(mir::geometry::Point position, WlSurface* surface, uint32_t time, int32_t id);
     void handle_up(uint32_t time, int32_t id);
+    void send_pending_motion();
+    static int on_flush_timer(void* data);
 
     void release() override;
 };
@@ -20,6 +20,7 @@
 
 #include "wlshmbuffer.h"
 
+#include <mir/executor.h>
 #include <mir/log.h>
 
 #include <wayland-server-protocol.h>
@@ -31,6 +32,15 @@
 
 #include <cstring>
 
+/*
+ * Before 1.16 libwayland may remap a pool on resize even while we hold a
+ * reference to it, so we can't read from it outside the Wayland thread
+ * and need to take a copy of the buffer contents.
+ */
+#if (WAYLAND_VERSION_MAJOR == 1) && (WAYLAND_VERSION_MINOR < 16)
+#define MIR_COPY_WL_SHM_BUFFERS
+#endif
+
 namespace
 {
 wl_shm_buffer* shm_buffer_from_resource_checked(wl_resource* resource)
@@ -120,6 +130,25 @@ GLenum const abgr = GL_INVALID_ENUM;
 
     return gl_format != GL_INVALID_ENUM && gl_type != GL_INVALID_ENUM;
 }
+
+/// Whether glTexSubImage2D() can skip over the unchanged part of each row
+bool unpack_row_length_supported()
+{
+#ifdef GL_UNPACK_ROW_LENGTH
+    return true;
+#else
+    auto const extensions = reinterpret_cast<char const*>(glGetString(GL_EXTENSIONS));
+    auto const version = reinterpret_cast<char const*>(glGetString(GL_VERSION));
+    return (extensions && strstr(extensions, "GL_EXT_unpack_subimage")) ||
+           (version && strncmp(version, "OpenGL ES 3", 11) == 0);
+#endif
+}
+
+#ifdef GL_UNPACK_ROW_LENGTH
+GLenum const unpack_row_length = GL_UNPACK_ROW_LENGTH;
+#else
+GLenum const unpack_row_length = GL_UNPACK_ROW_LENGTH_EXT;
+#endif
 }
 
 namespace mf = mir::frontend;
@@ -128,14 +157,25 @@ using namespace mir::geometry;
 
 mf::WlShmBuffer::~WlShmBuffer()
 {
-    std::lock_guard <std::mutex> lock{*buffer_mutex};
-    if (buffer) {
-        wl_resource_queue_event(resource, WL_BUFFER_RELEASE);
+    {
+        std::lock_guard <std::mutex> lock{*buffer_mutex};
+        if (buffer) {
+            wl_resource_queue_event(resource, WL_BUFFER_RELEASE);
+        }
+    }
+
+    if (pool)
+    {
+        // Dropping the last reference may unmap or resize the pool, which is only safe on the Wayland thread
+        wayland_executor->spawn([pool = pool]() { wl_shm_pool_unref(pool); });
     }
 }
 
 std::shared_ptr<mg::Buffer> mf::WlShmBuffer::mir_buffer_from_wl_buffer(
     wl_resource *buffer,
+    std::shared_ptr<Executor> const& wayland_executor,
+    std::experimental::optional<mg::BufferID> const& damage_base,
+    std::vector<Rectangle> damage,
     std::function<void()> &&on_consumed)
 {
     std::shared_ptr <WlShmBuffer> mir_buffer;
@@ -152,14 +192,25 @@ std::shared_ptr<mg::Buffer> mf::WlShmBuffer::mir_buffer_from_wl_buffer(
              *
              * Recreate a new WlShmBuffer to track the new compositor lifetime.
              */
-            mir_buffer = std::shared_ptr < WlShmBuffer > {new WlShmBuffer{buffer, std::move(on_consumed)}};
+            mir_buffer = std::shared_ptr < WlShmBuffer > {new WlShmBuffer{buffer, wayland_executor, std::move(on_consumed)}};
             shim->associated_buffer = mir_buffer;
+            mir_buffer->damage_base = damage_base;
+            mir_buffer->damage = std::move(damage);
+        }
+        else
+        {
+            // The damage recorded at the first attach is no longer relative to anything
+            // we know of, so the next consumer has to treat the whole buffer as changed
+            std::lock_guard<std::mutex> lock{*shim->mutex};
+            mir_buffer->damage_base = std::experimental::nullopt;
         }
     } else {
-        mir_buffer = std::shared_ptr < WlShmBuffer > {new WlShmBuffer{buffer, std::move(on_consumed)}};
+        mir_buffer = std::shared_ptr < WlShmBuffer > {new WlShmBuffer{buffer, wayland_executor, std::move(on_consumed)}};
         shim = new DestructionShim;
         shim->destruction_listener.notify = &on_buffer_destroyed;
         shim->associated_buffer = mir_buffer;
+        mir_buffer->damage_base = damage_base;
+        mir_buffer->damage = std::move(damage);
 
         wl_resource_add_destroy_listener(buffer, &shim->destruction_listener);
     }
@@ -225,6 +276,64 @@ void mf::WlShmBuffer::secure_for_render()
 {
 }
 
+void mf::WlShmBuffer::upload_areas(std::vector<Rectangle> const& areas)
+{
+    GLenum format, type;
+
+    if (!get_gl_pixel_format(format_, format, type))
+        return;
+
+    auto const bytes_per_pixel = MIR_BYTES_PER_PIXEL(format_);
+    auto const row_length = stride_.as_int() / bytes_per_pixel;
+    auto const full_rows_only =
+        stride_.as_int() % bytes_per_pixel != 0 || !unpack_row_length_supported();
+    Rectangle const bounds{{0, 0}, size_};
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (!full_rows_only)
+        glPixelStorei(unpack_row_length, row_length);
+
+    read(
+        [&](unsigned char const* pixels)
+        {
+            for (auto const& area : areas)
+            {
+                auto upload = area.intersection_with(bounds);
+
+                // Without GL_UNPACK_ROW_LENGTH we can only express contiguous runs of whole rows
+                if (full_rows_only)
+                    upload = Rectangle{{0, upload.top_left.y}, {size_.width, upload.size.height}};
+
+                if (upload.size.width.as_int() <= 0 || upload.size.height.as_int() <= 0)
+                    continue;
+
+                auto const x = upload.top_left.x.as_int();
+                auto const y = upload.top_left.y.as_int();
+                auto const width = upload.size.width.as_int();
+                auto const height = upload.size.height.as_int();
+                auto const first_pixel = pixels + y * stride_.as_int() + x * bytes_per_pixel;
+
+                if (!full_rows_only || row_length == width)
+                {
+                    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, format, type, first_pixel);
+                }
+                else
+                {
+                    // Rows are padded, so they have to go one at a time
+                    for (auto row = 0; row != height; ++row)
+                    {
+                        glTexSubImage2D(
+                            GL_TEXTURE_2D, 0, x, y + row, width, 1,
+                            format, type, first_pixel + row * stride_.as_int());
+                    }
+                }
+            }
+        });
+
+    if (!full_rows_only)
+        glPixelStorei(unpack_row_length, 0);
+}
+
 void mf::WlShmBuffer::write(unsigned char const *pixels, size_t size)
 {
     std::lock_guard <std::mutex> lock{*buffer_mutex};
@@ -247,7 +356,17 @@ void mf::WlShmBuffer::read(std::function<void(unsigned char const *)> const &do_
         consumed = true;
     }
 
-    do_with_pixels(static_cast<unsigned char const *>(data.get()));
+    if (pool)
+    {
+        // Guards against the client truncating the pool under us
+        wl_shm_buffer_begin_access(buffer);
+        do_with_pixels(pixels);
+        wl_shm_buffer_end_access(buffer);
+    }
+    else
+    {
+        do_with_pixels(pixels);
+    }
 }
 
 Stride mf::WlShmBuffer::stride() const
@@ -255,8 +374,19 @@ Stride mf::WlShmBuffer::stride() const
     return stride_;
 }
 
+std::vector<Rectangle> const* mf::WlShmBuffer::damage_since(mg::BufferID previous) const
+{
+    // A reused WlShmBuffer has its damage_base reset, as it may be relative to anything
+    std::lock_guard<std::mutex> lock{*buffer_mutex};
+    if (damage_base && damage_base.value() == previous)
+        return &damage;
+
+    return nullptr;
+}
+
 mf::WlShmBuffer::WlShmBuffer(
     wl_resource *buffer,
+    std::shared_ptr<Executor> const& wayland_executor,
     std::function<void()> &&on_consumed)
     :
     buffer{shm_buffer_from_resource_checked(buffer)},
@@ -264,7 +394,16 @@ mf::WlShmBuffer::WlShmBuffer(
     size_{wl_shm_buffer_get_width(this->buffer), wl_shm_buffer_get_height(this->buffer)},
     stride_{wl_shm_buffer_get_stride(this->buffer)},
     format_{wl_format_to_mir_format(wl_shm_buffer_get_format(this->buffer))},
+    wayland_executor{wayland_executor},
+#ifdef MIR_COPY_WL_SHM_BUFFERS
     data{std::make_unique<uint8_t[]>(size_.height.as_int() * stride_.as_int())},
+    pool{nullptr},
+    pixels{data.get()},
+#else
+    // Holding a pool reference defers any resize (and so remapping) of the pool until we're done
+    pool{wl_shm_buffer_ref_pool(this->buffer)},
+    pixels{static_cast<uint8_t const*>(wl_shm_buffer_get_data(this->buffer))},
+#endif
     consumed{false},
     on_consumed{std::move(on_consumed)}
 {
@@ -276,13 +415,18 @@ mf::WlShmBuffer::WlShmBuffer(
                 "Did you accidentally specify stride in pixels?",
             stride_.as_int(), size_.width.as_int(), MIR_BYTES_PER_PIXEL(format_));
 
+        if (pool)
+            wl_shm_pool_unref(pool);
+
         BOOST_THROW_EXCEPTION((
                                   std::runtime_error{"Buffer has invalid stride"}));
     }
 
+#ifdef MIR_COPY_WL_SHM_BUFFERS
     wl_shm_buffer_begin_access(this->buffer);
     std::memcpy(data.get(), wl_shm_buffer_get_data(this->buffer), size_.height.as_int() * stride_.as_int());
     wl_shm_buffer_end_access(this->buffer);
+#endif
 }
 
 void mf::WlShmBuffer::on_buffer_destroyed(wl_listener *listener, void *)
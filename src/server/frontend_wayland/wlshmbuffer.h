@@ -21,17 +21,23 @@
 #define MIR_FRONTEND_WLSHMBUFFER_H_
 
 #include <mir/graphics/buffer_basic.h>
+#include <mir/graphics/damage_source.h>
+#include <mir/renderer/gl/sub_texture_source.h>
 #include <mir/renderer/gl/texture_source.h>
 #include <mir/renderer/sw/pixel_source.h>
 
 #include <wayland-server-core.h>
 
+#include <experimental/optional>
 #include <functional>
 #include <mutex>
 #include <string>
+#include <vector>
 
 namespace mir
 {
+class Executor;
+
 namespace frontend
 {
 
@@ -39,13 +45,22 @@ class WlShmBuffer :
     public graphics::BufferBasic,
     public graphics::NativeBufferBase,
     public renderer::gl::TextureSource,
-    public renderer::software::PixelSource
+    public renderer::gl::SubTextureSource,
+    public renderer::software::PixelSource,
+    public graphics::DamageSource
 {
 public:
     ~WlShmBuffer();
 
+    /**
+     * \param [in] damage_base  The buffer previously submitted to the same stream, if any
+     * \param [in] damage       The areas (in buffer coordinates) changed since damage_base
+     */
     static std::shared_ptr <graphics::Buffer> mir_buffer_from_wl_buffer(
         wl_resource *buffer,
+        std::shared_ptr<Executor> const& wayland_executor,
+        std::experimental::optional<graphics::BufferID> const& damage_base,
+        std::vector<geometry::Rectangle> damage,
         std::function<void()> &&on_consumed);
 
     std::shared_ptr <graphics::NativeBuffer> native_buffer_handle() const override;
@@ -62,15 +77,20 @@ public:
 
     void secure_for_render() override;
 
+    void upload_areas(std::vector<geometry::Rectangle> const& areas) override;
+
     void write(unsigned char const *pixels, size_t size) override;
 
     void read(std::function<void(unsigned char const *)> const &do_with_pixels) override;
 
     geometry::Stride stride() const override;
 
+    std::vector<geometry::Rectangle> const* damage_since(graphics::BufferID previous) const override;
+
 private:
     WlShmBuffer(
         wl_resource *buffer,
+        std::shared_ptr<Executor> const& wayland_executor,
         std::function<void()> &&on_consumed);
 
     static void on_buffer_destroyed(wl_listener *listener, void *);
@@ -91,10 +111,17 @@ private:
     geometry::Stride const stride_;
     MirPixelFormat const format_;
 
+    std::shared_ptr<Executor> const wayland_executor;
+    /// Either the client's shm pool or, if we can't safely reference that, a copy
     std::unique_ptr<uint8_t[]> const data;
+    wl_shm_pool* const pool;
+    uint8_t const* const pixels;
 
     bool consumed;
     std::function<void()> on_consumed;
+
+    std::experimental::optional<graphics::BufferID> damage_base;
+    std::vector<geometry::Rectangle> damage;
 };
 }
 }
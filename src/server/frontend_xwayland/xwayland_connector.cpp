@@ -27,11 +27,14 @@
 
 namespace mf = mir::frontend;
 
-mf::XWaylandConnector::XWaylandConnector(const int xdisplay, std::shared_ptr<mf::WaylandConnector> wc)
+mf::XWaylandConnector::XWaylandConnector(
+    const int xdisplay,
+    std::shared_ptr<mf::WaylandConnector> wc,
+    std::chrono::milliseconds prespawn_delay)
     : enabled(!!wc->get_extension("x11-support"))
 {
     if (enabled)
-        xwayland_server = std::make_shared<mf::XWaylandServer>(xdisplay, wc);
+        xwayland_server = std::make_shared<mf::XWaylandServer>(xdisplay, wc, prespawn_delay);
 }
 
 void mf::XWaylandConnector::start()
@@ -20,6 +20,7 @@
 
 #include "mir/dispatch/threaded_dispatcher.h"
 #include "mir/frontend/connector.h"
+#include <chrono>
 #include <thread>
 
 namespace mir
@@ -35,7 +36,8 @@ class XWaylandServer;
 class XWaylandConnector : public Connector
 {
 public:
-    XWaylandConnector(const int xdisplay, std::shared_ptr<WaylandConnector> wc);
+    XWaylandConnector(const int xdisplay, std::shared_ptr<WaylandConnector> wc,
+                      std::chrono::milliseconds prespawn_delay = std::chrono::milliseconds{-1});
     void start() override;
     void stop() override;
 
@@ -0,0 +1,65 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "xwayland_cursor_images.h"
+
+#include <cstdlib>
+
+namespace mf = mir::frontend;
+
+namespace
+{
+XcursorImages *load_from_theme(char const *name)
+{
+    int size = 0;
+    if (auto const v = getenv("XCURSOR_SIZE"))
+        size = atoi(v);
+
+    if (!size)
+        size = 32;
+
+    return XcursorLibraryLoadImages(name, NULL, size);
+}
+}
+
+mf::XWaylandCursorImages::XWaylandCursorImages()
+    : XWaylandCursorImages{&load_from_theme}
+{
+}
+
+mf::XWaylandCursorImages::XWaylandCursorImages(Load const &load)
+    : load{load}
+{
+}
+
+mf::XWaylandCursorImages::~XWaylandCursorImages()
+{
+    for (auto const &named : images)
+    {
+        if (named.second)
+            XcursorImagesDestroy(named.second);
+    }
+}
+
+XcursorImages *mf::XWaylandCursorImages::get(char const *name)
+{
+    // Searching the cursor theme is slow, so a cursor it lacks is remembered too
+    auto const cached = images.find(name);
+    if (cached != images.end())
+        return cached->second;
+
+    return images[name] = load(name);
+}
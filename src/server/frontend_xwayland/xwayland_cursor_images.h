@@ -0,0 +1,58 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_FRONTEND_XWAYLAND_CURSOR_IMAGES_H
+#define MIR_FRONTEND_XWAYLAND_CURSOR_IMAGES_H
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+extern "C" {
+#include <X11/Xcursor/Xcursor.h>
+}
+
+namespace mir
+{
+namespace frontend
+{
+/// Cursor images read from the theme. Unlike the cursors the X server makes from them, they are ours,
+/// so are kept for when the X server restarts.
+class XWaylandCursorImages
+{
+public:
+    /// Reads the named cursor's images (nullptr if the theme has none)
+    using Load = std::function<XcursorImages *(char const *name)>;
+
+    /// Loads from the cursor theme, at XCURSOR_SIZE
+    XWaylandCursorImages();
+    explicit XWaylandCursorImages(Load const &load);
+    ~XWaylandCursorImages();
+
+    XWaylandCursorImages(XWaylandCursorImages const &) = delete;
+    XWaylandCursorImages &operator=(XWaylandCursorImages const &) = delete;
+
+    /// The named cursor's images, loaded the first time they are asked for (nullptr if not found)
+    XcursorImages *get(char const *name);
+
+private:
+    Load const load;
+    std::unordered_map<std::string, XcursorImages *> images;
+};
+} /* frontend */
+} /* mir */
+
+#endif /* end of include guard: MIR_FRONTEND_XWAYLAND_CURSOR_IMAGES_H */
@@ -19,6 +19,7 @@
 #include "mir/log.h"
 #include "wayland_connector.h"
 #include "xwayland_connector.h"
+#include "xwayland_server.h"
 
 #include <string>
 
@@ -66,7 +67,8 @@ std::shared_ptr<mf::Connector> mir::DefaultServerConfiguration::the_xwayland_con
             try
             {
                 auto wc = std::static_pointer_cast<mf::WaylandConnector>(the_wayland_connector());
-                return std::make_shared<mf::XWaylandConnector>(options->get<int>(mo::x11_display_opt), wc);
+                return std::make_shared<mf::XWaylandConnector>(
+                    options->get<int>(mo::x11_display_opt), wc, mf::xwayland_prespawn_delay(*options));
             }
             catch (...)
             {
@@ -0,0 +1,58 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "xwayland_pending_replies.h"
+
+#include <cstdlib>
+
+namespace mf = mir::frontend;
+
+void mf::XWaylandPendingReplies::expect(unsigned int sequence, Handler const &handler)
+{
+    pending.push_back({sequence, handler});
+}
+
+int mf::XWaylandPendingReplies::handle_arrived(Poll const &poll)
+{
+    int count = 0;
+
+    // Replies arrive in the order requested, so stop at the first still outstanding
+    while (!pending.empty())
+    {
+        void *reply = nullptr;
+        if (!poll(pending.front().sequence, &reply))
+            break;
+
+        auto const handler = std::move(pending.front().handler);
+        pending.pop_front();
+
+        handler(reply);
+        free(reply);
+        count++;
+    }
+
+    return count;
+}
+
+void mf::XWaylandPendingReplies::clear()
+{
+    pending.clear();
+}
+
+bool mf::XWaylandPendingReplies::empty() const
+{
+    return pending.empty();
+}
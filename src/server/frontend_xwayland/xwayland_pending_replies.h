@@ -0,0 +1,59 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_FRONTEND_XWAYLAND_PENDING_REPLIES_H
+#define MIR_FRONTEND_XWAYLAND_PENDING_REPLIES_H
+
+#include <deque>
+#include <functional>
+
+namespace mir
+{
+namespace frontend
+{
+/// Requests made to the X server whose replies have yet to be handled, in the order they were made
+class XWaylandPendingReplies
+{
+public:
+    /// Handles the reply to a request (nullptr if the request failed)
+    using Handler = std::function<void(void *reply)>;
+    /// Takes the reply to a request if it has arrived, as xcb_poll_for_reply() does
+    using Poll = std::function<bool(unsigned int sequence, void **reply)>;
+
+    void expect(unsigned int sequence, Handler const &handler);
+
+    /// Handles the replies that have arrived, stopping at the first still outstanding. The replies are
+    /// free()d afterwards. Returns the number handled.
+    int handle_arrived(Poll const &poll);
+
+    /// Forgets all outstanding requests. Needed when the connection they were made on goes away, as no
+    /// reply to them will ever arrive.
+    void clear();
+
+    bool empty() const;
+
+private:
+    struct Pending
+    {
+        unsigned int sequence;
+        Handler handler;
+    };
+    std::deque<Pending> pending;
+};
+} /* frontend */
+} /* mir */
+
+#endif /* end of include guard: MIR_FRONTEND_XWAYLAND_PENDING_REPLIES_H */
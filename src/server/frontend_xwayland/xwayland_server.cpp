@@ -26,6 +26,8 @@
 #include "mir/dispatch/multiplexing_dispatchable.h"
 #include "mir/dispatch/readable_fd.h"
 #include "mir/fd.h"
+#include "mir/options/configuration.h"
+#include "mir/options/option.h"
 #include <csignal>
 #include <fcntl.h>
 #include <memory>
@@ -33,10 +35,12 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/timerfd.h>
 #include <sys/un.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
 #include <thread>
 
@@ -45,11 +49,47 @@ namespace md = mir::dispatch;
 
 bool mf::XWaylandServer::xserver_ready = false;
 
-mf::XWaylandServer::XWaylandServer(const int xdisplay, std::shared_ptr<mf::WaylandConnector> wc)
+namespace
+{
+// Retries of an X server that keeps failing back off exponentially to this
+auto const max_retry_delay = std::chrono::milliseconds{60000};
+auto const first_retry_delay = std::chrono::milliseconds{100};
+}
+
+std::chrono::milliseconds mf::xwayland_retry_delay(int retry)
+{
+    // Capping the shift first keeps it from overflowing; 100ms << 10 is past the maximum anyway
+    auto const doublings = std::min(std::max(retry - 1, 0), 10);
+    return std::min(first_retry_delay * (1 << doublings), max_retry_delay);
+}
+
+std::chrono::milliseconds mf::xwayland_prespawn_delay(mir::options::Option const& options)
+{
+    // Only registered by servers that offer it (as miral::X11Support does)
+    if (!options.is_set(mir::options::x11_prespawn_delay_opt))
+        return std::chrono::milliseconds{-1};
+
+    return std::chrono::milliseconds{options.get<int>(mir::options::x11_prespawn_delay_opt)};
+}
+
+itimerspec mf::xwayland_prespawn_timer(std::chrono::milliseconds prespawn_delay)
+{
+    auto const nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(prespawn_delay).count();
+    itimerspec spec{};
+    spec.it_value.tv_sec = nanoseconds / 1000000000;
+    spec.it_value.tv_nsec = std::max<long long>(nanoseconds % 1000000000, 1);    // All zeros would disarm it
+    return spec;
+}
+
+mf::XWaylandServer::XWaylandServer(
+    const int xdisplay,
+    std::shared_ptr<mf::WaylandConnector> wc,
+    std::chrono::milliseconds prespawn_delay)
     : wm(std::make_shared<XWaylandWM>(wc)),
       xdisplay(xdisplay),
       wlc(wc),
-      dispatcher{std::make_shared<md::MultiplexingDispatchable>()}
+      dispatcher{std::make_shared<md::MultiplexingDispatchable>()},
+      prespawn_delay{prespawn_delay}
 {
 }
 
@@ -59,7 +99,11 @@ mf::XWaylandServer::~XWaylandServer()
 
     // Terminate any running xservers
     if (xserver_status > 0) {
-      terminate = true;
+      {
+          std::lock_guard<std::mutex> lock{terminate_mutex};
+          terminate = true;
+      }
+      terminate_cv.notify_all();
 
       if (xserver_status == RUNNING)
         wm->destroy();
@@ -70,9 +114,12 @@ mf::XWaylandServer::~XWaylandServer()
           if (kill(pid, 0) == 0)    // ...if Xwayland is still running...
             kill(pid, SIGKILL);     // ...then kill it!
       }
-      spawn_thread->join();
     }
 
+    // The spawn thread may have given up (STOPPED or FAILED) without being joined
+    if (spawn_thread && spawn_thread->joinable())
+      spawn_thread->join();
+
     if (lazy)
       return;
 
@@ -92,157 +139,197 @@ void mf::XWaylandServer::spawn()
     int status;
     std::string fd_str, abs_fd_str, wm_fd_str;
 
-    xserver_status = STARTING;
-
-    // Try 5 times
-    if (xserver_spawn_tries >= 5) {
-      mir::log_error("Xwayland failed to start 5 times in a row, disabling Xserver");
-      return;
-    }
-    xserver_status = STARTING;
-    xserver_spawn_tries++;
-
-    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, wl_client_fd) < 0)
+    // Each pass starts one X server; failures go round again, after a backoff
+    for (;; xserver_spawn_tries++)
     {
-        mir::log_error("wl connection socketpair failed");
-        return;
-    }
+        if (xserver_spawn_tries > 0 && !wait_before_retry())
+            return;
 
-    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, wm_fd) < 0)
-    {
-        mir::log_error("wm fd socketpair failed");
-        return;
-    }
+        xserver_status = STARTING;
 
-    std::ostringstream _dsp_str;
-    _dsp_str << ":" << xdisplay;
-    auto dsp_str = _dsp_str.str();
-
-    // This is not pretty! but SIGUSR1 is the only way we know the xserver
-    // is ready to accept connections to the wm fd
-    // If not it will have a race condition on start that might end
-    // up in a never ending wait
-    std::signal(SIGUSR1, [](int) {
-        xserver_ready = true;
-        mir::log_info("Xwayland running");
-    });
-
-    mir::log_info("Starting Xwayland");
-    pid = fork();
-    switch (pid)
-    {
-    case 0:
-        fd = dup(wl_client_fd[1]);
-        if (fd < 0)
-            mir::log_error("Failed to duplicate xwayland FD");
-        setenv("WAYLAND_SOCKET", std::to_string(fd).c_str(), 1);
-        setenv("EGL_PLATFORM", "DRM", 1);
-
-        set_cloexec(socket_fd, false);
-        set_cloexec(abstract_socket_fd, false);
-
-        fd = dup(socket_fd);
-        if (fd < 0)
-            mir::log_error("Failed to duplicate xwayland FD");
-        fd_str = std::to_string(fd);
-
-        fd = dup(abstract_socket_fd);
-        if (fd < 0)
-            mir::log_error("Failed to duplicate xwayland abstract FD");
-        abs_fd_str = std::to_string(fd);
-
-        fd = dup(wm_fd[1]);
-        if (fd < 0)
-            mir::log_error("Failed to duplicate xwayland wm FD");
-        wm_fd_str = std::to_string(fd);
-
-        // forward SIGUSR1 to parent thread (us)
-        signal(SIGUSR1, SIG_IGN);
-
-        // Last second abort
-        if (terminate) return;
-
-        if (lazy)
-            execl("/usr/bin/Xwayland",
-                  "Xwayland",
-                  dsp_str.c_str(),
-                  "-rootless",
-                  "-listen", abs_fd_str.c_str(),
-                  "-listen", fd_str.c_str(),
-                  "-wm", wm_fd_str.c_str(),
-                  NULL);
-        else
-            execl("/usr/bin/Xwayland",
-                "Xwayland",
-                dsp_str.c_str(),
-                "-rootless",
-                "-listen", abs_fd_str.c_str(),
-                "-listen", fd_str.c_str(),
-                "-wm", wm_fd_str.c_str(),
-                "-terminate",
-                NULL);
-        break;
-    case -1:
-        mir::log_error("Failed to fork");
-        break;
-    default:
-        close(wl_client_fd[1]);
-        close(wm_fd[1]);
-        auto wlclient = wl_client_create(wlc->get_wl_display(), wl_client_fd[0]);
-
-        // More ugliness
-        int tries = 0;
-        while (!xserver_ready)
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, wl_client_fd) < 0)
         {
-          // Last second abort
-          if (terminate) return;
-
-          // Check for stalled startup
-          if (waitpid(pid, NULL, WNOHANG) != 0 || tries > 200) {
+            mir::log_error("wl connection socketpair failed");
             xserver_status = FAILED;
-            mir::log_info("Stalled start of Xserver, trying to start again!");
-            spawn();
             return;
-          }
-
-          std::this_thread::sleep_for(std::chrono::milliseconds(10));
-          tries++;
         }
 
-        // Last second abort
-        if (terminate) return;
-        wm->start(wlclient, wm_fd[0]);
-        mir::log_info("XServer is running");
-        xserver_status = RUNNING;
-
-        // Reset the tries since server is running now
-        xserver_spawn_tries = 0;
-
-        waitpid(pid, &status, 0);  // Blocking
-        if (WIFEXITED(status)) {
-           mir::log_info("Xserver stopped");
-           xserver_status = STOPPED;
-       } else {
-          // Failed, crash or killed
-          mir::log_info("Xserver crashed or got killed");
-          xserver_status = FAILED;
-       }
-
-        if (terminate) return;
-        wm->destroy();
-        xserver_ready = false;
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, wm_fd) < 0)
+        {
+            mir::log_error("wm fd socketpair failed");
+            close(wl_client_fd[0]);
+            close(wl_client_fd[1]);
+            xserver_status = FAILED;
+            return;
+        }
 
-        if (xserver_status == FAILED) {
-          mir::log_info("Trying to start Xwayland again!");
-          spawn();
-          return;
+        std::ostringstream _dsp_str;
+        _dsp_str << ":" << xdisplay;
+        auto dsp_str = _dsp_str.str();
+
+        // This is not pretty! but SIGUSR1 is the only way we know the xserver
+        // is ready to accept connections to the wm fd
+        // If not it will have a race condition on start that might end
+        // up in a never ending wait
+        std::signal(SIGUSR1, [](int) {
+            xserver_ready = true;
+            mir::log_info("Xwayland running");
+        });
+
+        mir::log_info("Starting Xwayland");
+        pid = fork();
+        switch (pid)
+        {
+        case 0:
+            fd = dup(wl_client_fd[1]);
+            if (fd < 0)
+                mir::log_error("Failed to duplicate xwayland FD");
+            setenv("WAYLAND_SOCKET", std::to_string(fd).c_str(), 1);
+            setenv("EGL_PLATFORM", "DRM", 1);
+
+            set_cloexec(socket_fd, false);
+            set_cloexec(abstract_socket_fd, false);
+
+            fd = dup(socket_fd);
+            if (fd < 0)
+                mir::log_error("Failed to duplicate xwayland FD");
+            fd_str = std::to_string(fd);
+
+            fd = dup(abstract_socket_fd);
+            if (fd < 0)
+                mir::log_error("Failed to duplicate xwayland abstract FD");
+            abs_fd_str = std::to_string(fd);
+
+            fd = dup(wm_fd[1]);
+            if (fd < 0)
+                mir::log_error("Failed to duplicate xwayland wm FD");
+            wm_fd_str = std::to_string(fd);
+
+            // forward SIGUSR1 to parent thread (us)
+            signal(SIGUSR1, SIG_IGN);
+
+            // Last second abort
+            if (terminate) return;
+
+            if (lazy)
+                execl("/usr/bin/Xwayland",
+                      "Xwayland",
+                      dsp_str.c_str(),
+                      "-rootless",
+                      "-listen", abs_fd_str.c_str(),
+                      "-listen", fd_str.c_str(),
+                      "-wm", wm_fd_str.c_str(),
+                      NULL);
+            else
+                execl("/usr/bin/Xwayland",
+                    "Xwayland",
+                    dsp_str.c_str(),
+                    "-rootless",
+                    "-listen", abs_fd_str.c_str(),
+                    "-listen", fd_str.c_str(),
+                    "-wm", wm_fd_str.c_str(),
+                    "-terminate",
+                    NULL);
+
+            // The child must not carry on as a second compositor
+            _exit(EXIT_FAILURE);
+        case -1:
+            mir::log_error("Failed to fork");
+            close(wl_client_fd[0]);
+            close(wl_client_fd[1]);
+            close(wm_fd[0]);
+            close(wm_fd[1]);
+            xserver_status = FAILED;
+            continue;
+        default:
+            close(wl_client_fd[1]);
+            close(wm_fd[1]);
+            auto wlclient = wl_client_create(wlc->get_wl_display(), wl_client_fd[0]);
+
+            // More ugliness
+            int tries = 0;
+            bool stalled = false;
+            while (!xserver_ready)
+            {
+              // Last second abort
+              if (terminate) return;
+
+              // Check for stalled startup
+              auto const exited = waitpid(pid, NULL, WNOHANG);
+              if (exited != 0 || tries > 200) {
+                xserver_status = FAILED;
+                mir::log_info("Stalled start of Xserver, trying to start again!");
+
+                // Don't leave a stuck Xwayland (or a zombie) behind the next attempt
+                if (exited == 0)
+                {
+                    kill(pid, SIGKILL);
+                    waitpid(pid, NULL, 0);
+                }
+                stalled = true;
+                break;
+              }
+
+              std::this_thread::sleep_for(std::chrono::milliseconds(10));
+              tries++;
+            }
+            if (stalled)
+            {
+                if (wlclient)
+                    wl_client_destroy(wlclient);    // Closes wl_client_fd[0]
+                else
+                    close(wl_client_fd[0]);
+                close(wm_fd[0]);
+                xserver_ready = false;
+                continue;
+            }
+
+            // Last second abort
+            if (terminate) return;
+            wm->start(wlclient, wm_fd[0]);
+            mir::log_info("XServer is running");
+            xserver_status = RUNNING;
+
+            // Reset the tries since server is running now
+            xserver_spawn_tries = 0;
+
+            waitpid(pid, &status, 0);  // Blocking
+            if (WIFEXITED(status)) {
+               mir::log_info("Xserver stopped");
+               xserver_status = STOPPED;
+           } else {
+              // Failed, crash or killed
+              mir::log_info("Xserver crashed or got killed");
+              xserver_status = FAILED;
+           }
+
+            if (terminate) return;
+            wm->destroy();
+            xserver_ready = false;
+
+            if (xserver_status == FAILED) {
+              mir::log_info("Trying to start Xwayland again!");
+              continue;
+            }
+
+            spawn_xserver_on_event_loop();
+
+            mir::log_info("Xwayland stopped");
+            return;
         }
+    }
+}
+
+bool mf::XWaylandServer::wait_before_retry()
+{
+    auto const delay = xwayland_retry_delay(xserver_spawn_tries);
+    mir::log_info("Retrying Xwayland in %lld ms", static_cast<long long>(delay.count()));
 
-        spawn_xserver_on_event_loop();
+    // Still starting, so that shutdown waits for (and interrupts) the backoff
+    xserver_status = STARTING;
 
-        mir::log_info("Xwayland stopped");
-        break;
-    }
+    std::unique_lock<std::mutex> lock{terminate_mutex};
+    return !terminate_cv.wait_for(lock, delay, [this] { return terminate; });
 }
 
 bool mf::XWaylandServer::set_cloexec(int fd, bool cloexec) {
@@ -402,6 +489,10 @@ void mf::XWaylandServer::new_spawn_thread() {
   if (xserver_status > 0) return;
   xserver_status = STARTING;
 
+  // The thread that ran the last X server has finished with it by now
+  if (spawn_thread && spawn_thread->joinable())
+    spawn_thread->join();
+
   spawn_thread = std::make_unique<std::thread>(&mf::XWaylandServer::spawn, this);
 }
 
@@ -412,6 +503,11 @@ void mf::XWaylandServer::spawn_xserver_on_event_loop()
       dispatcher->remove_watch(fd_dispatcher);
       afd_dispatcher.reset();
       fd_dispatcher.reset();
+      if (prespawn_dispatcher)
+      {
+          dispatcher->remove_watch(prespawn_dispatcher);
+          prespawn_dispatcher.reset();
+      }
 
       new_spawn_thread();
     };
@@ -420,6 +516,23 @@ void mf::XWaylandServer::spawn_xserver_on_event_loop()
     fd_dispatcher = std::make_shared<md::ReadableFd>(mir::Fd{mir::IntOwnedFd{socket_fd}}, func);
     dispatcher->add_watch(afd_dispatcher);
     dispatcher->add_watch(fd_dispatcher);
+
+    // Starting the X server before its first client connects hides its startup from them
+    if (prespawn_delay >= std::chrono::milliseconds::zero())
+    {
+        mir::Fd timer{timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC)};
+        if (timer == mir::Fd::invalid)
+        {
+            mir::log_warning("Failed to create timer, Xwayland will start on demand");
+            return;
+        }
+
+        auto const spec = xwayland_prespawn_timer(prespawn_delay);
+        timerfd_settime(timer, 0, &spec, nullptr);
+
+        prespawn_dispatcher = std::make_shared<md::ReadableFd>(timer, func);
+        dispatcher->add_watch(prespawn_dispatcher);
+    }
 }
 
 void mf::XWaylandServer::spawn_lazy_xserver()
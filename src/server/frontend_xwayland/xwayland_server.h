@@ -18,9 +18,13 @@
 #ifndef MIR_FRONTEND_XWAYLAND_SERVER_H
 #define MIR_FRONTEND_XWAYLAND_SERVER_H
 
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <thread>
 #include <sys/socket.h>
+#include <sys/timerfd.h>
 #include <sys/un.h>
 
 namespace mir
@@ -30,14 +34,32 @@ namespace dispatch
 class ReadableFd;
 class MultiplexingDispatchable;
 } /*dispatch */
+namespace options
+{
+class Option;
+}
 namespace frontend
 {
 class WaylandConnector;
 class XWaylandWM;
+
+/// How long to wait before the given retry (counting from 1) of an X server that failed: 100ms,
+/// doubling with each retry up to a minute
+std::chrono::milliseconds xwayland_retry_delay(int retry);
+
+/// The x11-prespawn-delay option, or a negative delay (start on demand) if it isn't set
+std::chrono::milliseconds xwayland_prespawn_delay(options::Option const& options);
+
+/// The timerfd setting that fires once, prespawn_delay from now
+itimerspec xwayland_prespawn_timer(std::chrono::milliseconds prespawn_delay);
+
 class XWaylandServer
 {
 public:
-    XWaylandServer(const int xdisp, std::shared_ptr<WaylandConnector> wc);
+    /// A non-negative prespawn_delay starts the X server that long after startup, or after
+    /// an idle X server exits, instead of waiting for a client to connect
+    XWaylandServer(const int xdisp, std::shared_ptr<WaylandConnector> wc,
+                   std::chrono::milliseconds prespawn_delay = std::chrono::milliseconds{-1});
     ~XWaylandServer();
 
     enum Status {
@@ -60,6 +82,7 @@ public:
 
 private:
     void spawn();
+    bool wait_before_retry();
     void new_spawn_thread();
     int create_lockfile();
     int create_socket(struct sockaddr_un *addr, size_t path_size);
@@ -72,11 +95,15 @@ private:
     std::shared_ptr<dispatch::MultiplexingDispatchable> dispatcher;
     std::shared_ptr<dispatch::ReadableFd> afd_dispatcher;
     std::shared_ptr<dispatch::ReadableFd> fd_dispatcher;
+    std::shared_ptr<dispatch::ReadableFd> prespawn_dispatcher;
+    std::chrono::milliseconds const prespawn_delay;
     std::unique_ptr<std::thread> spawn_thread;
     int socket_fd;
     int abstract_socket_fd;
     bool lazy = false;
     bool terminate = false;
+    std::mutex terminate_mutex;
+    std::condition_variable terminate_cv;
     Status xserver_status = STOPPED;
     int xserver_spawn_tries = 0;
 };
@@ -36,6 +36,7 @@
 #include <poll.h>
 #include <sys/socket.h>
 #include <unistd.h>
+#include <xcb/xcbext.h>
 
 
 #ifndef ARRAY_LENGTH
@@ -105,6 +106,10 @@ void mf::XWaylandWM::destroy() {
   if (xcb_connection != nullptr)
     xcb_disconnect(xcb_connection);
   close(wm_fd);
+
+  // Cookies and atoms belong to this connection; a restarted server won't answer them
+  pending_properties.clear();
+  atom_names.clear();
 }
 
 void mf::XWaylandWM::start(wl_client *wlc, const int fd)
@@ -191,7 +196,6 @@ void mf::XWaylandWM::set_cursor(xcb_window_t id, const CursorType &cursor)
     xcb_cursor = cursor;
     uint32_t cursor_value_list = xcb_cursors[cursor];
     xcb_change_window_attributes(xcb_connection, id, XCB_CW_CURSOR, &cursor_value_list);
-    xcb_flush(xcb_connection);
 }
 
 void mf::XWaylandWM::create_wm_cursor()
@@ -257,103 +261,139 @@ void mf::XWaylandWM::handle_events()
 {
     xcb_generic_event_t *event;
     int count = 0;
+    int handled;
 
-    while ((event = xcb_poll_for_event(xcb_connection)))
+    // Replies are read in along with events, and handling either may
+    // produce more of the other, so keep going until both are drained
+    do
     {
-        int type = event->response_type & ~0x80;
-        switch (type)
+        handled = 0;
+        while ((event = xcb_poll_for_event(xcb_connection)))
         {
-        case XCB_BUTTON_PRESS:
-        case XCB_BUTTON_RELEASE:
-            mir::log_verbose("XCB_BUTTON_RELEASE");
-            //(reinterpret_cast<xcb_button_press_event_t *>(event));
-            break;
-        case XCB_ENTER_NOTIFY:
-            mir::log_verbose("XCB_ENTER_NOTIFY");
-            //(reinterpret_cast<xcb_enter_notify_event_t *>(event));
-            break;
-        case XCB_LEAVE_NOTIFY:
-            mir::log_verbose("XCB_LEAVE_NOTIFY");
-            //(reinterpret_cast<xcb_leave_notify_event_t *>(event));
-            break;
-        case XCB_MOTION_NOTIFY:
-            mir::log_verbose("XCB_MOTION_NOTIFY");
-            //(reinterpret_cast<xcb_motion_notify_event_t *>(event));
-            break;
-        case XCB_CREATE_NOTIFY:
-            mir::log_verbose("XCB_CREATE_NOTIFY");
-            handle_create_notify(reinterpret_cast<xcb_create_notify_event_t *>(event));
-            break;
-        case XCB_MAP_REQUEST:
-            mir::log_verbose("XCB_MAP_REQUEST");
-            handle_map_request(reinterpret_cast<xcb_map_request_event_t *>(event));
-            break;
-        case XCB_MAP_NOTIFY:
-            mir::log_verbose("XCB_MAP_NOTIFY");
-            //(reinterpret_cast<xcb_map_notify_event_t *>(event));
-            break;
-        case XCB_UNMAP_NOTIFY:
-            mir::log_verbose("XCB_UNMAP_NOTIFY");
-            handle_unmap_notify(reinterpret_cast<xcb_unmap_notify_event_t *>(event));
-            break;
-        case XCB_REPARENT_NOTIFY:
-            mir::log_verbose("XCB_REPARENT_NOTIFY");
-            //(reinterpret_cast<xcb_reparent_notify_event_t *>(event));
-            break;
-        case XCB_CONFIGURE_REQUEST:
-            mir::log_verbose("XCB_CONFIGURE_REQUEST");
-            handle_configure_request(reinterpret_cast<xcb_configure_request_event_t *>(event));
-            break;
-        case XCB_CONFIGURE_NOTIFY:
-            mir::log_verbose("XCB_CONFIGURE_NOTIFY");
-            //(reinterpret_cast<xcb_configure_notify_event_t *>(event));
-            break;
-        case XCB_DESTROY_NOTIFY:
-            mir::log_verbose("XCB_DESTROY_NOTIFY");
-            handle_destroy_notify(reinterpret_cast<xcb_destroy_notify_event_t *>(event));
-            break;
-        case XCB_MAPPING_NOTIFY:
-            mir::log_verbose("XCB_MAPPING_NOTIFY");
-            break;
-        case XCB_PROPERTY_NOTIFY:
-            mir::log_verbose("XCB_PROPERTY_NOTIFY");
-            handle_property_notify(reinterpret_cast<xcb_property_notify_event_t *>(event));
-            break;
-        case XCB_CLIENT_MESSAGE:
-            mir::log_verbose("XCB_CLIENT_MESSAGE");
-            handle_client_message(reinterpret_cast<xcb_client_message_event_t *>(event));
-            break;
-        case XCB_FOCUS_IN:
-            mir::log_verbose("XCB_FOCUS_IN");
-            //(reinterpret_cast<xcb_focus_in_event_t *>(event));
-        default:
-            break;
+            int type = event->response_type & ~0x80;
+            switch (type)
+            {
+            case XCB_BUTTON_PRESS:
+            case XCB_BUTTON_RELEASE:
+                mir::log_verbose("XCB_BUTTON_RELEASE");
+                //(reinterpret_cast<xcb_button_press_event_t *>(event));
+                break;
+            case XCB_ENTER_NOTIFY:
+                mir::log_verbose("XCB_ENTER_NOTIFY");
+                //(reinterpret_cast<xcb_enter_notify_event_t *>(event));
+                break;
+            case XCB_LEAVE_NOTIFY:
+                mir::log_verbose("XCB_LEAVE_NOTIFY");
+                //(reinterpret_cast<xcb_leave_notify_event_t *>(event));
+                break;
+            case XCB_MOTION_NOTIFY:
+                mir::log_verbose("XCB_MOTION_NOTIFY");
+                //(reinterpret_cast<xcb_motion_notify_event_t *>(event));
+                break;
+            case XCB_CREATE_NOTIFY:
+                mir::log_verbose("XCB_CREATE_NOTIFY");
+                handle_create_notify(reinterpret_cast<xcb_create_notify_event_t *>(event));
+                break;
+            case XCB_MAP_REQUEST:
+                mir::log_verbose("XCB_MAP_REQUEST");
+                handle_map_request(reinterpret_cast<xcb_map_request_event_t *>(event));
+                break;
+            case XCB_MAP_NOTIFY:
+                mir::log_verbose("XCB_MAP_NOTIFY");
+                //(reinterpret_cast<xcb_map_notify_event_t *>(event));
+                break;
+            case XCB_UNMAP_NOTIFY:
+                mir::log_verbose("XCB_UNMAP_NOTIFY");
+                handle_unmap_notify(reinterpret_cast<xcb_unmap_notify_event_t *>(event));
+                break;
+            case XCB_REPARENT_NOTIFY:
+                mir::log_verbose("XCB_REPARENT_NOTIFY");
+                //(reinterpret_cast<xcb_reparent_notify_event_t *>(event));
+                break;
+            case XCB_CONFIGURE_REQUEST:
+                mir::log_verbose("XCB_CONFIGURE_REQUEST");
+                handle_configure_request(reinterpret_cast<xcb_configure_request_event_t *>(event));
+                break;
+            case XCB_CONFIGURE_NOTIFY:
+                mir::log_verbose("XCB_CONFIGURE_NOTIFY");
+                //(reinterpret_cast<xcb_configure_notify_event_t *>(event));
+                break;
+            case XCB_DESTROY_NOTIFY:
+                mir::log_verbose("XCB_DESTROY_NOTIFY");
+                handle_destroy_notify(reinterpret_cast<xcb_destroy_notify_event_t *>(event));
+                break;
+            case XCB_MAPPING_NOTIFY:
+                mir::log_verbose("XCB_MAPPING_NOTIFY");
+                break;
+            case XCB_PROPERTY_NOTIFY:
+                mir::log_verbose("XCB_PROPERTY_NOTIFY");
+                handle_property_notify(reinterpret_cast<xcb_property_notify_event_t *>(event));
+                break;
+            case XCB_CLIENT_MESSAGE:
+                mir::log_verbose("XCB_CLIENT_MESSAGE");
+                handle_client_message(reinterpret_cast<xcb_client_message_event_t *>(event));
+                break;
+            case XCB_FOCUS_IN:
+                mir::log_verbose("XCB_FOCUS_IN");
+                //(reinterpret_cast<xcb_focus_in_event_t *>(event));
+            default:
+                break;
+            }
+
+            free(event);
+            handled++;
         }
 
-        free(event);
-        count++;
+        handled += handle_property_replies();
+        count += handled;
     }
+    while (handled > 0);
 
+    // Requests made while handling all go out together
     if (count > 0)
     {
         xcb_flush(xcb_connection);
     }
 }
 
+void mf::XWaylandWM::get_property(XWaylandWMSurface *surface, xcb_window_t window, xcb_atom_t property,
+                                  std::function<void(xcb_get_property_reply_t *reply)> const &handler)
+{
+    auto const cookie = xcb_get_property(xcb_connection, 0, window, property, XCB_ATOM_ANY, 0, 2048);
+    pending_properties.expect(cookie.sequence,
+        [this, surface, window, handler](void *reply)
+        {
+            // The surface may have gone while we waited
+            auto const found = surfaces.find(window);
+            if (found != surfaces.end() && found->second.get() == surface)
+                handler(static_cast<xcb_get_property_reply_t *>(reply));
+        });
+}
+
+int mf::XWaylandWM::handle_property_replies()
+{
+    return pending_properties.handle_arrived(
+        [this](unsigned int sequence, void **reply)
+        {
+            xcb_generic_error_t *error = nullptr;
+            auto const arrived = xcb_poll_for_reply(xcb_connection, sequence, reply, &error);
+            free(error);
+            return arrived != 0;
+        });
+}
+
 void mf::XWaylandWM::handle_property_notify(xcb_property_notify_event_t *event)
 {
     mir::log_verbose("XCB_PROPERTY_NOTIFY (window %d)", event->window);
 
-    auto surface = surfaces[event->window];
-    if (!surface)
+    auto const surface = surfaces.find(event->window);
+    if (surface == surfaces.end())
         return;
 
-    surface->dirty_properties();
-
     if (event->state == XCB_PROPERTY_DELETE)
         mir::log_verbose("XCB_PROPERTY_NOTIFY: deleted");
-    else
-        read_and_dump_property(event->window, event->atom);
+
+    surface->second->read_property(event->atom);
 }
 
 void mf::XWaylandWM::handle_create_notify(xcb_create_notify_event_t *event)
@@ -392,12 +432,15 @@ void mf::XWaylandWM::handle_map_request(xcb_map_request_event_t *event)
 
     mir::log_verbose("XCB_MAP_REQUEST (window %d)", event->window);
 
-    surface->read_properties();
-    surface->set_wm_state(XWaylandWMSurface::NormalState);
-    surface->set_net_wm_state();
-    surface->set_workspace(0);
-    xcb_map_window(xcb_connection, event->window);
-    xcb_flush(xcb_connection);
+    // The window state depends on the properties, so map once they are in
+    surface->read_properties(
+        [this, surface, window = event->window]()
+        {
+            surface->set_wm_state(XWaylandWMSurface::NormalState);
+            surface->set_net_wm_state();
+            surface->set_workspace(0);
+            xcb_map_window(xcb_connection, window);
+        });
 }
 
 void mf::XWaylandWM::handle_unmap_notify(xcb_unmap_notify_event_t *event)
@@ -422,7 +465,6 @@ void mf::XWaylandWM::handle_unmap_notify(xcb_unmap_notify_event_t *event)
     surface->set_wm_state(XWaylandWMSurface::WithdrawnState);
     surface->set_workspace(-1);
     xcb_unmap_window(xcb_connection, event->window);
-    xcb_flush(xcb_connection);
 }
 
 void mf::XWaylandWM::handle_client_message(xcb_client_message_event_t *event)
@@ -549,7 +591,6 @@ void mf::XWaylandWM::handle_configure_request(xcb_configure_request_event_t *eve
     if (i >= 0)
     {
         xcb_configure_window(xcb_connection, event->window, event->value_mask, values);
-        xcb_flush(xcb_connection);
     }
 }
 
@@ -597,29 +638,15 @@ xcb_cursor_t mf::XWaylandWM::xcb_cursor_images_load_cursor(const XcursorImages *
 
 xcb_cursor_t mf::XWaylandWM::xcb_cursor_library_load_cursor(const char *file)
 {
-    xcb_cursor_t cursor;
-    XcursorImages *images;
-    char *v = NULL;
-    int size = 0;
-
     if (!file)
         return 0;
 
-    v = getenv("XCURSOR_SIZE");
-    if (v)
-        size = atoi(v);
-
-    if (!size)
-        size = 32;
-
-    images = XcursorLibraryLoadImages(file, NULL, size);
+    // The images outlive the X server, but the cursor made from them is its own
+    auto const images = cursor_images.get(file);
     if (!images)
         return -1;
 
-    cursor = xcb_cursor_images_load_cursor(images);
-    XcursorImagesDestroy(images);
-
-    return cursor;
+    return xcb_cursor_images_load_cursor(images);
 }
 
 void mf::XWaylandWM::wm_get_resources()
@@ -716,18 +743,22 @@ void mf::XWaylandWM::wm_get_resources()
     for (i = 0; i < ARRAY_LENGTH(atoms); i++)
         cookies[i] = xcb_intern_atom(xcb_connection, 0, strlen(atoms[i].name), atoms[i].name);
 
+    // Ask for the xfixes version before collecting the atoms, so that all
+    // of this costs about one round trip
+    xfixes = xcb_get_extension_data(xcb_connection, &xcb_xfixes_id);
+    if (!xfixes || !xfixes->present)
+        mir::log_warning("xfixes not available");
+
+    xfixes_cookie = xcb_xfixes_query_version(xcb_connection, XCB_XFIXES_MAJOR_VERSION, XCB_XFIXES_MINOR_VERSION);
+
     for (i = 0; i < ARRAY_LENGTH(atoms); i++)
     {
         reply = xcb_intern_atom_reply(xcb_connection, cookies[i], NULL);
         *(xcb_atom_t *)((char *)&xcb_atom + atoms[i].offset) = reply->atom;
+        atom_names[reply->atom] = atoms[i].name;
         free(reply);
     }
 
-    xfixes = xcb_get_extension_data(xcb_connection, &xcb_xfixes_id);
-    if (!xfixes || !xfixes->present)
-        mir::log_warning("xfixes not available");
-
-    xfixes_cookie = xcb_xfixes_query_version(xcb_connection, XCB_XFIXES_MAJOR_VERSION, XCB_XFIXES_MINOR_VERSION);
     xfixes_reply = xcb_xfixes_query_version_reply(xcb_connection, xfixes_cookie, NULL);
 
     mir::log_verbose("xfixes version: %d.%d", xfixes_reply->major_version, xfixes_reply->minor_version);
@@ -753,19 +784,6 @@ void mf::XWaylandWM::wm_get_resources()
     free(formats_reply);
 }
 
-void mf::XWaylandWM::read_and_dump_property(xcb_window_t window, xcb_atom_t property)
-{
-    xcb_get_property_reply_t *reply;
-    xcb_get_property_cookie_t cookie;
-
-    cookie = xcb_get_property(xcb_connection, 0, window, property, XCB_ATOM_ANY, 0, 2048);
-    reply = xcb_get_property_reply(xcb_connection, cookie, NULL);
-
-    dump_property(property, reply);
-
-    free(reply);
-}
-
 void mf::XWaylandWM::dump_property(xcb_atom_t property, xcb_get_property_reply_t *reply)
 {
     int32_t *incr_value;
@@ -823,20 +841,24 @@ const char *mf::XWaylandWM::get_atom_name(xcb_atom_t atom)
     if (atom == XCB_ATOM_NONE)
         return "None";
 
+    // Atoms never change their names, so each costs a round trip at most once
+    auto const known = atom_names.find(atom);
+    if (known != atom_names.end())
+        return known->second.c_str();
+
     cookie = xcb_get_atom_name(xcb_connection, atom);
     reply = xcb_get_atom_name_reply(xcb_connection, cookie, &e);
 
     if (reply)
     {
-        snprintf(buffer, sizeof buffer, "%.*s", xcb_get_atom_name_name_length(reply), xcb_get_atom_name_name(reply));
-    }
-    else
-    {
-        snprintf(buffer, sizeof buffer, "(atom %u)", atom);
+        auto const& name = atom_names[atom] =
+            std::string{xcb_get_atom_name_name(reply), size_t(xcb_get_atom_name_name_length(reply))};
+        free(reply);
+        return name.c_str();
     }
 
-    free(reply);
-
+    free(e);
+    snprintf(buffer, sizeof buffer, "(atom %u)", atom);
     return buffer;
 }
 
@@ -18,12 +18,17 @@
 #ifndef MIR_FRONTEND_XWAYLAND_WM_H
 #define MIR_FRONTEND_XWAYLAND_WM_H
 
+#include <functional>
 #include <map>
+#include <string>
 #include <thread>
+#include <unordered_map>
 #include <wayland-server-core.h>
 
 #include "mir/dispatch/threaded_dispatcher.h"
 #include "wayland_connector.h"
+#include "xwayland_cursor_images.h"
+#include "xwayland_pending_replies.h"
 
 extern "C" {
 #include <X11/Xcursor/Xcursor.h>
@@ -125,6 +130,10 @@ public:
         return wm_dispatcher;
     }
     void dump_property(xcb_atom_t property, xcb_get_property_reply_t *reply);
+    /// Requests a property of surface's window; handler gets the reply (or nullptr on error) once it
+    /// arrives, unless the surface has gone by then. Replies are handled in the order requested.
+    void get_property(XWaylandWMSurface *surface, xcb_window_t window, xcb_atom_t property,
+                      std::function<void(xcb_get_property_reply_t *reply)> const &handler);
     void set_net_active_window(xcb_window_t window);
     std::shared_ptr<WaylandConnector> get_wl_connector()
     {
@@ -159,13 +168,13 @@ private:
     void set_cursor(xcb_window_t id, const CursorType &cursor);
     void create_wm_cursor();
     void wm_get_resources();
-    void read_and_dump_property(xcb_window_t window, xcb_atom_t property);
     const char *get_atom_name(xcb_atom_t atom);
     bool is_ours(uint32_t id);
     void setup_visual_and_colormap();
 
     // Event handeling
     void handle_events();
+    int handle_property_replies();
     void run_event_loop();
 
     // Events
@@ -205,6 +214,10 @@ private:
     wl_client *wlclient;
     xcb_visualid_t xcb_visual_id;
     xcb_colormap_t xcb_colormap;
+    XWaylandCursorImages cursor_images;
+
+    XWaylandPendingReplies pending_properties;
+    std::unordered_map<xcb_atom_t, std::string> atom_names;
 };
 } /* frontend */
 } /* mir */
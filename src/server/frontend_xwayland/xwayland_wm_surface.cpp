@@ -32,21 +32,36 @@
 
 namespace mf = mir::frontend;
 
+namespace
+{
+// The properties we act on, and how to interpret each. XCB_ATOM_NONE for the rest.
+xcb_atom_t property_type(atom_t const& atoms, xcb_atom_t property)
+{
+    if (property == XCB_ATOM_WM_CLASS || property == XCB_ATOM_WM_NAME || property == atoms.net_wm_name)
+        return XCB_ATOM_STRING;
+    if (property == XCB_ATOM_WM_TRANSIENT_FOR)
+        return XCB_ATOM_WINDOW;
+    if (property == atoms.wm_protocols)
+        return TYPE_WM_PROTOCOLS;
+    if (property == atoms.wm_normal_hints)
+        return TYPE_WM_NORMAL_HINTS;
+    if (property == atoms.net_wm_state)
+        return TYPE_NET_WM_STATE;
+    if (property == atoms.net_wm_window_type)
+        return XCB_ATOM_ATOM;
+    if (property == atoms.motif_wm_hints)
+        return TYPE_MOTIF_WM_HINTS;
+    return XCB_ATOM_NONE;
+}
+}
+
 mf::XWaylandWMSurface::XWaylandWMSurface(XWaylandWM *wm, xcb_window_t window)
     : xwm(wm), window(window), props_dirty(true)
 {
     uint32_t values[1];
-    xcb_get_geometry_cookie_t geometry_cookie;
-    xcb_get_geometry_reply_t *geometry_reply;
-
-    geometry_cookie = xcb_get_geometry(xwm->get_xcb_connection(), window);
 
     values[0] = XCB_EVENT_MASK_PROPERTY_CHANGE | XCB_EVENT_MASK_FOCUS_CHANGE;
     xcb_change_window_attributes(xwm->get_xcb_connection(), window, XCB_CW_EVENT_MASK, values);
-
-    geometry_reply = xcb_get_geometry_reply(xwm->get_xcb_connection(), geometry_cookie, NULL);
-    if (geometry_reply == NULL)
-        mir::log_error("xcb gemom reply faled");
 }
 
 mf::XWaylandWMSurface::~XWaylandWMSurface()
@@ -54,11 +69,6 @@ mf::XWaylandWMSurface::~XWaylandWMSurface()
     destroyed = true;
 }
 
-void mf::XWaylandWMSurface::dirty_properties()
-{
-    props_dirty = true;
-}
-
 void mf::XWaylandWMSurface::set_surface_id(uint32_t id)
 {
     surface_id = id;
@@ -76,7 +86,6 @@ void mf::XWaylandWMSurface::set_surface(WlSurface *wls)
       shell_surface->set_title(properties.title);
 
     shell_surface->set_toplevel();
-    xcb_flush(xwm->get_xcb_connection());
 }
 
 void mf::XWaylandWMSurface::set_workspace(int workspace)
@@ -91,7 +100,6 @@ void mf::XWaylandWMSurface::set_workspace(int workspace)
     {
         xcb_delete_property(xwm->get_xcb_connection(), window, xwm->xcb_atom.net_wm_desktop);
     }
-    xcb_flush(xwm->get_xcb_connection());
 }
 
 void mf::XWaylandWMSurface::set_wm_state(WmState state)
@@ -102,7 +110,6 @@ void mf::XWaylandWMSurface::set_wm_state(WmState state)
 
     xcb_change_property(xwm->get_xcb_connection(), XCB_PROP_MODE_REPLACE, window, xwm->xcb_atom.wm_state,
                         xwm->xcb_atom.wm_state, 32, 2, property);
-    xcb_flush(xwm->get_xcb_connection());
 }
 
 void mf::XWaylandWMSurface::set_net_wm_state()
@@ -120,33 +127,17 @@ void mf::XWaylandWMSurface::set_net_wm_state()
 
     xcb_change_property(xwm->get_xcb_connection(), XCB_PROP_MODE_REPLACE, window, xwm->xcb_atom.net_wm_state,
                         XCB_ATOM_ATOM, 32, i, property);
-    xcb_flush(xwm->get_xcb_connection());
 }
 
-void mf::XWaylandWMSurface::read_properties()
+void mf::XWaylandWMSurface::read_properties(std::function<void()> const& then)
 {
+    // Once read, properties are kept up to date by read_property()
     if (!props_dirty)
-        return;
-    props_dirty = false;
-
-    std::map<xcb_atom_t, xcb_atom_t> props;
-    props[XCB_ATOM_WM_CLASS] = XCB_ATOM_STRING;
-    props[XCB_ATOM_WM_NAME] = XCB_ATOM_STRING;
-    props[XCB_ATOM_WM_TRANSIENT_FOR] = XCB_ATOM_WINDOW;
-    props[xwm->xcb_atom.wm_protocols] = TYPE_WM_PROTOCOLS;
-    props[xwm->xcb_atom.wm_normal_hints] = TYPE_WM_NORMAL_HINTS;
-    props[xwm->xcb_atom.net_wm_state] = TYPE_NET_WM_STATE;
-    props[xwm->xcb_atom.net_wm_window_type] = XCB_ATOM_ATOM;
-    props[xwm->xcb_atom.net_wm_name] = XCB_ATOM_STRING;
-    props[xwm->xcb_atom.motif_wm_hints] = TYPE_MOTIF_WM_HINTS;
-
-    std::map<xcb_atom_t, xcb_get_property_cookie_t> cookies;
-    for (const auto &atom : props)
     {
-        xcb_get_property_cookie_t cookie =
-            xcb_get_property(xwm->get_xcb_connection(), 0, window, atom.first, XCB_ATOM_ANY, 0, 2048);
-        cookies[atom.first] = cookie;
+        then();
+        return;
     }
+    props_dirty = false;
 
     properties.deleteWindow = 0;
 
@@ -157,98 +148,133 @@ void mf::XWaylandWMSurface::read_properties()
 
     mir::log_verbose("Properties:");
 
-    for (const auto &atom_ptr : props)
+    xcb_atom_t const atoms[] = {
+        XCB_ATOM_WM_CLASS,
+        XCB_ATOM_WM_NAME,
+        XCB_ATOM_WM_TRANSIENT_FOR,
+        xwm->xcb_atom.wm_protocols,
+        xwm->xcb_atom.wm_normal_hints,
+        xwm->xcb_atom.net_wm_state,
+        xwm->xcb_atom.net_wm_window_type,
+        xwm->xcb_atom.net_wm_name,
+        xwm->xcb_atom.motif_wm_hints};
+
+    // All the requests go out together; the replies come back in order, so
+    // the last of them completes the set
+    auto const count = sizeof atoms / sizeof atoms[0];
+    for (auto i = 0u; i != count; ++i)
     {
-        xcb_atom_t atom = atom_ptr.first;
-        xcb_get_property_reply_t *reply = xcb_get_property_reply(xwm->get_xcb_connection(), cookies[atom], nullptr);
-        if (!reply)
-        {
-            mir::log_verbose("read_properties: Bad window, usually");
-            continue;
-        }
+        auto const atom = atoms[i];
+        bool const last = i == count - 1;
+        xwm->get_property(this, window, atom,
+            [this, atom, last, then](xcb_get_property_reply_t *reply)
+            {
+                apply_property(atom, reply);
+                if (last)
+                    then();
+            });
+    }
+}
 
-        if (reply->type == XCB_ATOM_NONE)
+void mf::XWaylandWMSurface::read_property(xcb_atom_t property)
+{
+    // Anything read before the window is first mapped would be read again
+    if (props_dirty || property_type(xwm->xcb_atom, property) == XCB_ATOM_NONE)
+        return;
+
+    xwm->get_property(this, window, property,
+        [this, property](xcb_get_property_reply_t *reply)
         {
-            mir::log_verbose("read_properties: No such info");
-            free(reply);
-            continue;
-        }
+            apply_property(property, reply);
+        });
+}
+
+void mf::XWaylandWMSurface::apply_property(xcb_atom_t atom, xcb_get_property_reply_t *reply)
+{
+    if (!reply)
+    {
+        mir::log_verbose("read_properties: Bad window, usually");
+        return;
+    }
 
-        xwm->dump_property(atom, reply);
+    if (reply->type == XCB_ATOM_NONE)
+    {
+        mir::log_verbose("read_properties: No such info");
+        return;
+    }
 
-        switch (props[atom])
-        {
-        case XCB_ATOM_STRING:
-        {
-            char *p = strndup(reinterpret_cast<char *>(xcb_get_property_value(reply)),
-                              xcb_get_property_value_length(reply));
-            if (atom == XCB_ATOM_WM_CLASS) {
-                properties.appId = std::string(p);
-            } else if (atom == XCB_ATOM_WM_NAME || xwm->xcb_atom.net_wm_name) {
-                properties.title = std::string(p);
-            } else {
-                free(p);
-            }
-            mir::log_verbose("XCB_ATOM_STRING");
-            break;
+    xwm->dump_property(atom, reply);
+
+    switch (property_type(xwm->xcb_atom, atom))
+    {
+    case XCB_ATOM_STRING:
+    {
+        char *p = strndup(reinterpret_cast<char *>(xcb_get_property_value(reply)),
+                          xcb_get_property_value_length(reply));
+        if (atom == XCB_ATOM_WM_CLASS) {
+            properties.appId = std::string(p);
+        } else if (atom == XCB_ATOM_WM_NAME || xwm->xcb_atom.net_wm_name) {
+            properties.title = std::string(p);
+        } else {
+            free(p);
         }
-        case XCB_ATOM_WINDOW:
+        mir::log_verbose("XCB_ATOM_STRING");
+        break;
+    }
+    case XCB_ATOM_WINDOW:
+    {
+        mir::log_verbose("XCB_ATOM_WINDOW");
+        break;
+    }
+    case XCB_ATOM_ATOM:
+    {
+        if (atom == xwm->xcb_atom.net_wm_window_type)
         {
-            mir::log_verbose("XCB_ATOM_WINDOW");
-            break;
+            mir::log_verbose("XCB_ATOM_ATOM net_wm_window_type");
         }
-        case XCB_ATOM_ATOM:
+        break;
+    }
+    case TYPE_WM_PROTOCOLS:
+    {
+        mir::log_verbose("TYPE_WM_PROTOCOLS");
+        xcb_atom_t *atoms = reinterpret_cast<xcb_atom_t *>(xcb_get_property_value(reply));
+        for (uint32_t i = 0; i < reply->value_len; ++i)
+            if (atoms[i] == xwm->xcb_atom.wm_delete_window)
+                properties.deleteWindow = 1;
+        break;
+    }
+    case TYPE_WM_NORMAL_HINTS:
+    {
+        mir::log_verbose("TYPE_WM_NORMAL_HINTS");
+        break;
+    }
+    case TYPE_NET_WM_STATE:
+    {
+        mir::log_verbose("TYPE_NET_WM_STATE");
+        xcb_atom_t *value = reinterpret_cast<xcb_atom_t *>(xcb_get_property_value(reply));
+        uint32_t i;
+        for (i = 0; i < reply->value_len; i++)
         {
-            if (atom == xwm->xcb_atom.net_wm_window_type)
+            if (value[i] == xwm->xcb_atom.net_wm_state_fullscreen && !fullscreen)
             {
-                mir::log_verbose("XCB_ATOM_ATOM net_wm_window_type");
+                fullscreen = true;
             }
-            break;
-        }
-        case TYPE_WM_PROTOCOLS:
-        {
-            mir::log_verbose("TYPE_WM_PROTOCOLS");
-            xcb_atom_t *atoms = reinterpret_cast<xcb_atom_t *>(xcb_get_property_value(reply));
-            for (uint32_t i = 0; i < reply->value_len; ++i)
-                if (atoms[i] == xwm->xcb_atom.wm_delete_window)
-                    properties.deleteWindow = 1;
-            break;
         }
-        case TYPE_WM_NORMAL_HINTS:
+        if (value[i] == xwm->xcb_atom.net_wm_state_maximized_horz && !maximized)
         {
-            mir::log_verbose("TYPE_WM_NORMAL_HINTS");
-            break;
+            maximized = true;
         }
-        case TYPE_NET_WM_STATE:
+        if (value[i] == xwm->xcb_atom.net_wm_state_maximized_vert && !maximized)
         {
-            mir::log_verbose("TYPE_NET_WM_STATE");
-            xcb_atom_t *value = reinterpret_cast<xcb_atom_t *>(xcb_get_property_value(reply));
-            uint32_t i;
-            for (i = 0; i < reply->value_len; i++)
-            {
-                if (value[i] == xwm->xcb_atom.net_wm_state_fullscreen && !fullscreen)
-                {
-                    fullscreen = true;
-                }
-            }
-            if (value[i] == xwm->xcb_atom.net_wm_state_maximized_horz && !maximized)
-            {
-                maximized = true;
-            }
-            if (value[i] == xwm->xcb_atom.net_wm_state_maximized_vert && !maximized)
-            {
-                maximized = true;
-            }
-            break;
-        }
-        case TYPE_MOTIF_WM_HINTS:
-            mir::log_verbose("TYPE_MOTIF_WM_HINTS");
-            break;
-        default:
-            break;
+            maximized = true;
         }
-
-        free(reply);
+        break;
+    }
+    case TYPE_MOTIF_WM_HINTS:
+        mir::log_verbose("TYPE_MOTIF_WM_HINTS");
+        break;
+    default:
+        break;
     }
 }
 
@@ -129,8 +129,10 @@ public:
 
     XWaylandWMSurface(XWaylandWM *wm, xcb_window_t window);
     ~XWaylandWMSurface();
-    void dirty_properties();
-    void read_properties();
+    /// Requests the window's properties, calling then() once they have all been read
+    void read_properties(std::function<void()> const& then);
+    /// Refreshes a single property after the client changed it
+    void read_property(xcb_atom_t property);
     void set_surface_id(uint32_t surface_id);
     void set_surface(WlSurface *wls);
     void set_workspace(int workspace);
@@ -171,6 +173,8 @@ private:
     } properties;
 
     bool decorate;
+
+    void apply_property(xcb_atom_t property, xcb_get_property_reply_t *reply);
 };
 } /* frontend */
 } /* mir */
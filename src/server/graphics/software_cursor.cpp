@@ -101,6 +101,11 @@ public:
         return true;
     }
 
+    geom::Region opaque_region() const override
+    {
+        return {};
+    }
+
     void move_to(geom::Point new_position)
     {
         std::lock_guard<std::mutex> lock{position_mutex};
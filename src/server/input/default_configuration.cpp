@@ -143,7 +143,7 @@ mir::DefaultServerConfiguration::the_input_dispatcher()
                 !options->is_set(options::host_socket_opt);
 
             return std::make_shared<mi::KeyRepeatDispatcher>(
-                the_event_filter_chain_dispatcher(), the_main_loop(), the_cookie_authority(),
+                the_event_filter_chain_dispatcher(), the_main_loop(), the_clock(),
                 enable_repeat, key_repeat_timeout, key_repeat_delay, false);
         });
 }
@@ -319,7 +319,6 @@ std::shared_ptr<mi::DefaultInputDeviceHub> mir::DefaultServerConfiguration::the_
            auto hub = std::make_shared<mi::DefaultInputDeviceHub>(
                the_seat(),
                the_input_reading_multiplexer(),
-               the_cookie_authority(),
                the_key_mapper(),
                the_server_status_listener());
 
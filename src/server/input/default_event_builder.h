@@ -25,10 +25,6 @@
 
 namespace mir
 {
-namespace cookie
-{
-class Authority;
-}
 namespace input
 {
 class Seat;
@@ -37,7 +33,6 @@ class DefaultEventBuilder : public EventBuilder
 {
 public:
     explicit DefaultEventBuilder(MirInputDeviceId device_id,
-                                 std::shared_ptr<cookie::Authority> const& cookie_authority,
                                  std::shared_ptr<Seat> const& seat);
 
     EventUPtr key_event(Timestamp timestamp, MirKeyboardAction action, xkb_keysym_t key_code, int scan_code) override;
@@ -57,7 +52,6 @@ public:
 
 private:
     MirInputDeviceId const device_id;
-    std::shared_ptr<cookie::Authority> const cookie_authority;
     std::shared_ptr<Seat> const seat;
 };
 }
@@ -22,8 +22,8 @@
 #include "mir/input/input_device_hub.h"
 #include "mir/time/alarm_factory.h"
 #include "mir/time/alarm.h"
+#include "mir/time/clock.h"
 #include "mir/events/event_builders.h"
-#include "mir/cookie/authority.h"
 
 #include <boost/throw_exception.hpp>
 
@@ -70,18 +70,19 @@ struct DeviceRemovalFilter : mi::InputDeviceObserver
 mi::KeyRepeatDispatcher::KeyRepeatDispatcher(
     std::shared_ptr<mi::InputDispatcher> const& next_dispatcher,
     std::shared_ptr<mir::time::AlarmFactory> const& factory,
-    std::shared_ptr<mir::cookie::Authority> const& cookie_authority,
+    std::shared_ptr<mir::time::Clock> const& clock,
     bool repeat_enabled,
     std::chrono::milliseconds repeat_timeout,
     std::chrono::milliseconds repeat_delay,
     bool disable_repeat_on_touchscreen)
     : next_dispatcher(next_dispatcher),
       alarm_factory(factory),
-      cookie_authority(cookie_authority),
+      clock(clock),
       repeat_enabled(repeat_enabled),
       repeat_timeout(repeat_timeout),
       repeat_delay(repeat_delay),
-      disable_repeat_on_touchscreen(disable_repeat_on_touchscreen)
+      disable_repeat_on_touchscreen(disable_repeat_on_touchscreen),
+      repeats(clock->now(), repeat_delay)
 {
 }
 
@@ -99,15 +100,60 @@ void mi::KeyRepeatDispatcher::set_touch_button_device(MirInputDeviceId id)
 void mi::KeyRepeatDispatcher::remove_device(MirInputDeviceId id)
 {
     std::lock_guard<std::mutex> lock(repeat_state_mutex);
-    repeat_state_by_device.erase(id); // destructor cancels alarms
+    repeats.remove_device(id);
     if (touch_button_device.is_set() && touch_button_device.value() == id)
         touch_button_device.consume();
 }
 
-mi::KeyRepeatDispatcher::KeyboardState& mi::KeyRepeatDispatcher::ensure_state_for_device_locked(std::lock_guard<std::mutex> const&, MirInputDeviceId id)
+void mi::KeyRepeatDispatcher::schedule_alarm_locked(std::lock_guard<std::mutex> const&)
 {
-    repeat_state_by_device.insert(std::make_pair(id, KeyboardState()));
-    return repeat_state_by_device[id];
+    auto const next_expiry = repeats.next_expiry();
+    if (!next_expiry || (alarm_time && alarm_time.value() <= next_expiry.value()))
+        return;
+
+    if (!repeat_alarm)
+        repeat_alarm = alarm_factory->create_alarm([this] { send_due_repeats(); });
+
+    // An absolute deadline: time spent getting round to the alarm does not
+    // push back the repeats that follow
+    repeat_alarm->reschedule_for(next_expiry.value());
+    alarm_time = next_expiry;
+}
+
+void mi::KeyRepeatDispatcher::send_due_repeats()
+{
+    std::lock_guard<std::mutex> dispatch_lock(dispatch_mutex);
+    {
+        std::lock_guard<std::mutex> lg(repeat_state_mutex);
+        alarm_time = optional_value<time::Timestamp>{};
+        repeats.expire(clock->now(), due_repeats);
+        schedule_alarm_locked(lg);
+        std::swap(due_repeats, dispatching_repeats);
+    }
+
+    for (auto const& repeat : dispatching_repeats)
+    {
+        {
+            // The device may have been removed since the repeat fell due
+            std::lock_guard<std::mutex> lg(repeat_state_mutex);
+            if (!repeats.contains(repeat.device, repeat.scan_code))
+                continue;
+        }
+        send_repeat(repeat);
+    }
+    dispatching_repeats.clear();
+}
+
+void mi::KeyRepeatDispatcher::send_repeat(KeyRepeat const& repeat)
+{
+    next_dispatcher->dispatch(mev::make_event(
+        repeat.device,
+        repeat.due.time_since_epoch(),
+        std::vector<uint8_t>{},
+        mir_keyboard_action_repeat,
+        repeat.key_code,
+        repeat.scan_code,
+        repeat.modifiers));
 }
 
 bool mi::KeyRepeatDispatcher::dispatch(std::shared_ptr<MirEvent const> const& event)
@@ -126,6 +172,7 @@ bool mi::KeyRepeatDispatcher::dispatch(std::shared_ptr<MirEvent const> const& ev
         if (disable_repeat_on_touchscreen && touch_button_device.is_set() && device_id == touch_button_device.value())
             return next_dispatcher->dispatch(event);
 
+        std::lock_guard<std::mutex> dispatch_lock(dispatch_mutex);
         if (!handle_key_input(mir_input_event_get_device_id(iev), mir_input_event_get_keyboard_event(iev)))
             return next_dispatcher->dispatch(event);
         else
@@ -138,58 +185,32 @@ bool mi::KeyRepeatDispatcher::dispatch(std::shared_ptr<MirEvent const> const& ev
 bool mi::KeyRepeatDispatcher::handle_key_input(MirInputDeviceId id, MirKeyboardEvent const* kev)
 {
     std::lock_guard<std::mutex> lg(repeat_state_mutex);
-    auto& device_state = ensure_state_for_device_locked(lg, id);
 
     auto scan_code = mir_keyboard_event_scan_code(kev);
 
     switch (mir_keyboard_event_action(kev))
     {
     case mir_keyboard_action_up:
-    {
-        auto it = device_state.repeat_alarms_by_scancode.find(scan_code);
-        if (it == device_state.repeat_alarms_by_scancode.end())
-        {
-            return false;
-        }
-        device_state.repeat_alarms_by_scancode.erase(it);
+        repeats.remove(id, scan_code);
         break;
-    }
     case mir_keyboard_action_down:
     {
-        auto clone_event = [scan_code, id, this,
-             key_code = mir_keyboard_event_key_code(kev),
-             modifiers = mir_keyboard_event_modifiers(kev)]()
-             {
-                 auto const now = std::chrono::steady_clock::now().time_since_epoch();
-                 auto const cookie = cookie_authority->make_cookie(now.count());
-                 auto new_event = mev::make_event(
-                     id,
-                     now,
-                     cookie->serialize(),
-                     mir_keyboard_action_repeat,
-                     key_code,
-                     scan_code,
-                     modifiers);
-                 next_dispatcher->dispatch(std::move(new_event));
-             };
-
-        auto it = device_state.repeat_alarms_by_scancode.find(scan_code);
-        if (it != device_state.repeat_alarms_by_scancode.end())
+        KeyRepeat repeat{
+            id,
+            scan_code,
+            mir_keyboard_event_key_code(kev),
+            mir_keyboard_event_modifiers(kev),
+            clock->now()};
+
+        if (repeats.contains(id, scan_code))
         {
             // When we receive a duplicated down we just replace the action
-            clone_event();
+            send_repeat(repeat);
             return true;
         }
-        auto& capture_alarm = device_state.repeat_alarms_by_scancode[scan_code];
-        std::shared_ptr<mir::time::Alarm> alarm = alarm_factory->create_alarm(
-            [repeat_delay=repeat_delay, clone_event, &capture_alarm]()
-            {
-                clone_event();
-
-                capture_alarm->reschedule_in(repeat_delay);
-            });
-        alarm->reschedule_in(repeat_timeout);
-        device_state.repeat_alarms_by_scancode[scan_code] = {alarm};
+        repeat.due += repeat_timeout;
+        repeats.add(repeat);
+        schedule_alarm_locked(lg);
     }
     case mir_keyboard_action_repeat:
         // Should we consume existing repeats?
@@ -209,7 +230,7 @@ void mi::KeyRepeatDispatcher::stop()
 {
     std::lock_guard<std::mutex> lg(repeat_state_mutex);
 
-    repeat_state_by_device.clear();
+    repeats.clear();
 
     next_dispatcher->stop();
 }
@@ -22,22 +22,20 @@
 #include "mir/input/input_dispatcher.h"
 #include "mir/input/input_device_observer.h"
 #include "mir/optional_value.h"
+#include "mir/time/alarm.h"
+#include "key_repeat_wheel.h"
 
 #include <memory>
 #include <chrono>
 #include <mutex>
-#include <unordered_map>
+#include <vector>
 
 namespace mir
 {
-namespace cookie
-{
-class Authority;
-}
 namespace time
 {
 class AlarmFactory;
-class Alarm;
+class Clock;
 }
 namespace input
 {
@@ -47,7 +45,7 @@ class KeyRepeatDispatcher : public InputDispatcher
 public:
     KeyRepeatDispatcher(std::shared_ptr<InputDispatcher> const& next_dispatcher,
                         std::shared_ptr<time::AlarmFactory> const& factory,
-                        std::shared_ptr<cookie::Authority> const& cookie_authority,
+                        std::shared_ptr<time::Clock> const& clock,
                         bool repeat_enabled,
                         std::chrono::milliseconds repeat_timeout, /* timeout before sending first repeat */
                         std::chrono::milliseconds repeat_delay, /* delay between repeated keys */
@@ -64,22 +62,29 @@ public:
     void remove_device(MirInputDeviceId id);
 private:
     std::mutex repeat_state_mutex;
+    // Held while sending key events on, so a repeat can't overtake its key's release
+    std::mutex dispatch_mutex;
 
     std::shared_ptr<InputDispatcher> const next_dispatcher;
     std::shared_ptr<time::AlarmFactory> const alarm_factory;
-    std::shared_ptr<cookie::Authority> const cookie_authority;
+    std::shared_ptr<time::Clock> const clock;
     bool const repeat_enabled;
     std::chrono::milliseconds repeat_timeout;
     std::chrono::milliseconds const repeat_delay;
     bool const disable_repeat_on_touchscreen;
     optional_value<MirInputDeviceId> touch_button_device;
 
-    struct KeyboardState
-    {
-        std::unordered_map<int, std::shared_ptr<mir::time::Alarm>> repeat_alarms_by_scancode;
-    };
-    std::unordered_map<MirInputDeviceId, KeyboardState> repeat_state_by_device;
-    KeyboardState& ensure_state_for_device_locked(std::lock_guard<std::mutex> const&, MirInputDeviceId id);
+    // One alarm serves the held keys of every device: it wakes for whichever
+    // repeat is due first and sends all that are due together
+    KeyRepeatWheel repeats;
+    std::unique_ptr<time::Alarm> repeat_alarm;
+    optional_value<time::Timestamp> alarm_time;
+    std::vector<KeyRepeat> due_repeats;
+    std::vector<KeyRepeat> dispatching_repeats;
+
+    void schedule_alarm_locked(std::lock_guard<std::mutex> const&);
+    void send_due_repeats();
+    void send_repeat(KeyRepeat const& repeat);
 
     bool handle_key_input(MirInputDeviceId id, MirKeyboardEvent const* ev);
 };
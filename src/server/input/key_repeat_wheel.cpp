@@ -0,0 +1,230 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "key_repeat_wheel.h"
+
+namespace mi = mir::input;
+
+namespace
+{
+std::chrono::milliseconds const tick_length{1};
+}
+
+mi::KeyRepeatWheel::KeyRepeatWheel(time::Timestamp origin, std::chrono::milliseconds repeat_delay)
+    : origin{origin},
+      repeat_delay{repeat_delay}
+{
+    clear();
+}
+
+auto mi::KeyRepeatWheel::first_tick_not_before(time::Timestamp t) const -> Tick
+{
+    auto const since_origin = t - origin;
+    auto const tick = std::chrono::duration_cast<std::chrono::milliseconds>(since_origin).count();
+    return since_origin > tick * tick_length ? tick + 1 : tick;
+}
+
+auto mi::KeyRepeatWheel::last_tick_not_after(time::Timestamp t) const -> Tick
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(t - origin).count();
+}
+
+void mi::KeyRepeatWheel::link(std::size_t index)
+{
+    auto& entry = entries[index];
+    auto const slot = entry.due_tick % slot_count;
+
+    entry.previous = none;
+    entry.next = slots[slot];
+    if (entry.next != none)
+        entries[entry.next].previous = index;
+    slots[slot] = index;
+    occupied[slot / 64] |= std::uint64_t{1} << (slot % 64);
+}
+
+void mi::KeyRepeatWheel::unlink(std::size_t index)
+{
+    auto const& entry = entries[index];
+    auto const slot = entry.due_tick % slot_count;
+
+    if (entry.previous != none)
+        entries[entry.previous].next = entry.next;
+    else
+        slots[slot] = entry.next;
+
+    if (entry.next != none)
+        entries[entry.next].previous = entry.previous;
+
+    if (slots[slot] == none)
+        occupied[slot / 64] &= ~(std::uint64_t{1} << (slot % 64));
+}
+
+void mi::KeyRepeatWheel::release(std::size_t index)
+{
+    free_entries.push_back(index);
+    --repeat_count;
+}
+
+void mi::KeyRepeatWheel::add(KeyRepeat const& repeat)
+{
+    std::size_t index;
+    if (free_entries.empty())
+    {
+        index = entries.size();
+        entries.emplace_back();
+    }
+    else
+    {
+        index = free_entries.back();
+        free_entries.pop_back();
+    }
+
+    auto& entry = entries[index];
+    entry.repeat = repeat;
+    entry.due_tick = first_tick_not_before(repeat.due);
+
+    // Only ticks after expired_tick are looked at, so the wheel must not
+    // already have passed the new entry
+    if (repeat_count == 0 || entry.due_tick <= expired_tick)
+        expired_tick = entry.due_tick - 1;
+
+    entries_by_device[repeat.device][repeat.scan_code] = index;
+    ++repeat_count;
+    link(index);
+}
+
+bool mi::KeyRepeatWheel::contains(MirInputDeviceId device, int scan_code) const
+{
+    auto const device_entries = entries_by_device.find(device);
+    return device_entries != entries_by_device.end() && device_entries->second.count(scan_code);
+}
+
+bool mi::KeyRepeatWheel::remove(MirInputDeviceId device, int scan_code)
+{
+    auto const device_entries = entries_by_device.find(device);
+    if (device_entries == entries_by_device.end())
+        return false;
+
+    auto const entry = device_entries->second.find(scan_code);
+    if (entry == device_entries->second.end())
+        return false;
+
+    unlink(entry->second);
+    release(entry->second);
+    device_entries->second.erase(entry);
+    return true;
+}
+
+void mi::KeyRepeatWheel::remove_device(MirInputDeviceId device)
+{
+    auto const device_entries = entries_by_device.find(device);
+    if (device_entries == entries_by_device.end())
+        return;
+
+    for (auto const& entry : device_entries->second)
+    {
+        unlink(entry.second);
+        release(entry.second);
+    }
+    entries_by_device.erase(device_entries);
+}
+
+void mi::KeyRepeatWheel::clear()
+{
+    entries.clear();
+    free_entries.clear();
+    entries_by_device.clear();
+    slots.fill(none);
+    occupied.fill(0);
+    repeat_count = 0;
+}
+
+void mi::KeyRepeatWheel::expire_slot(
+    std::size_t slot, Tick now_tick, time::Timestamp now, std::vector<KeyRepeat>& due)
+{
+    auto index = slots[slot];
+    slots[slot] = none;
+    occupied[slot / 64] &= ~(std::uint64_t{1} << (slot % 64));
+
+    while (index != none)
+    {
+        auto& entry = entries[index];
+        auto const next = entry.next;
+
+        // Entries a whole turn of the wheel or more away share the slot
+        if (entry.due_tick <= now_tick)
+        {
+            due.push_back(entry.repeat);
+
+            // A late wake up skips the repeats it missed rather than sending
+            // them in a burst, and the next one keeps to the original cadence
+            auto const missed = (now - entry.repeat.due) / repeat_delay;
+            entry.repeat.due += repeat_delay * (missed + 1);
+            entry.due_tick = first_tick_not_before(entry.repeat.due);
+        }
+
+        link(index);
+        index = next;
+    }
+}
+
+void mi::KeyRepeatWheel::expire(time::Timestamp now, std::vector<KeyRepeat>& due)
+{
+    auto const now_tick = last_tick_not_after(now);
+    if (now_tick <= expired_tick)
+        return;
+
+    if (now_tick - expired_tick >= static_cast<Tick>(slot_count))
+    {
+        for (std::size_t slot = 0; slot != slot_count; ++slot)
+        {
+            if (slots[slot] != none)
+                expire_slot(slot, now_tick, now, due);
+        }
+    }
+    else
+    {
+        for (auto tick = expired_tick + 1; tick <= now_tick; ++tick)
+        {
+            auto const slot = tick % slot_count;
+            if (slots[slot] != none)
+                expire_slot(slot, now_tick, now, due);
+        }
+    }
+
+    expired_tick = now_tick;
+}
+
+auto mi::KeyRepeatWheel::next_expiry() const -> optional_value<time::Timestamp>
+{
+    if (repeat_count == 0)
+        return {};
+
+    for (auto tick = expired_tick + 1; tick <= expired_tick + static_cast<Tick>(slot_count);)
+    {
+        auto const slot = tick % slot_count;
+        auto const later_slots = occupied[slot / 64] >> (slot % 64);
+
+        if (later_slots & 1)
+            return origin + tick * tick_length;
+        else if (later_slots)
+            tick += __builtin_ctzll(later_slots);
+        else
+            tick += 64 - slot % 64;
+    }
+
+    return {};
+}
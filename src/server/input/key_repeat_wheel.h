@@ -0,0 +1,102 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_INPUT_KEY_REPEAT_WHEEL_H_
+#define MIR_INPUT_KEY_REPEAT_WHEEL_H_
+
+#include "mir/time/types.h"
+#include "mir/optional_value.h"
+#include "mir_toolkit/event.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace mir
+{
+namespace input
+{
+struct KeyRepeat
+{
+    MirInputDeviceId device;
+    int scan_code;
+    xkb_keysym_t key_code;
+    MirInputEventModifiers modifiers;
+    time::Timestamp due;
+};
+
+/**
+ * The held keys of all devices, filed by when they next repeat.
+ *
+ * A hashed timing wheel of one millisecond ticks: adding, removing and
+ * expiring a repeat are constant time, and the next wake up is found from
+ * an occupancy mask rather than by walking the keys. Repeats keep to the
+ * cadence they started with however late expire() is called.
+ */
+class KeyRepeatWheel
+{
+public:
+    KeyRepeatWheel(time::Timestamp origin, std::chrono::milliseconds repeat_delay);
+
+    /// Starts repeating a key that is not already repeating
+    void add(KeyRepeat const& repeat);
+    bool contains(MirInputDeviceId device, int scan_code) const;
+    bool remove(MirInputDeviceId device, int scan_code);
+    void remove_device(MirInputDeviceId device);
+    void clear();
+
+    /// Appends the repeats due by now to due and schedules their next repeat
+    void expire(time::Timestamp now, std::vector<KeyRepeat>& due);
+    /// When expire() next has something to do, if anything is repeating
+    optional_value<time::Timestamp> next_expiry() const;
+
+private:
+    using Tick = std::int64_t;
+    static std::size_t const slot_count{512};
+    static std::size_t const none = static_cast<std::size_t>(-1);
+
+    struct Entry
+    {
+        KeyRepeat repeat;
+        Tick due_tick;
+        std::size_t previous;
+        std::size_t next;
+    };
+
+    Tick first_tick_not_before(time::Timestamp t) const;
+    Tick last_tick_not_after(time::Timestamp t) const;
+    void link(std::size_t index);
+    void unlink(std::size_t index);
+    void release(std::size_t index);
+    void expire_slot(std::size_t slot, Tick now_tick, time::Timestamp now, std::vector<KeyRepeat>& due);
+
+    time::Timestamp const origin;
+    std::chrono::milliseconds const repeat_delay;
+
+    std::vector<Entry> entries;
+    std::vector<std::size_t> free_entries;
+    std::array<std::size_t, slot_count> slots;
+    std::array<std::uint64_t, slot_count / 64> occupied;
+    std::unordered_map<MirInputDeviceId, std::unordered_map<int, std::size_t>> entries_by_device;
+    std::size_t repeat_count{0};
+    Tick expired_tick{0};
+};
+}
+}
+
+#endif // MIR_INPUT_KEY_REPEAT_WHEEL_H_
@@ -47,15 +47,20 @@ struct InputDispatcherSceneObserver :
     InputDispatcherSceneObserver(
         std::function<void(ms::Surface*)> const& on_removed,
         std::function<void(ms::Surface const*)> const& on_surface_moved,
-        std::function<void()> const& on_surface_resized)
+        std::function<void()> const& on_surface_resized,
+        std::function<void()> const& on_restacked,
+        std::function<void(ms::Surface const*)> const& on_bounds_changed)
         : on_removed(on_removed),
           on_surface_moved{on_surface_moved},
-          on_surface_resized{on_surface_resized}
+          on_surface_resized{on_surface_resized},
+          on_restacked{on_restacked},
+          on_bounds_changed{on_bounds_changed}
     {
     }
     void surface_added(ms::Surface* surface) override
     {
         surface->add_observer(shared_from_this());
+        on_restacked();
     }
     void surface_removed(ms::Surface* surface) override
     {
@@ -63,6 +68,7 @@ struct InputDispatcherSceneObserver :
     }
     void surfaces_reordered() override
     {
+        on_restacked();
     }
     void scene_changed() override
     {
@@ -81,13 +87,15 @@ struct InputDispatcherSceneObserver :
         // TODO: Do we need to listen to visibility events?
     }
 
-    void resized_to(ms::Surface const*, mir::geometry::Size const& /*size*/) override
+    void resized_to(ms::Surface const* surf, mir::geometry::Size const& /*size*/) override
     {
+        on_bounds_changed(surf);
         on_surface_resized();
     }
 
     void moved_to(ms::Surface const* surf, mir::geometry::Point const& /*top_left*/) override
     {
+        on_bounds_changed(surf);
         on_surface_moved(surf);
     }
 
@@ -158,9 +166,16 @@ struct InputDispatcherSceneObserver :
     {
     }
 
+    void input_region_set_to(ms::Surface const* surf, std::vector<mir::geometry::Rectangle> const&) override
+    {
+        on_bounds_changed(surf);
+    }
+
     std::function<void(ms::Surface*)> const on_removed;
     std::function<void(ms::Surface const*)> const on_surface_moved;
     std::function<void()> const on_surface_resized;
+    std::function<void()> const on_restacked;
+    std::function<void(ms::Surface const*)> const on_bounds_changed;
 };
 
 void deliver_without_relative_motion(
@@ -228,8 +243,11 @@ mi::SurfaceInputDispatcher::SurfaceInputDispatcher(std::shared_ptr<mi::Scene> co
             std::placeholders::_1),
         std::bind(
             std::mem_fn(&SurfaceInputDispatcher::surface_resized),
-            this));
+            this),
+        [this]{ surfaces_restacked(); },
+        [this](ms::Surface const* s){ surface_index.update(s); });
     scene->add_observer(scene_observer);
+    surfaces_restacked();
 }
 
 mi::SurfaceInputDispatcher::~SurfaceInputDispatcher()
@@ -258,6 +276,8 @@ bool compare_surfaces(std::shared_ptr<mi::Surface> const& input_surface, ms::Sur
 
 void mi::SurfaceInputDispatcher::surface_removed(ms::Surface *surface)
 {
+    surface_index.remove(surface);
+
     std::lock_guard<std::mutex> lg(dispatcher_mutex);
 
     auto strong_focus = focus_surface.lock();
@@ -516,12 +536,17 @@ bool is_gesture_terminator(MirPointerEvent const* pev)
 
 std::shared_ptr<mi::Surface> mi::SurfaceInputDispatcher::find_target_surface(geom::Point const& point)
 {
-    std::shared_ptr<mi::Surface> top_target = nullptr;
-    scene->for_each([&top_target, &point](std::shared_ptr<mi::Surface> const& target) {
-            if (target->input_area_contains(point))
-                top_target = target;
-    });
-    return top_target;
+    return surface_index.surface_at(point);
+}
+
+void mi::SurfaceInputDispatcher::surfaces_restacked()
+{
+    std::vector<std::shared_ptr<mi::Surface>> surfaces;
+    scene->for_each([&surfaces](std::shared_ptr<mi::Surface> const& surface)
+        {
+            surfaces.push_back(surface);
+        });
+    surface_index.restack(surfaces);
 }
 
 void mi::SurfaceInputDispatcher::send_enter_exit_event(std::shared_ptr<mi::Surface> const& surface,
@@ -19,6 +19,7 @@
 #ifndef MIR_INPUT_DEFAULT_INPUT_DISPATCHER_H_
 #define MIR_INPUT_DEFAULT_INPUT_DISPATCHER_H_
 
+#include "surface_spatial_index.h"
 #include "mir/input/input_dispatcher.h"
 #include "mir/shell/input_targeter.h"
 #include "mir/geometry/point.h"
@@ -68,6 +69,8 @@ private:
         MirPointerEvent const* triggering_ev, MirPointerAction action);
 
     std::shared_ptr<input::Surface> find_target_surface(geometry::Point const& target);
+    /// Refreshes the stacking order in surface_index from the scene
+    void surfaces_restacked();
 
     void set_focus_locked(std::lock_guard<std::mutex> const&, std::shared_ptr<input::Surface> const&);
 
@@ -94,6 +97,8 @@ private:
     
     std::shared_ptr<input::Scene> const scene;
 
+    SurfaceSpatialIndex surface_index;
+
     std::shared_ptr<scene::Observer> scene_observer;
 
     std::mutex dispatcher_mutex;
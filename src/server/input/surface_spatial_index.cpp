@@ -0,0 +1,209 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "surface_spatial_index.h"
+#include "mir/input/surface.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace mi = mir::input;
+namespace geom = mir::geometry;
+
+namespace
+{
+/// Cells are 256x256 pixels
+int const cell_shift = 8;
+
+/// A surface covering more cells than this (about a 4K screen) isn't bucketed
+int const max_cells_per_surface = 150;
+
+int cell_coordinate(int pixel)
+{
+    // Arithmetic shift rounds towards negative infinity, as we want
+    return pixel >> cell_shift;
+}
+
+std::uint64_t cell_at(int x, int y)
+{
+    return (std::uint64_t{static_cast<std::uint32_t>(x)} << 32) | static_cast<std::uint32_t>(y);
+}
+}
+
+template<typename F>
+bool mi::SurfaceSpatialIndex::for_each_cell(geom::Rectangle const& bounds, F f)
+{
+    if (bounds.size.width.as_int() <= 0 || bounds.size.height.as_int() <= 0)
+        return true;
+
+    auto const left = cell_coordinate(bounds.left().as_int());
+    auto const right = cell_coordinate(bounds.right().as_int() - 1);
+    auto const top = cell_coordinate(bounds.top().as_int());
+    auto const bottom = cell_coordinate(bounds.bottom().as_int() - 1);
+
+    if ((right - left + 1) * (bottom - top + 1) > max_cells_per_surface)
+        return false;
+
+    for (auto y = top; y <= bottom; ++y)
+        for (auto x = left; x <= right; ++x)
+            f(cell_at(x, y));
+
+    return true;
+}
+
+void mi::SurfaceSpatialIndex::restack(std::vector<std::shared_ptr<Surface>> const& surfaces)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    std::unordered_set<Surface const*> present;
+    for (auto const& surface : surfaces)
+        present.insert(surface.get());
+
+    for (auto i = entries.begin(); i != entries.end();)
+    {
+        if (!present.count(i->first))
+        {
+            erase_locked(i->first, i->second);
+            i = entries.erase(i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    unsigned depth = 0;
+    for (auto const& surface : surfaces)
+    {
+        auto const existing = entries.find(surface.get());
+        if (existing != entries.end())
+        {
+            existing->second.depth = depth++;
+        }
+        else
+        {
+            Entry const entry{surface, surface->input_area_bounds(), depth++};
+            entries.emplace(surface.get(), entry);
+            insert_locked(surface.get(), entry);
+        }
+    }
+}
+
+void mi::SurfaceSpatialIndex::update(Surface const* key)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    auto const existing = entries.find(key);
+    if (existing == entries.end())
+        return;
+
+    auto& entry = existing->second;
+    auto const surface = entry.surface.lock();
+    if (!surface)
+    {
+        erase_locked(key, entry);
+        entries.erase(existing);
+        return;
+    }
+
+    auto const bounds = surface->input_area_bounds();
+    if (bounds != entry.bounds)
+    {
+        erase_locked(key, entry);
+        entry.bounds = bounds;
+        insert_locked(key, entry);
+    }
+}
+
+void mi::SurfaceSpatialIndex::remove(Surface const* key)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    auto const existing = entries.find(key);
+    if (existing != entries.end())
+    {
+        erase_locked(key, existing->second);
+        entries.erase(existing);
+    }
+}
+
+auto mi::SurfaceSpatialIndex::surface_at(geom::Point point) const -> std::shared_ptr<Surface>
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    static std::vector<Surface const*> const no_surfaces;
+    auto const cell = cells.find(cell_at(cell_coordinate(point.x.as_int()), cell_coordinate(point.y.as_int())));
+    auto const& bucketed = cell != cells.end() ? cell->second : no_surfaces;
+
+    // Try the candidates from the top down until one accepts the point
+    auto below = entries.size();
+    for (;;)
+    {
+        Entry const* best = nullptr;
+        auto const consider = [&](Surface const* key)
+            {
+                auto const& entry = entries.at(key);
+                if (entry.depth < below && (!best || entry.depth > best->depth) && entry.bounds.contains(point))
+                    best = &entry;
+            };
+
+        for (auto const key : bucketed)
+            consider(key);
+        for (auto const key : oversized)
+            consider(key);
+
+        if (!best)
+            return {};
+
+        if (auto const surface = best->surface.lock())
+        {
+            if (surface->input_area_contains(point))
+                return surface;
+        }
+
+        below = best->depth;
+    }
+}
+
+void mi::SurfaceSpatialIndex::insert_locked(Surface const* key, Entry const& entry)
+{
+    bool const bucketed = for_each_cell(entry.bounds, [&](Cell cell) { cells[cell].push_back(key); });
+
+    if (!bucketed)
+        oversized.push_back(key);
+}
+
+void mi::SurfaceSpatialIndex::erase_locked(Surface const* key, Entry const& entry)
+{
+    auto const erase_from = [key](std::vector<Surface const*>& keys)
+        {
+            keys.erase(std::remove(keys.begin(), keys.end(), key), keys.end());
+        };
+
+    bool const bucketed = for_each_cell(entry.bounds, [&](Cell cell)
+        {
+            auto const i = cells.find(cell);
+            if (i != cells.end())
+            {
+                erase_from(i->second);
+                if (i->second.empty())
+                    cells.erase(i);
+            }
+        });
+
+    if (!bucketed)
+        erase_from(oversized);
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_INPUT_SURFACE_SPATIAL_INDEX_H_
+#define MIR_INPUT_SURFACE_SPATIAL_INDEX_H_
+
+#include "mir/geometry/point.h"
+#include "mir/geometry/rectangle.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace mir
+{
+namespace input
+{
+class Surface;
+
+/**
+ * Finds the topmost surface accepting input at a point without asking
+ * every surface in the scene.
+ *
+ * Surfaces are bucketed by their input_area_bounds() into a coarse grid,
+ * so a lookup only considers those overlapping the point's cell.
+ */
+class SurfaceSpatialIndex
+{
+public:
+    SurfaceSpatialIndex() = default;
+
+    /// Sets the surfaces and their stacking order (bottom first)
+    void restack(std::vector<std::shared_ptr<Surface>> const& surfaces);
+
+    /// Refreshes the position of a surface whose bounds have changed
+    void update(Surface const* surface);
+
+    void remove(Surface const* surface);
+
+    /// The topmost surface whose input area contains the point, if any
+    auto surface_at(geometry::Point point) const -> std::shared_ptr<Surface>;
+
+private:
+    SurfaceSpatialIndex(SurfaceSpatialIndex const&) = delete;
+    SurfaceSpatialIndex& operator=(SurfaceSpatialIndex const&) = delete;
+
+    using Cell = std::uint64_t;
+
+    struct Entry
+    {
+        std::weak_ptr<Surface> surface;
+        geometry::Rectangle bounds;
+        unsigned depth;
+    };
+
+    void insert_locked(Surface const* key, Entry const& entry);
+    void erase_locked(Surface const* key, Entry const& entry);
+
+    /// Calls f(cell) for each cell the rectangle overlaps, returning false if it overlaps too many
+    template<typename F>
+    static bool for_each_cell(geometry::Rectangle const& bounds, F f);
+
+    std::mutex mutable mutex;
+    std::unordered_map<Surface const*, Entry> entries;
+    std::unordered_map<Cell, std::vector<Surface const*>> cells;
+    /// Surfaces spanning too many cells to be worth bucketing
+    std::vector<Surface const*> oversized;
+};
+
+}
+}
+
+#endif // MIR_INPUT_SURFACE_SPATIAL_INDEX_H_
@@ -23,8 +23,12 @@
 #include "lttng_report_factory.h"
 #include "logging_report_factory.h"
 #include "null_report_factory.h"
+#include "histogram/compositor_report.h"
 
 #include "mir/abnormal_exit.h"
+#include "mir/main_loop.h"
+
+#include <csignal>
 
 namespace mg = mir::graphics;
 namespace mf = mir::frontend;
@@ -66,6 +70,23 @@ auto mir::DefaultServerConfiguration::the_compositor_report() -> std::shared_ptr
     return compositor_report(
         [this]()->std::shared_ptr<mc::CompositorReport>
         {
+            if (the_options()->get<std::string>(options::compositor_report_opt) == options::histogram_opt_value)
+            {
+                auto const report = std::make_shared<report::histogram::CompositorReport>(the_logger(), the_clock());
+
+                // SIGUSR1 is taken for VT switching
+                std::weak_ptr<report::histogram::CompositorReport> const weak_report{report};
+                the_main_loop()->register_signal_handler(
+                    {SIGUSR2},
+                    [weak_report](int)
+                    {
+                        if (auto const report = weak_report.lock())
+                            report->dump();
+                    });
+
+                return report;
+            }
+
             return report_factory(options::compositor_report_opt)->create_compositor_report();
         });
 }
@@ -0,0 +1,195 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "compositor_report.h"
+#include "mir/logging/logger.h"
+
+#include <cstdio>
+
+namespace ml = mir::logging;
+namespace mrh = mir::report::histogram;
+
+namespace
+{
+char const* const component = "compositor";
+
+std::chrono::microseconds since(mir::time::Timestamp from, mir::time::Timestamp to)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(to - from);
+}
+
+void log_histogram(ml::Logger& logger, void const* id, char const* name, mrh::Histogram const& histogram)
+{
+    if (!histogram.count())
+        return;
+
+    auto const p50 = histogram.percentile(0.5).count();
+    auto const p99 = histogram.percentile(0.99).count();
+    auto const p999 = histogram.percentile(0.999).count();
+
+    char msg[160];
+    snprintf(msg, sizeof msg, "Display %p %s: p50 %lld.%03lld ms, p99 %lld.%03lld ms, p99.9 %lld.%03lld ms",
+             id, name,
+             static_cast<long long>(p50 / 1000), static_cast<long long>(p50 % 1000),
+             static_cast<long long>(p99 / 1000), static_cast<long long>(p99 % 1000),
+             static_cast<long long>(p999 / 1000), static_cast<long long>(p999 % 1000));
+    logger.log(ml::Severity::informational, msg, component);
+}
+}
+
+mrh::CompositorReport::CompositorReport(
+    std::shared_ptr<ml::Logger> const& logger,
+    std::shared_ptr<time::Clock> const& clock)
+    : logger(logger),
+      clock(clock),
+      last_scheduled{time::Timestamp{}}
+{
+}
+
+auto mrh::CompositorReport::display_for(SubCompositorId id) -> Display*
+{
+    for (auto& display : displays)
+    {
+        if (display.id.load(std::memory_order_acquire) == id)
+            return &display;
+    }
+
+    for (auto& display : displays)
+    {
+        SubCompositorId expected{nullptr};
+        if (display.id.compare_exchange_strong(expected, id, std::memory_order_acq_rel) || expected == id)
+            return &display;
+    }
+
+    return nullptr;
+}
+
+void mrh::CompositorReport::added_display(int, int, int, int, SubCompositorId id)
+{
+    display_for(id);
+}
+
+void mrh::CompositorReport::began_frame(SubCompositorId id)
+{
+    if (auto const display = display_for(id))
+    {
+        auto const t = clock->now();
+
+        // Only the first frame after scheduling is waiting on the schedule
+        auto const scheduled = last_scheduled.load(std::memory_order_relaxed);
+        if (scheduled != time::Timestamp{} && scheduled > display->start_of_frame)
+            display->latency.record(since(scheduled, t));
+
+        display->start_of_frame = t;
+        display->bypassed = true;
+    }
+}
+
+void mrh::CompositorReport::renderables_in_frame(SubCompositorId, graphics::RenderableList const&)
+{
+}
+
+void mrh::CompositorReport::rendered_frame(SubCompositorId id)
+{
+    if (auto const display = display_for(id))
+    {
+        display->render.record(since(display->start_of_frame, clock->now()));
+        display->bypassed = false;
+    }
+}
+
+void mrh::CompositorReport::finished_frame(SubCompositorId id)
+{
+    if (auto const display = display_for(id))
+    {
+        display->end_of_frame = clock->now();
+        display->frames.fetch_add(1, std::memory_order_relaxed);
+        if (display->bypassed)
+            display->bypassed_frames.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void mrh::CompositorReport::posted_frame(SubCompositorId id)
+{
+    if (auto const display = display_for(id))
+        display->post.record(since(display->end_of_frame, clock->now()));
+}
+
+void mrh::CompositorReport::missed_deadline(SubCompositorId id, std::chrono::nanoseconds)
+{
+    if (auto const display = display_for(id))
+        display->missed.fetch_add(1, std::memory_order_relaxed);
+}
+
+void mrh::CompositorReport::started()
+{
+}
+
+void mrh::CompositorReport::stopped()
+{
+    // The compositing threads are gone, and their displays with them
+    dump();
+
+    for (auto& display : displays)
+        display.reset();
+}
+
+void mrh::CompositorReport::scheduled()
+{
+    last_scheduled.store(clock->now(), std::memory_order_relaxed);
+}
+
+void mrh::CompositorReport::dump()
+{
+    for (auto& display : displays)
+    {
+        if (auto const id = display.id.load(std::memory_order_acquire))
+            display.log(*logger, id);
+    }
+}
+
+void mrh::CompositorReport::Display::reset()
+{
+    latency.reset();
+    render.reset();
+    post.reset();
+    frames.store(0, std::memory_order_relaxed);
+    bypassed_frames.store(0, std::memory_order_relaxed);
+    missed.store(0, std::memory_order_relaxed);
+    start_of_frame = {};
+    end_of_frame = {};
+    bypassed = true;
+    id.store(nullptr, std::memory_order_release);
+}
+
+void mrh::CompositorReport::Display::log(ml::Logger& logger, SubCompositorId id)
+{
+    auto const nframes = frames.load(std::memory_order_relaxed);
+    if (!nframes)
+        return;
+
+    char msg[160];
+    snprintf(msg, sizeof msg, "Display %p composited %llu frames, %llu%% bypassed, %llu missed vblanks",
+             id,
+             static_cast<unsigned long long>(nframes),
+             static_cast<unsigned long long>(bypassed_frames.load(std::memory_order_relaxed) * 100 / nframes),
+             static_cast<unsigned long long>(missed.load(std::memory_order_relaxed)));
+    logger.log(ml::Severity::informational, msg, component);
+
+    log_histogram(logger, id, "schedule-to-start latency", latency);
+    log_histogram(logger, id, "render time", render);
+    log_histogram(logger, id, "post time", post);
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_REPORT_HISTOGRAM_COMPOSITOR_REPORT_H_
+#define MIR_REPORT_HISTOGRAM_COMPOSITOR_REPORT_H_
+
+#include "histogram.h"
+
+#include "mir/compositor/compositor_report.h"
+#include "mir/time/clock.h"
+
+#include <array>
+#include <atomic>
+#include <memory>
+
+namespace mir
+{
+namespace logging
+{
+class Logger;
+}
+namespace report
+{
+namespace histogram
+{
+/**
+ * Collects the distribution of frame timings for each display, for dump()ing
+ * on demand.
+ *
+ * Unlike the logging report this takes no locks on the compositing threads:
+ * each display gets a fixed slot, and the only shared state is atomic.
+ */
+class CompositorReport : public mir::compositor::CompositorReport
+{
+public:
+    CompositorReport(std::shared_ptr<mir::logging::Logger> const& logger,
+                     std::shared_ptr<time::Clock> const& clock);
+
+    void added_display(int width, int height, int x, int y, SubCompositorId id) override;
+    void began_frame(SubCompositorId id) override;
+    void renderables_in_frame(SubCompositorId id, graphics::RenderableList const& renderables) override;
+    void rendered_frame(SubCompositorId id) override;
+    void finished_frame(SubCompositorId id) override;
+    void posted_frame(SubCompositorId id) override;
+    void missed_deadline(SubCompositorId id, std::chrono::nanoseconds lateness) override;
+    void started() override;
+    void stopped() override;
+    void scheduled() override;
+
+    /// Logs the percentiles of each display's timings since it started
+    void dump();
+
+private:
+    std::shared_ptr<mir::logging::Logger> const logger;
+    std::shared_ptr<time::Clock> const clock;
+
+    struct Display
+    {
+        std::atomic<SubCompositorId> id{nullptr};
+
+        // Only touched by the display's compositing thread
+        time::Timestamp start_of_frame;
+        time::Timestamp end_of_frame;
+        bool bypassed{true};
+
+        Histogram latency;  // From scheduling a frame to starting to composite it
+        Histogram render;
+        Histogram post;
+        std::atomic<uint64_t> frames{0};
+        std::atomic<uint64_t> bypassed_frames{0};
+        std::atomic<uint64_t> missed{0};
+
+        void reset();
+        void log(mir::logging::Logger& logger, SubCompositorId id);
+    };
+
+    /// The display's slot, claiming a free one if needed. Null if all are taken.
+    Display* display_for(SubCompositorId id);
+
+    static std::size_t const max_displays{16};
+    std::array<Display, max_displays> displays;
+    std::atomic<time::Timestamp> last_scheduled;
+};
+}
+}
+}
+
+#endif // MIR_REPORT_HISTOGRAM_COMPOSITOR_REPORT_H_
@@ -0,0 +1,98 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mrh = mir::report::histogram;
+
+mrh::Histogram::Histogram()
+{
+    reset();
+}
+
+int mrh::Histogram::bucket_for(uint64_t value)
+{
+    if (value < sub_buckets)
+        return value;
+
+    int const magnitude = 63 - __builtin_clzll(value);
+    if (magnitude >= max_magnitude)
+        return bucket_count - 1;
+
+    // The top sub_bucket_bits bits of the value, below its most significant one,
+    // pick the sub-bucket within its power of two
+    int const shift = magnitude - sub_bucket_bits;
+    return (shift + 1) * sub_buckets + static_cast<int>((value >> shift) - sub_buckets);
+}
+
+uint64_t mrh::Histogram::upper_bound_of(int bucket)
+{
+    if (bucket < sub_buckets)
+        return bucket;
+
+    int const shift = bucket / sub_buckets - 1;
+    uint64_t const lower = uint64_t(sub_buckets + bucket % sub_buckets) << shift;
+    return lower + (uint64_t(1) << shift) - 1;
+}
+
+void mrh::Histogram::record(std::chrono::microseconds value)
+{
+    auto const bucket = bucket_for(std::max<std::chrono::microseconds::rep>(value.count(), 0));
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t mrh::Histogram::count() const
+{
+    return total.load(std::memory_order_relaxed);
+}
+
+std::chrono::microseconds mrh::Histogram::percentile(double fraction) const
+{
+    // Buckets may be recorded into while we walk them; counting them as we go,
+    // rather than trusting total, keeps the walk consistent with itself
+    std::array<uint64_t, bucket_count> counts;
+    uint64_t recorded{0};
+    for (int i = 0; i != bucket_count; ++i)
+    {
+        counts[i] = buckets[i].load(std::memory_order_relaxed);
+        recorded += counts[i];
+    }
+
+    if (!recorded)
+        return std::chrono::microseconds::zero();
+
+    auto const rank = std::max<uint64_t>(1, std::ceil(fraction * recorded));
+    uint64_t seen{0};
+    for (int i = 0; i != bucket_count; ++i)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+            return std::chrono::microseconds(upper_bound_of(i));
+    }
+
+    return std::chrono::microseconds(upper_bound_of(bucket_count - 1));
+}
+
+void mrh::Histogram::reset()
+{
+    for (auto& bucket : buckets)
+        bucket.store(0, std::memory_order_relaxed);
+    total.store(0, std::memory_order_relaxed);
+}
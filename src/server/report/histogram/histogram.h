@@ -0,0 +1,71 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_REPORT_HISTOGRAM_HISTOGRAM_H_
+#define MIR_REPORT_HISTOGRAM_HISTOGRAM_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace mir
+{
+namespace report
+{
+namespace histogram
+{
+/**
+ * A histogram of durations that can be recorded into from any thread without
+ * locking.
+ *
+ * Buckets are log-linear (as HdrHistogram's are): each power of two is split
+ * into 16 linear sub-buckets, so any value is placed to within 1/16 of itself.
+ * Values up to 16µs are exact and anything over ~71 minutes lands in the last
+ * bucket.
+ */
+class Histogram
+{
+public:
+    Histogram();
+
+    void record(std::chrono::microseconds value);
+
+    uint64_t count() const;
+
+    /// The smallest bucket bound that at least 'fraction' of the values recorded fall within
+    std::chrono::microseconds percentile(double fraction) const;
+
+    /// Not atomic with respect to concurrent record()s
+    void reset();
+
+private:
+    static int const sub_bucket_bits = 4;
+    static int const sub_buckets = 1 << sub_bucket_bits;
+    static int const max_magnitude = 32;
+    static int const bucket_count = (max_magnitude - sub_bucket_bits + 1) * sub_buckets;
+
+    static int bucket_for(uint64_t value);
+    static uint64_t upper_bound_of(int bucket);
+
+    std::array<std::atomic<uint64_t>, bucket_count> buckets;
+    std::atomic<uint64_t> total;
+};
+}
+}
+}
+
+#endif // MIR_REPORT_HISTOGRAM_HISTOGRAM_H_
@@ -47,6 +47,8 @@ public:
     void renderables_in_frame(SubCompositorId id, graphics::RenderableList const& renderables) override;
     void rendered_frame(SubCompositorId id) override;
     void finished_frame(SubCompositorId id) override;
+    void posted_frame(SubCompositorId id) override;
+    void missed_deadline(SubCompositorId id, std::chrono::nanoseconds lateness) override;
     void started() override;
     void stopped() override;
     void scheduled() override;
@@ -67,6 +69,7 @@ private:
         TimePoint latency_sum;
         long nframes = 0;
         long nbypassed = 0;
+        long nmissed = 0;
         bool bypassed = true;
         bool prev_bypassed = false;
 
@@ -75,6 +78,7 @@ private:
         TimePoint last_reported_latency_sum;
         long last_reported_nframes = 0;
         long last_reported_bypassed = 0;
+        long last_reported_missed = 0;
 
         void log(mir::logging::Logger& logger, SubCompositorId id);
     };
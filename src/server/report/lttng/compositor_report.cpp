@@ -62,3 +62,13 @@ void mir::report::lttng::CompositorReport::finished_frame(SubCompositorId id)
 {
     mir_tracepoint(mir_server_compositor, finished_frame, id);
 }
+
+void mir::report::lttng::CompositorReport::posted_frame(SubCompositorId id)
+{
+    mir_tracepoint(mir_server_compositor, posted_frame, id);
+}
+
+void mir::report::lttng::CompositorReport::missed_deadline(SubCompositorId id, std::chrono::nanoseconds lateness)
+{
+    mir_tracepoint(mir_server_compositor, missed_deadline, id, lateness.count());
+}
@@ -40,6 +40,8 @@ public:
     void renderables_in_frame(SubCompositorId id, graphics::RenderableList const& renderables) override;
     void rendered_frame(SubCompositorId id) override;
     void finished_frame(SubCompositorId id) override;
+    void posted_frame(SubCompositorId id) override;
+    void missed_deadline(SubCompositorId id, std::chrono::nanoseconds lateness) override;
     void started() override;
     void stopped() override;
     void scheduled() override;
@@ -80,6 +80,23 @@ TRACEPOINT_EVENT_INSTANCE(
     TP_ARGS(void const*, id)
 )
 
+TRACEPOINT_EVENT_INSTANCE(
+    mir_server_compositor,
+    subcompositor_event,
+    posted_frame,
+    TP_ARGS(void const*, id)
+)
+
+TRACEPOINT_EVENT(
+    mir_server_compositor,
+    missed_deadline,
+    TP_ARGS(void const*, id, int64_t, lateness_ns),
+    TP_FIELDS(
+        ctf_integer_hex(uintptr_t, id, (uintptr_t)(id))
+        ctf_integer(int64_t, lateness_ns, lateness_ns)
+    )
+)
+
 TRACEPOINT_EVENT(
     mir_server_compositor,
     buffers_in_frame,
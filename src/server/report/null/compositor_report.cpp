@@ -40,6 +40,14 @@ void mrn::CompositorReport::finished_frame(SubCompositorId)
 {
 }
 
+void mrn::CompositorReport::posted_frame(SubCompositorId)
+{
+}
+
+void mrn::CompositorReport::missed_deadline(SubCompositorId, std::chrono::nanoseconds)
+{
+}
+
 void mrn::CompositorReport::started()
 {
 }
@@ -19,6 +19,7 @@
  */
 
 #include "basic_surface.h"
+#include "recycling_allocator.h"
 #include "mir/compositor/buffer_stream.h"
 #include "mir/frontend/event_sink.h"
 #include "mir/shell/input_targeter.h"
@@ -26,6 +27,7 @@
 #include "mir/graphics/cursor_image.h"
 #include "mir/graphics/pixel_format_utils.h"
 #include "mir/geometry/displacement.h"
+#include "mir/geometry/rectangles.h"
 #include "mir/renderer/sw/pixel_source.h"
 
 #include "mir/scene/scene_report.h"
@@ -153,6 +155,12 @@ void ms::SurfaceObservers::start_drag_and_drop(Surface const* surf, std::vector<
                  { observer->start_drag_and_drop(surf, handle); });
 }
 
+void ms::SurfaceObservers::input_region_set_to(Surface const* surf, std::vector<geom::Rectangle> const& region)
+{
+    for_each([&](std::shared_ptr<SurfaceObserver> const& observer)
+        { observer->input_region_set_to(surf, region); });
+}
+
 
 struct ms::CursorStreamImageAdapter
 {
@@ -252,7 +260,9 @@ ms::BasicSurface::BasicSurface(
     parent_(parent),
     layers(layers),
     confine_pointer_state_(state),
-    cursor_stream_adapter{std::make_unique<ms::CursorStreamImageAdapter>(*this)}
+    cursor_stream_adapter{std::make_unique<ms::CursorStreamImageAdapter>(*this)},
+    snapshot_pool{std::make_shared<BlockPool>()},
+    opaque_region_pool{std::make_shared<BlockPool>()}
 {
     auto callback = [this](auto const& size) { observers.frame_posted(this, 1, size); };
 
@@ -322,8 +332,11 @@ std::shared_ptr<mf::BufferStream> ms::BasicSurface::primary_buffer_stream() cons
 
 void ms::BasicSurface::set_input_region(std::vector<geom::Rectangle> const& input_rectangles)
 {
-    std::unique_lock<std::mutex> lock(guard);
-    custom_input_rectangles = input_rectangles;
+    {
+        std::unique_lock<std::mutex> lock(guard);
+        custom_input_rectangles = input_rectangles;
+    }
+    observers.input_region_set_to(this, input_rectangles);
 }
 
 void ms::BasicSurface::resize(geom::Size const& desired_size)
@@ -355,6 +368,23 @@ geom::Rectangle ms::BasicSurface::input_bounds() const
     return surface_rect;
 }
 
+geom::Rectangle ms::BasicSurface::input_area_bounds() const
+{
+    std::unique_lock<std::mutex> lk(guard);
+
+    if (custom_input_rectangles.empty())
+        return surface_rect;
+
+    // A custom input region isn't confined to the surface (e.g. for subsurfaces or CSD)
+    geom::Rectangles input_area;
+    for (auto const& rectangle : custom_input_rectangles)
+    {
+        if (rectangle.size.width > geom::Width{0} && rectangle.size.height > geom::Height{0})
+            input_area.add({surface_rect.top_left + (rectangle.top_left - geom::Point{}), rectangle.size});
+    }
+    return input_area.bounding_rectangle();
+}
+
 // TODO: Does not account for transformation().
 bool ms::BasicSurface::input_area_contains(geom::Point const& point) const
 {
@@ -783,12 +813,15 @@ public:
         geom::Rectangle const& position,
         glm::mat4 const& transform,
         float alpha,
+        std::vector<geom::Rectangle> const& opaque_region,
+        std::shared_ptr<ms::BlockPool> const& opaque_region_pool,
         mg::Renderable::ID id)
     : underlying_buffer_stream{stream},
       compositor_id{compositor_id},
       alpha_{alpha},
       screen_position_(position),
       transformation_(transform),
+      opaque_region_(opaque_region.begin(), opaque_region.end(), OpaqueRegion::allocator_type{opaque_region_pool}),
       id_(id)
     {
     }
@@ -821,6 +854,17 @@ public:
     bool shaped() const override
     { return mg::contains_alpha(underlying_buffer_stream->pixel_format()); }
 
+    geom::Region opaque_region() const override
+    {
+        geom::Region region;
+        for (auto rect : opaque_region_)
+        {
+            rect.top_left = rect.top_left + (screen_position_.top_left - geom::Point{});
+            region.unite(rect);
+        }
+        return region.intersect(screen_position_);
+    }
+
     mg::Renderable::ID id() const override
     { return id_; }
 private:
@@ -830,6 +874,8 @@ private:
     float const alpha_;
     geom::Rectangle const screen_position_;
     glm::mat4 const transformation_;
+    using OpaqueRegion = std::vector<geom::Rectangle, ms::RecyclingAllocator<geom::Rectangle>>;
+    OpaqueRegion const opaque_region_;
     mg::Renderable::ID const id_;
 };
 }
@@ -884,8 +930,14 @@ void ms::BasicSurface::set_streams(std::list<scene::StreamInfo> const& s)
 
 mg::RenderableList ms::BasicSurface::generate_renderables(mc::CompositorID id) const
 {
-    std::unique_lock<std::mutex> lk(guard);
     mg::RenderableList list;
+    append_renderables(id, list);
+    return list;
+}
+
+void ms::BasicSurface::append_renderables(mc::CompositorID id, mg::RenderableList& list) const
+{
+    std::unique_lock<std::mutex> lk(guard);
     for (auto const& info : layers)
     {
         if (info.stream->has_submitted_buffer())
@@ -896,13 +948,13 @@ mg::RenderableList ms::BasicSurface::generate_renderables(mc::CompositorID id) c
             else
                 size = info.stream->stream_size();
 
-            list.emplace_back(std::make_shared<SurfaceSnapshot>(
+            list.emplace_back(std::allocate_shared<SurfaceSnapshot>(
+                RecyclingAllocator<SurfaceSnapshot>{snapshot_pool},
                 info.stream, id,
                 geom::Rectangle{surface_rect.top_left + info.displacement, std::move(size)},
-                transformation_matrix, surface_alpha, info.stream.get()));
+                transformation_matrix, surface_alpha, info.opaque_region, opaque_region_pool, info.stream.get()));
         }
     }
-    return list;
 }
 
 void ms::BasicSurface::set_confine_pointer_state(MirPointerConfinementState state)
@@ -54,6 +54,7 @@ namespace scene
 {
 class SceneReport;
 class CursorStreamImageAdapter;
+class BlockPool;
 
 class BasicSurface : public Surface
 {
@@ -97,6 +98,7 @@ public:
     geometry::Point top_left() const override;
     geometry::Rectangle input_bounds() const override;
     bool input_area_contains(geometry::Point const& point) const override;
+    geometry::Rectangle input_area_bounds() const override;
     void consume(MirEvent const* event) override;
     void set_alpha(float alpha) override;
     void set_orientation(MirOrientation orientation) override;
@@ -105,6 +107,7 @@ public:
     bool visible() const override;
 
     graphics::RenderableList generate_renderables(compositor::CompositorID id) const override;
+    void append_renderables(compositor::CompositorID id, graphics::RenderableList& list) const override;
     int buffers_ready_for_compositor(void const* compositor_id) const override;
 
     MirWindowType type() const override;
@@ -178,6 +181,10 @@ private:
     MirPointerConfinementState confine_pointer_state_ = mir_pointer_unconfined;
 
     std::unique_ptr<CursorStreamImageAdapter> const cursor_stream_adapter;
+
+    /// Recycle the renderables generated each frame, and their opaque regions
+    std::shared_ptr<BlockPool> const snapshot_pool;
+    std::shared_ptr<BlockPool> const opaque_region_pool;
 };
 
 }
@@ -20,6 +20,7 @@
 
 #include "mir/scene/legacy_scene_change_notification.h"
 #include "mir/scene/surface.h"
+#include "mir/geometry/rectangles.h"
 
 #include <boost/throw_exception.hpp>
 
@@ -58,10 +59,19 @@ public:
         ms::Surface* surface);
 
     void moved_to(ms::Surface const* surf, const mir::geometry::Point&) override;
+    void resized_to(ms::Surface const* surf, const mir::geometry::Size& size) override;
     void frame_posted(ms::Surface const* surf, int frames_available, const mir::geometry::Size& size) override;
 
 private:
+    // Only the outputs showing where the surface was, or is now, need to recomposite
+    void geometry_changed(ms::Surface const* surf);
+
+    /// The area covered by the surface and its buffer streams (and so its subsurfaces)
+    auto extents_of(ms::Surface const* surf) const -> mir::geometry::Rectangle;
+
     mir::geometry::Point top_left;
+    mir::geometry::Size size;
+    mir::geometry::Rectangle extents;
     std::function<void(int frames, mir::geometry::Rectangle const& damage)> const damage_notify_change;
 };
 
@@ -73,12 +83,47 @@ NonLegacySurfaceChangeNotification::NonLegacySurfaceChangeNotification(
     damage_notify_change(damage_notify_change)
 {
     top_left = surface->top_left();
+    size = surface->size();
+    extents = extents_of(surface);
 }
 
 void NonLegacySurfaceChangeNotification::moved_to(ms::Surface const* surf, const mir::geometry::Point& top_left)
 {
     this->top_left = top_left;
-    ms::LegacySurfaceChangeNotification::moved_to(surf, top_left);
+    geometry_changed(surf);
+}
+
+void NonLegacySurfaceChangeNotification::resized_to(ms::Surface const* surf, const mir::geometry::Size& size)
+{
+    this->size = size;
+    geometry_changed(surf);
+}
+
+void NonLegacySurfaceChangeNotification::geometry_changed(ms::Surface const* surf)
+{
+    auto const before = extents;
+    extents = extents_of(surf);
+
+    if (surf->visible())
+    {
+        damage_notify_change(1, before);
+        damage_notify_change(1, extents);
+    }
+}
+
+auto NonLegacySurfaceChangeNotification::extents_of(ms::Surface const* surf) const -> mir::geometry::Rectangle
+{
+    mir::geometry::Rectangles area{{top_left, size}};
+
+    // Any compositor ID will do: the renderables are only asked where they are
+    for (auto const& renderable : surf->generate_renderables(this))
+    {
+        auto const position = renderable->screen_position();
+        if (position.size.width.as_int() > 0 && position.size.height.as_int() > 0)
+            area.add(position);
+    }
+
+    return area.bounding_rectangle();
 }
 
 void NonLegacySurfaceChangeNotification::frame_posted(ms::Surface const*, int frames_available, const mir::geometry::Size& size)
@@ -0,0 +1,160 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_SCENE_RECYCLING_ALLOCATOR_H_
+#define MIR_SCENE_RECYCLING_ALLOCATOR_H_
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace mir
+{
+namespace scene
+{
+/**
+ * Keeps freed blocks for reuse, so objects created and destroyed every
+ * frame don't each cost a trip to the heap.
+ *
+ * Requests are rounded up to a power-of-two size class, each with spare
+ * blocks of its own, so blocks of varying size (e.g. the storage of vectors
+ * of varying length) are recycled as well as blocks of a single size.
+ * Requests larger than the largest class go straight to the heap.
+ * Blocks may be freed from any thread.
+ */
+class BlockPool
+{
+public:
+    BlockPool() = default;
+
+    ~BlockPool()
+    {
+        for (auto const& blocks : spare)
+        {
+            for (auto const block : blocks)
+                ::operator delete(block);
+        }
+    }
+
+    void* allocate(std::size_t size)
+    {
+        auto const size_class = class_of(size);
+        if (size_class == size_classes)
+            return ::operator new(size);
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+
+            auto& blocks = spare[size_class];
+            if (!blocks.empty())
+            {
+                auto const block = blocks.back();
+                blocks.pop_back();
+                return block;
+            }
+        }
+
+        return ::operator new(smallest_block << size_class);
+    }
+
+    void deallocate(void* block, std::size_t size) noexcept
+    {
+        auto const size_class = class_of(size);
+        if (size_class != size_classes)
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+
+            try
+            {
+                spare[size_class].push_back(block);
+                return;
+            }
+            catch (std::bad_alloc const&)
+            {
+            }
+        }
+
+        ::operator delete(block);
+    }
+
+private:
+    BlockPool(BlockPool const&) = delete;
+    BlockPool& operator=(BlockPool const&) = delete;
+
+    static std::size_t const smallest_block = 16;
+    static std::size_t const size_classes = 13;     // So the largest is 64KiB
+
+    /// The class of blocks big enough for size, or size_classes if there isn't one
+    static std::size_t class_of(std::size_t size)
+    {
+        std::size_t size_class = 0;
+        while (size_class != size_classes && (smallest_block << size_class) < size)
+            ++size_class;
+        return size_class;
+    }
+
+    std::mutex mutex;
+    std::array<std::vector<void*>, size_classes> spare;
+};
+
+/// An allocator drawing on a BlockPool, which it keeps alive
+template<typename T>
+class RecyclingAllocator
+{
+public:
+    using value_type = T;
+
+    explicit RecyclingAllocator(std::shared_ptr<BlockPool> const& pool) : pool{pool} {}
+
+    template<typename U>
+    RecyclingAllocator(RecyclingAllocator<U> const& other) : pool{other.pool} {}
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(pool->allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        pool->deallocate(p, n * sizeof(T));
+    }
+
+private:
+    template<typename U> friend class RecyclingAllocator;
+    template<typename U, typename V>
+    friend bool operator==(RecyclingAllocator<U> const&, RecyclingAllocator<V> const&);
+
+    std::shared_ptr<BlockPool> pool;
+};
+
+template<typename U, typename V>
+bool operator==(RecyclingAllocator<U> const& lhs, RecyclingAllocator<V> const& rhs)
+{
+    return lhs.pool == rhs.pool;
+}
+
+template<typename U, typename V>
+bool operator!=(RecyclingAllocator<U> const& lhs, RecyclingAllocator<V> const& rhs)
+{
+    return !(lhs == rhs);
+}
+}
+}
+
+#endif // MIR_SCENE_RECYCLING_ALLOCATOR_H_
@@ -20,6 +20,7 @@
 
 #include "surface_stack.h"
 #include "rendering_tracker.h"
+#include "recycling_allocator.h"
 #include "mir/scene/surface.h"
 #include "mir/scene/scene_report.h"
 #include "mir/compositor/scene_element.h"
@@ -46,14 +47,12 @@ class SurfaceSceneElement : public mc::SceneElement
 {
 public:
     SurfaceSceneElement(
-        std::string name,
         std::shared_ptr<mg::Renderable> const& renderable,
         std::shared_ptr<ms::RenderingTracker> const& tracker,
         mc::CompositorID id)
         : renderable_{renderable},
           tracker{tracker},
-          cid{id},
-          surface_name(name)
+          cid{id}
     {
     }
 
@@ -76,7 +75,6 @@ private:
     std::shared_ptr<mg::Renderable> const renderable_;
     std::shared_ptr<ms::RenderingTracker> const tracker;
     mc::CompositorID cid;
-    std::string const surface_name;
 };
 
 //note: something different than a 2D/HWC overlay
@@ -111,49 +109,97 @@ private:
 ms::SurfaceStack::SurfaceStack(
     std::shared_ptr<SceneReport> const& report) :
     report{report},
-    scene_changed{false}
+    snapshot{std::make_shared<Snapshot const>()},
+    surface_element_pool{std::make_shared<BlockPool>()},
+    overlay_element_pool{std::make_shared<BlockPool>()}
 {
 }
 
+void ms::SurfaceStack::publish_snapshot()
+{
+    auto next = std::make_shared<Snapshot>();
+
+    next->surfaces = surfaces;
+    next->trackers.reserve(surfaces.size());
+    for (auto const& surface : surfaces)
+        next->trackers.push_back(rendering_trackers.at(surface.get()));
+    next->overlays = overlays;
+
+    std::atomic_store(&snapshot, std::shared_ptr<Snapshot const>{std::move(next)});
+}
+
+auto ms::SurfaceStack::current_snapshot() const -> std::shared_ptr<Snapshot const>
+{
+    return std::atomic_load(&snapshot);
+}
+
 mc::SceneElementSequence ms::SurfaceStack::scene_elements_for(mc::CompositorID id)
 {
-    RecursiveReadLock lg(guard);
+    auto const current = current_snapshot();
+    auto& scratch = scratch_for(id);
+
+    {
+        std::lock_guard<std::mutex> lock{scene_change_mutex};
+        compositors_with_scene_changes.erase(id);
+    }
 
-    scene_changed = false;
     mc::SceneElementSequence elements;
-    for (auto const& surface : surfaces)
+    elements.reserve(scratch.element_count);
+    for (auto i = 0u; i != current->surfaces.size(); ++i)
     {
+        auto const& surface = current->surfaces[i];
         if (surface->visible())
         {
-            for (auto& renderable : surface->generate_renderables(id))
+            scratch.renderables.clear();
+            surface->append_renderables(id, scratch.renderables);
+            for (auto const& renderable : scratch.renderables)
             {
                 elements.emplace_back(
-                    std::make_shared<SurfaceSceneElement>(
-                        surface->name(),
+                    std::allocate_shared<SurfaceSceneElement>(
+                        RecyclingAllocator<SurfaceSceneElement>{surface_element_pool},
                         renderable,
-                        rendering_trackers[surface.get()],
+                        current->trackers[i],
                         id));
             }
         }
     }
-    for (auto const& renderable : overlays)
+    // Don't hold on to the renderables (and their buffers) beyond the frame
+    scratch.renderables.clear();
+
+    for (auto const& renderable : current->overlays)
     {
-        elements.emplace_back(std::make_shared<OverlaySceneElement>(renderable));
+        elements.emplace_back(
+            std::allocate_shared<OverlaySceneElement>(
+                RecyclingAllocator<OverlaySceneElement>{overlay_element_pool},
+                renderable));
     }
+    scratch.element_count = elements.size();
     return elements;
 }
 
+auto ms::SurfaceStack::scratch_for(mc::CompositorID id) -> CompositorScratch&
+{
+    std::lock_guard<std::mutex> lock{scratch_mutex};
+    return compositor_scratch[id];
+}
+
 int ms::SurfaceStack::frames_pending(mc::CompositorID id) const
 {
-    RecursiveReadLock lg(guard);
+    auto const current = current_snapshot();
 
-    int result = scene_changed ? 1 : 0;
-    for (auto const& surface : surfaces)
+    int result = 0;
     {
+        std::lock_guard<std::mutex> lock{scene_change_mutex};
+        if (compositors_with_scene_changes.count(id))
+            result = 1;
+    }
+
+    for (auto i = 0u; i != current->surfaces.size(); ++i)
+    {
+        auto const& surface = current->surfaces[i];
         if (surface->visible())
         {
-            auto const tracker = rendering_trackers.find(surface.get());
-            if (tracker != rendering_trackers.end() && tracker->second->is_exposed_in(id))
+            if (current->trackers[i]->is_exposed_in(id))
             {
                 // Note that we ask the surface and not a Renderable.
                 // This is because we don't want to waste time and resources
@@ -183,6 +229,14 @@ void ms::SurfaceStack::unregister_compositor(mc::CompositorID cid)
     registered_compositors.erase(cid);
 
     update_rendering_tracker_compositors();
+
+    {
+        std::lock_guard<std::mutex> lock{scene_change_mutex};
+        compositors_with_scene_changes.erase(cid);
+    }
+
+    std::lock_guard<std::mutex> lock{scratch_mutex};
+    compositor_scratch.erase(cid);
 }
 
 void ms::SurfaceStack::add_input_visualization(
@@ -191,6 +245,7 @@ void ms::SurfaceStack::add_input_visualization(
     {
         RecursiveWriteLock lg(guard);
         overlays.push_back(overlay);
+        publish_snapshot();
     }
     emit_scene_changed();
 }
@@ -207,6 +262,7 @@ void ms::SurfaceStack::remove_input_visualization(
             BOOST_THROW_EXCEPTION(std::runtime_error("Attempt to remove an overlay which was never added or which has been previously removed"));
         }
         overlays.erase(p);
+        publish_snapshot();
     }
     
     emit_scene_changed();
@@ -215,8 +271,9 @@ void ms::SurfaceStack::remove_input_visualization(
 void ms::SurfaceStack::emit_scene_changed()
 {
     {
-        RecursiveWriteLock lg(guard);
-        scene_changed = true;
+        RecursiveReadLock lg(guard);
+        std::lock_guard<std::mutex> lock{scene_change_mutex};
+        compositors_with_scene_changes = registered_compositors;
     }
     observers.scene_changed();
 }
@@ -229,6 +286,7 @@ void ms::SurfaceStack::add_surface(
         RecursiveWriteLock lg(guard);
         surfaces.push_back(surface);
         create_rendering_tracker_for(surface);
+        publish_snapshot();
     }
     surface->set_reception_mode(input_mode);
     observers.surface_added(surface.get());
@@ -250,6 +308,7 @@ void ms::SurfaceStack::remove_surface(std::weak_ptr<Surface> const& surface)
         {
             surfaces.erase(surface);
             rendering_trackers.erase(keep_alive.get());
+            publish_snapshot();
             found_surface = true;
         }
     }
@@ -267,20 +326,20 @@ namespace
 {
 template <typename Container>
 struct InReverse {
-    Container& container;
+    Container const& container;
     auto begin() -> decltype(container.rbegin()) { return container.rbegin(); }
     auto end() -> decltype(container.rend()) { return container.rend(); }
 };
 
 template <typename Container>
-InReverse<Container> in_reverse(Container& container) { return InReverse<Container>{container}; }
+InReverse<Container> in_reverse(Container const& container) { return InReverse<Container>{container}; }
 }
 
 auto ms::SurfaceStack::surface_at(geometry::Point cursor) const
 -> std::shared_ptr<Surface>
 {
-    RecursiveReadLock lg(guard);
-    for (auto const& surface : in_reverse(surfaces))
+    auto const current = current_snapshot();
+    for (auto const& surface : in_reverse(current->surfaces))
     {
         // TODO There's a lack of clarity about how the input area will
         // TODO be maintained and whether this test will detect clicks on
@@ -295,8 +354,8 @@ auto ms::SurfaceStack::surface_at(geometry::Point cursor) const
 
 void ms::SurfaceStack::for_each(std::function<void(std::shared_ptr<mi::Surface> const&)> const& callback)
 {
-    RecursiveReadLock lg(guard);
-    for (auto &surface : surfaces)
+    auto const current = current_snapshot();
+    for (auto const& surface : current->surfaces)
     {
         callback(surface);
     }
@@ -316,6 +375,7 @@ void ms::SurfaceStack::raise(std::weak_ptr<Surface> const& s)
         {
             surfaces.erase(p);
             surfaces.push_back(surface);
+            publish_snapshot();
             surfaces_reordered = true;
         }
     }
@@ -339,7 +399,10 @@ void ms::SurfaceStack::raise(SurfaceSet const& ss)
             [&](std::weak_ptr<Surface> const& s) { return !ss.count(s); });
 
         if (old_surfaces != surfaces)
+        {
+            publish_snapshot();
             surfaces_reordered = true;
+        }
     }
 
     if (surfaces_reordered)
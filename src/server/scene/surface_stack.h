@@ -22,6 +22,7 @@
 #include "mir/shell/surface_stack.h"
 
 #include "mir/compositor/scene.h"
+#include "mir/graphics/renderable.h"
 #include "mir/scene/observer.h"
 #include "mir/input/scene.h"
 #include "mir/recursive_read_write_mutex.h"
@@ -33,6 +34,7 @@
 #include <memory>
 #include <mutex>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 namespace mir
@@ -48,6 +50,7 @@ namespace scene
 class BasicSurface;
 class SceneReport;
 class RenderingTracker;
+class BlockPool;
 
 class Observers : public Observer, BasicObservers<Observer>
 {
@@ -107,6 +110,19 @@ private:
     void create_rendering_tracker_for(std::shared_ptr<Surface> const&);
     void update_rendering_tracker_compositors();
 
+    /// An immutable copy of the stack for compositors and input to read
+    /// without contending with the shell for the guard
+    struct Snapshot
+    {
+        std::vector<std::shared_ptr<Surface>> surfaces;
+        std::vector<std::shared_ptr<RenderingTracker>> trackers;    // One for each surface
+        std::vector<std::shared_ptr<graphics::Renderable>> overlays;
+    };
+
+    /// Replaces the published snapshot. Call with the guard write locked.
+    void publish_snapshot();
+    auto current_snapshot() const -> std::shared_ptr<Snapshot const>;
+
     RecursiveReadWriteMutex mutable guard;
 
     std::shared_ptr<SceneReport> const report;
@@ -117,8 +133,27 @@ private:
     
     std::vector<std::shared_ptr<graphics::Renderable>> overlays;
 
+    /// Only accessed with std::atomic_load() and std::atomic_store()
+    std::shared_ptr<Snapshot const> snapshot;
+
+    /// Storage each compositor reuses from frame to frame
+    struct CompositorScratch
+    {
+        graphics::RenderableList renderables;
+        size_t element_count{0};
+    };
+    auto scratch_for(compositor::CompositorID id) -> CompositorScratch&;
+
+    std::mutex scratch_mutex;
+    std::unordered_map<compositor::CompositorID, CompositorScratch> compositor_scratch;
+    std::shared_ptr<BlockPool> const surface_element_pool;
+    std::shared_ptr<BlockPool> const overlay_element_pool;
+
     Observers observers;
-    std::atomic<bool> scene_changed;
+
+    /// Compositors that have yet to composite the latest generic scene change
+    std::mutex mutable scene_change_mutex;
+    std::set<compositor::CompositorID> compositors_with_scene_changes;
 };
 
 }
@@ -23,9 +23,10 @@
 #include "mir/geometry/size.h"
 #include "mir/geometry/rectangle.h"
 #include "mir/raii.h"
+#include "screencast_delta.h"
 
 #include <EGL/egl.h>
-#include <GLES2/gl2.h>
+#include <GLES3/gl3.h>
 #include <GLES2/gl2ext.h>
 
 #include <boost/program_options.hpp>
@@ -248,6 +249,7 @@ class Screencast
 public:
     virtual ~Screencast() = default;
     virtual std::string pixel_format() = 0;
+    virtual uint32_t bytes_per_pixel() = 0;
 
     void run(std::ostream& stream)
     {
@@ -262,10 +264,15 @@ public:
 
             std::this_thread::sleep_until(time_point);
         }
+
+        finish(stream);
     }
 
     virtual void capture_to(std::ostream& stream) = 0;
 
+    /// Writes out any captures still in flight
+    virtual void finish(std::ostream& /*stream*/) {}
+
 protected:
     Screencast(int number_of_captures, double capture_fps)
         : number_of_captures{number_of_captures},
@@ -288,7 +295,8 @@ public:
                            MirBufferStream* buffer_stream)
         : Screencast(num_captures, capture_fps),
           buffer_stream{buffer_stream},
-          pixel_format_{mir_pixel_format_to_string(config->pixel_format)}
+          pixel_format_{mir_pixel_format_to_string(config->pixel_format)},
+          bytes_per_pixel_{static_cast<uint32_t>(MIR_BYTES_PER_PIXEL(config->pixel_format))}
     {
         // Don't complete construction unless this is going to work later!
         graphics_region_for(buffer_stream);
@@ -299,6 +307,11 @@ public:
         return pixel_format_;
     }
 
+    uint32_t bytes_per_pixel() override
+    {
+        return bytes_per_pixel_;
+    }
+
     void capture_to(std::ostream& stream) override
     {
         MirGraphicsRegion const region{graphics_region_for(buffer_stream)};
@@ -318,6 +331,7 @@ public:
 private:
     MirBufferStream* const buffer_stream;
     std::string const pixel_format_;
+    uint32_t const bytes_per_pixel_;
 };
 
 class EGLScreencast : public Screencast
@@ -339,7 +353,11 @@ public:
             EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
             EGL_NONE};
 
-        static EGLint const context_attribs[] = {
+        static EGLint const es3_context_attribs[] = {
+            EGL_CONTEXT_CLIENT_VERSION, 3,
+            EGL_NONE };
+
+        static EGLint const es2_context_attribs[] = {
             EGL_CONTEXT_CLIENT_VERSION, 2,
             EGL_NONE };
 #pragma GCC diagnostic push
@@ -363,7 +381,11 @@ public:
         if (egl_surface == EGL_NO_SURFACE)
             throw std::runtime_error("Failed to create EGL screencast surface");
 
-        egl_context = eglCreateContext(egl_display, egl_config, EGL_NO_CONTEXT, context_attribs);
+        // GLES3 gives us pixel pack buffers for reading back asynchronously
+        egl_context = eglCreateContext(egl_display, egl_config, EGL_NO_CONTEXT, es3_context_attribs);
+        bool const have_pack_buffers{egl_context != EGL_NO_CONTEXT};
+        if (!have_pack_buffers)
+            egl_context = eglCreateContext(egl_display, egl_config, EGL_NO_CONTEXT, es2_context_attribs);
         if (egl_context == EGL_NO_CONTEXT)
             throw std::runtime_error("Failed to create EGL context for screencast");
 
@@ -380,13 +402,26 @@ public:
         else
             read_pixel_format = GL_RGBA;
 
-        int const rgba_pixel_size{4};
         auto const frame_size_bytes = rgba_pixel_size * width * height;
         buffer.resize(frame_size_bytes);
+
+        if (have_pack_buffers)
+        {
+            glGenBuffers(num_pack_buffers, pack_buffers);
+            for (auto const pack_buffer : pack_buffers)
+            {
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, pack_buffer);
+                glBufferData(GL_PIXEL_PACK_BUFFER, frame_size_bytes, nullptr, GL_STREAM_READ);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
     }
 
     ~EGLScreencast()
     {
+        if (pack_buffers[0] != 0)
+            glDeleteBuffers(num_pack_buffers, pack_buffers);
+
         eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
         eglDestroySurface(egl_display, egl_surface);
         eglDestroyContext(egl_display, egl_context);
@@ -395,19 +430,48 @@ public:
 
     void capture_to(std::ostream& stream) override
     {
-        void* data = buffer.data();
-        glReadPixels(0, 0, width, height, read_pixel_format, GL_UNSIGNED_BYTE, data);
+        std::future<void> write_out_future;
 
-        auto write_out_future = std::async(
-            std::launch::async,
-            [this, &stream] {
-            stream.write(buffer.data(), buffer.size());
-            });
+        if (pack_buffers[0] != 0)
+        {
+            /*
+             * Queue the read of this capture and collect the previous one,
+             * which has had a whole capture period to finish. Waiting on
+             * the read we just queued would stall on the GPU.
+             */
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pack_buffers[next_pack_buffer]);
+            glReadPixels(0, 0, width, height, read_pixel_format, GL_UNSIGNED_BYTE, nullptr);
+            next_pack_buffer = (next_pack_buffer + 1) % num_pack_buffers;
+
+            if (++captures_in_flight == num_pack_buffers)
+            {
+                copy_from_pack_buffer(pack_buffers[oldest_pack_buffer()]);
+                --captures_in_flight;
+                write_out_future = write_out_async(stream);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+        else
+        {
+            glReadPixels(0, 0, width, height, read_pixel_format, GL_UNSIGNED_BYTE, buffer.data());
+            write_out_future = write_out_async(stream);
+        }
 
         if (eglSwapBuffers(egl_display, egl_surface) != EGL_TRUE)
             throw std::runtime_error("Failed to swap screencast surface buffers");
 
-        write_out_future.wait();
+        if (write_out_future.valid())
+            write_out_future.wait();
+    }
+
+    void finish(std::ostream& stream) override
+    {
+        for (; captures_in_flight != 0; --captures_in_flight)
+        {
+            copy_from_pack_buffer(pack_buffers[oldest_pack_buffer()]);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            stream.write(buffer.data(), buffer.size());
+        }
     }
 
     std::string pixel_format() override
@@ -415,10 +479,47 @@ public:
         return read_pixel_format == GL_BGRA_EXT ? "BGRA" : "RGBA";
     }
 
+    uint32_t bytes_per_pixel() override
+    {
+        return rgba_pixel_size;
+    }
+
 private:
+    std::future<void> write_out_async(std::ostream& stream)
+    {
+        return std::async(
+            std::launch::async,
+            [this, &stream] {
+            stream.write(buffer.data(), buffer.size());
+            });
+    }
+
+    int oldest_pack_buffer() const
+    {
+        return (next_pack_buffer + num_pack_buffers - captures_in_flight) % num_pack_buffers;
+    }
+
+    void copy_from_pack_buffer(GLuint pack_buffer)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pack_buffer);
+        auto const pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, buffer.size(), GL_MAP_READ_BIT);
+        if (!pixels)
+            throw std::runtime_error("Failed to map screencast pixel pack buffer");
+
+        auto const begin = static_cast<char const*>(pixels);
+        std::copy(begin, begin + buffer.size(), buffer.begin());
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+
+    static int const num_pack_buffers{2};
+    static uint32_t const rgba_pixel_size{4};
+
     unsigned int const width;
     unsigned int const height;
     std::vector<char> buffer;
+    GLuint pack_buffers[num_pack_buffers]{};
+    int next_pack_buffer{0};
+    int captures_in_flight{0};
     EGLDisplay egl_display;
     EGLContext egl_context;
     EGLSurface egl_surface;
@@ -426,6 +527,66 @@ private:
     GLenum read_pixel_format;
 };
 
+/// Collects the raw frames written to it and passes them on delta encoded
+class DeltaEncodingBuffer : public std::streambuf
+{
+public:
+    DeltaEncodingBuffer(std::ostream& out, uint32_t width, uint32_t height, uint32_t bytes_per_pixel) :
+        encoder{out, width, height, bytes_per_pixel}
+    {
+        frame.reserve(encoder.frame_size());
+    }
+
+protected:
+    std::streamsize xsputn(char const* data, std::streamsize count) override
+    {
+        auto remaining = count;
+        while (remaining > 0)
+        {
+            auto const space = static_cast<std::streamsize>(encoder.frame_size() - frame.size());
+            auto const chunk = std::min(remaining, space);
+            frame.insert(frame.end(), data, data + chunk);
+            data += chunk;
+            remaining -= chunk;
+
+            if (frame.size() == encoder.frame_size())
+            {
+                encoder.encode(frame.data());
+                frame.clear();
+            }
+        }
+        return count;
+    }
+
+    int_type overflow(int_type c) override
+    {
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            char const ch = traits_type::to_char_type(c);
+            xsputn(&ch, 1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+private:
+    mir::screencast_delta::Encoder encoder;
+    std::vector<char> frame;
+};
+
+void run_screencast(Screencast& screencast, std::ostream& stream, bool delta, ScreencastConfiguration const& config)
+{
+    if (delta)
+    {
+        DeltaEncodingBuffer delta_buffer{stream, config.width, config.height, screencast.bytes_per_pixel()};
+        std::ostream delta_stream{&delta_buffer};
+        screencast.run(delta_stream);
+    }
+    else
+    {
+        screencast.run(stream);
+    }
+}
+
 std::unique_ptr<Screencast> create_screencast(int num_captures, double capture_fps,
                                               MirConnection* connection,
                                               ScreencastConfiguration* config,
@@ -454,6 +615,7 @@ try
     std::vector<int> requested_size;
     bool use_std_out = false;
     bool query_params_only = false;
+    bool delta = false;
     int capture_interval = 1;
 
     po::options_description desc("Usage");
@@ -474,6 +636,9 @@ try
             po::value<std::vector<int>>(&screen_region)->multitoken(),
             "screen region to capture [left top width height]")
         ("stdout", po::value<bool>(&use_std_out)->zero_tokens(), "use stdout for output (--file is ignored)")
+        ("delta",
+            po::value<bool>(&delta)->zero_tokens(),
+            "only write what changed between captures (mirscreencast-replay converts back to raw frames)")
         ("query",
             po::value<bool>(&query_params_only)->zero_tokens(),
             "only queries the colorspace and output size used but does not start screencast")
@@ -575,6 +740,8 @@ try
         ss << screencast_config.width << "x" << screencast_config.height;
         ss << "_" << capture_fps << "Hz";
         ss << to_file_extension(screencast->pixel_format());
+        if (delta)
+            ss << ".delta";
         output_filename = ss.str();
     }
 
@@ -591,12 +758,12 @@ try
 
     if (use_std_out)
     {
-        screencast->run(std::cout);
+        run_screencast(*screencast, std::cout, delta, screencast_config);
     }
     else
     {
         std::ofstream file_stream(output_filename);
-        screencast->run(file_stream);
+        run_screencast(*screencast, file_stream, delta, screencast_config);
     }
 
     return EXIT_SUCCESS;
@@ -0,0 +1,223 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIR_UTILS_SCREENCAST_DELTA_H_
+#define MIR_UTILS_SCREENCAST_DELTA_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+/*
+ * The delta format written by "mirscreencast --delta".
+ *
+ * Only what changed since the previous capture is written, so a mostly
+ * static screen costs a few bytes per capture. Integers are in the host's
+ * byte order, as the pixels of the raw format are.
+ *
+ *   header: "MIRDELTA", uint32 width, uint32 height, uint32 bytes per pixel
+ *   each capture: uint64 nanoseconds since the first capture, uint32 count,
+ *     then count rectangles, each uint32 left, top, width, height followed
+ *     by its rows of pixels, top to bottom
+ */
+namespace mir
+{
+namespace screencast_delta
+{
+char const magic[8]{'M', 'I', 'R', 'D', 'E', 'L', 'T', 'A'};
+
+struct Rectangle
+{
+    uint32_t left, top, width, height;
+};
+
+template<typename T>
+void write_value(std::ostream& out, T value)
+{
+    out.write(reinterpret_cast<char const*>(&value), sizeof value);
+}
+
+template<typename T>
+bool read_value(std::istream& in, T& value)
+{
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof value));
+}
+
+class Encoder
+{
+public:
+    Encoder(std::ostream& out, uint32_t width, uint32_t height, uint32_t bytes_per_pixel) :
+        out(out), width{width}, height{height}, bytes_per_pixel{bytes_per_pixel},
+        start{std::chrono::steady_clock::now()}
+    {
+        out.write(magic, sizeof magic);
+        write_value(out, width);
+        write_value(out, height);
+        write_value(out, bytes_per_pixel);
+    }
+
+    std::size_t frame_size() const { return std::size_t(width) * height * bytes_per_pixel; }
+
+    /// Writes out what changed between frame (of frame_size() bytes) and the last
+    void encode(char const* frame)
+    {
+        auto const now = std::chrono::steady_clock::now();
+        write_value(out, uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count()));
+
+        damage.clear();
+        if (previous.empty())
+            damage.push_back({0, 0, width, height});
+        else
+            find_damage(frame);
+
+        write_value(out, uint32_t(damage.size()));
+        for (auto const& rect : damage)
+        {
+            write_value(out, rect);
+            for (auto row = rect.top; row != rect.top + rect.height; ++row)
+                out.write(frame + offset_of(rect.left, row), rect.width * bytes_per_pixel);
+        }
+
+        previous.assign(frame, frame + frame_size());
+    }
+
+private:
+    // Compare tiles rather than pixels: fewer, larger rectangles compress the
+    // stream better than an exact outline of the damage would
+    static uint32_t const tile_size{64};
+
+    std::size_t offset_of(uint32_t x, uint32_t y) const
+    {
+        return (std::size_t(y) * width + x) * bytes_per_pixel;
+    }
+
+    void find_damage(char const* frame)
+    {
+        auto const columns = (width + tile_size - 1) / tile_size;
+        dirty.resize(columns);
+
+        for (uint32_t top = 0; top < height; top += tile_size)
+        {
+            auto const bottom = std::min(top + tile_size, height);
+            std::fill(dirty.begin(), dirty.end(), false);
+
+            for (uint32_t column = 0; column != columns; ++column)
+            {
+                auto const left = column * tile_size;
+                auto const bytes = (std::min(left + tile_size, width) - left) * bytes_per_pixel;
+                for (auto row = top; row != bottom && !dirty[column]; ++row)
+                {
+                    auto const offset = offset_of(left, row);
+                    dirty[column] = std::memcmp(frame + offset, previous.data() + offset, bytes) != 0;
+                }
+            }
+
+            // Runs of damaged tiles in this band make one rectangle
+            for (uint32_t column = 0; column != columns;)
+            {
+                if (!dirty[column])
+                {
+                    ++column;
+                    continue;
+                }
+
+                auto const first = column;
+                while (column != columns && dirty[column])
+                    ++column;
+
+                auto const left = first * tile_size;
+                auto const right = std::min(column * tile_size, width);
+                damage.push_back({left, top, right - left, bottom - top});
+            }
+        }
+    }
+
+    std::ostream& out;
+    uint32_t const width;
+    uint32_t const height;
+    uint32_t const bytes_per_pixel;
+    std::chrono::steady_clock::time_point const start;
+    std::vector<char> previous;
+    std::vector<Rectangle> damage;
+    std::vector<bool> dirty;
+};
+
+class Decoder
+{
+public:
+    explicit Decoder(std::istream& in) : in(in)
+    {
+        char header[sizeof magic];
+        if (!in.read(header, sizeof header) || !std::equal(header, header + sizeof header, magic) ||
+            !read_value(in, width) || !read_value(in, height) || !read_value(in, bytes_per_pixel))
+        {
+            throw std::runtime_error("Not a mirscreencast delta stream");
+        }
+
+        frame.resize(std::size_t(width) * height * bytes_per_pixel);
+    }
+
+    /// Applies the next capture to current_frame(). Returns false at the end of the stream.
+    bool next(std::chrono::nanoseconds& time)
+    {
+        uint64_t nanoseconds;
+        uint32_t count;
+        if (!read_value(in, nanoseconds) || !read_value(in, count))
+            return false;
+
+        for (uint32_t i = 0; i != count; ++i)
+        {
+            Rectangle rect;
+            // Written so that a corrupt rectangle can't overflow past the checks
+            if (!read_value(in, rect) ||
+                rect.width > width || rect.left > width - rect.width ||
+                rect.height > height || rect.top > height - rect.height)
+            {
+                throw std::runtime_error("Corrupt mirscreencast delta stream");
+            }
+
+            for (auto row = rect.top; row != rect.top + rect.height; ++row)
+            {
+                auto const offset = (std::size_t(row) * width + rect.left) * bytes_per_pixel;
+                if (!in.read(frame.data() + offset, rect.width * bytes_per_pixel))
+                    throw std::runtime_error("Truncated mirscreencast delta stream");
+            }
+        }
+
+        time = std::chrono::nanoseconds{nanoseconds};
+        return true;
+    }
+
+    std::vector<char> const& current_frame() const { return frame; }
+    uint32_t frame_width() const { return width; }
+    uint32_t frame_height() const { return height; }
+
+private:
+    std::istream& in;
+    uint32_t width;
+    uint32_t height;
+    uint32_t bytes_per_pixel;
+    std::vector<char> frame;
+};
+}
+}
+
+#endif // MIR_UTILS_SCREENCAST_DELTA_H_
@@ -0,0 +1,111 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "screencast_delta.h"
+
+#include <boost/program_options.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace po = boost::program_options;
+
+int main(int argc, char* argv[])
+try
+{
+    std::string input_filename;
+    std::string output_filename;
+    bool use_std_out = false;
+    bool realtime = false;
+
+    po::options_description desc("Usage");
+    desc.add_options()
+        ("help,h", "displays this message")
+        ("input,i",
+            po::value<std::string>(&input_filename), "delta stream written by \"mirscreencast --delta\"")
+        ("file,f",
+            po::value<std::string>(&output_filename), "output filename for the raw frames")
+        ("stdout", po::value<bool>(&use_std_out)->zero_tokens(), "use stdout for output (--file is ignored)")
+        ("realtime",
+            po::value<bool>(&realtime)->zero_tokens(),
+            "write each frame out at the time it was captured, for piping into a player");
+
+    po::positional_options_description positional;
+    positional.add("input", 1);
+
+    po::variables_map vm;
+    try
+    {
+        po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+        po::notify(vm);
+
+        if (!vm.count("help") && input_filename.empty())
+            throw po::error("no input given");
+
+        if (!vm.count("help") && output_filename.empty() && !use_std_out)
+            throw po::error("give an output file or --stdout");
+    }
+    catch(po::error& e)
+    {
+        std::cerr << e.what() << std::endl << std::endl;
+        std::cerr << desc << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (vm.count("help"))
+    {
+        std::cout << desc << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    std::ifstream input{input_filename, std::ios::binary};
+    if (!input)
+        throw std::runtime_error("Failed to open " + input_filename);
+
+    std::ofstream file_stream;
+    if (!use_std_out)
+    {
+        file_stream.open(output_filename, std::ios::binary);
+        if (!file_stream)
+            throw std::runtime_error("Failed to open " + output_filename);
+    }
+    std::ostream& output = use_std_out ? std::cout : file_stream;
+
+    mir::screencast_delta::Decoder decoder{input};
+    std::cerr << "Replaying " << decoder.frame_width() << "x" << decoder.frame_height() << " frames" << std::endl;
+
+    auto const start = std::chrono::steady_clock::now();
+    std::chrono::nanoseconds captured_at;
+    while (decoder.next(captured_at))
+    {
+        if (realtime)
+            std::this_thread::sleep_until(start + captured_at);
+
+        auto const& frame = decoder.current_frame();
+        output.write(frame.data(), frame.size());
+        if (realtime)
+            output.flush();
+    }
+
+    return EXIT_SUCCESS;
+}
+catch(std::exception const& e)
+{
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+}
@@ -80,6 +80,16 @@ public:
         return !rectangular;
     }
 
+    geometry::Region opaque_region() const override
+    {
+        return opaque;
+    }
+
+    void set_opaque_region(geometry::Region const& region)
+    {
+        opaque = region;
+    }
+
     void set_buffer(std::shared_ptr<graphics::Buffer> b)
     {
         buf = b;
@@ -105,6 +115,7 @@ private:
     mir::geometry::Rectangle rect;
     float opacity;
     bool rectangular;
+    geometry::Region opaque;
 };
 
 } // namespace doubles
@@ -43,6 +43,10 @@ public:
                  void(compositor::CompositorReport::SubCompositorId));
     MOCK_METHOD1(finished_frame,
                  void(compositor::CompositorReport::SubCompositorId));
+    MOCK_METHOD1(posted_frame,
+                 void(compositor::CompositorReport::SubCompositorId));
+    MOCK_METHOD2(missed_deadline,
+                 void(compositor::CompositorReport::SubCompositorId, std::chrono::nanoseconds));
     MOCK_METHOD0(started, void());
     MOCK_METHOD0(stopped, void());
     MOCK_METHOD0(scheduled, void());
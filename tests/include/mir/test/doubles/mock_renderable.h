@@ -43,6 +43,8 @@ struct MockRenderable : public graphics::Renderable
             .WillByDefault(testing::Return(glm::mat4{}));
         ON_CALL(*this, visible())
             .WillByDefault(testing::Return(true));
+        ON_CALL(*this, opaque_region())
+            .WillByDefault(testing::Return(geometry::Region{}));
     }
 
     MOCK_CONST_METHOD0(id, ID());
@@ -52,6 +54,7 @@ struct MockRenderable : public graphics::Renderable
     MOCK_CONST_METHOD0(transformation, glm::mat4());
     MOCK_CONST_METHOD0(visible, bool());
     MOCK_CONST_METHOD0(shaped, bool());
+    MOCK_CONST_METHOD0(opaque_region, geometry::Region());
     MOCK_CONST_METHOD0(swap_interval, unsigned int());
 };
 }
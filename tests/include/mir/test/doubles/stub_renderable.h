@@ -86,6 +86,10 @@ public:
     {
         return false;
     }
+    geometry::Region opaque_region() const override
+    {
+        return {};
+    }
     unsigned int swap_interval() const override
     {
         return 1;
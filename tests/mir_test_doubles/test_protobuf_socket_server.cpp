@@ -25,6 +25,7 @@
 #include "src/server/report/null_report_factory.h"
 #include "mir/test/doubles/null_emergency_cleanup.h"
 #include "mir/test/doubles/null_platform_ipc_operations.h"
+#include "mir/cookie/authority.h"
 
 namespace mt = mir::test;
 namespace mtd = mir::test::doubles;
@@ -46,6 +47,7 @@ std::shared_ptr<mf::Connector> make_connector(
             factory,
             std::make_shared<mtd::StubSessionAuthorizer>(),
             std::make_shared<mtd::NullPlatformIpcOperations>(),
+            mir::cookie::Authority::create(),
             mr::null_message_processor_report()),
         null_emergency_cleanup,
         report);
@@ -0,0 +1,182 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_window_manager_tools.h"
+
+#include <mir/events/event_builders.h>
+#include <mir_toolkit/events/input/input_event.h>
+
+#include <future>
+#include <stdexcept>
+
+using namespace miral;
+using namespace testing;
+
+namespace
+{
+Rectangle const display_area{{0, 0}, {640, 480}};
+std::chrono::seconds const timeout{5};
+
+// Holds up the thread passing through until released (or timed out)
+struct Gate
+{
+    void pass()
+    {
+        entered_promise.set_value();
+        released.wait_for(timeout);
+    }
+
+    void release() { release_promise.set_value(); }
+
+    std::promise<void> entered_promise;
+    std::future<void> entered{entered_promise.get_future()};
+    std::promise<void> release_promise;
+    std::shared_future<void> released{release_promise.get_future()};
+};
+
+struct SessionWithSlowDestroy : StubStubSession
+{
+    explicit SessionWithSlowDestroy(Gate& gate) : gate{gate} {}
+
+    using StubStubSession::destroy_surface;
+
+    void destroy_surface(std::weak_ptr<mir::scene::Surface> const& /*surface*/) override
+    {
+        gate.pass();
+    }
+
+    Gate& gate;
+};
+
+struct SessionRecordingDestroy : StubStubSession
+{
+    using StubStubSession::destroy_surface;
+
+    void destroy_surface(mir::frontend::SurfaceId surface) override
+    {
+        destroyed.push_back(surface);
+    }
+
+    std::vector<mir::frontend::SurfaceId> destroyed;
+};
+
+struct SessionWithFailingDestroy : StubStubSession
+{
+    using StubStubSession::destroy_surface;
+
+    void destroy_surface(std::weak_ptr<mir::scene::Surface> const& /*surface*/) override
+    {
+        throw std::runtime_error{"destroy_surface() failed"};
+    }
+};
+
+struct InputDuringWindowChurn : TestWindowManagerTools
+{
+    void SetUp() override
+    {
+        basic_window_manager.add_display_for_testing(display_area);
+        basic_window_manager.add_session(session);
+
+        creation_parameters.size = Size{600, 400};
+    }
+
+    auto handle_pointer_motion() -> std::future<bool>
+    {
+        return std::async(std::launch::async, [this]
+            {
+                auto const event = mir::events::make_event(
+                    MirInputDeviceId{0}, std::chrono::nanoseconds{1}, std::vector<uint8_t>{},
+                    mir_input_event_modifier_none, mir_pointer_action_motion, 0,
+                    10.0f, 10.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+
+                return basic_window_manager.handle_pointer_event(
+                    mir_input_event_get_pointer_event(mir_event_get_input_event(event.get())));
+            });
+    }
+
+    mir::scene::SurfaceCreationParameters creation_parameters;
+    Gate gate;
+};
+}
+
+TEST_F(InputDuringWindowChurn, input_is_handled_while_a_surface_is_built)
+{
+    auto const adding = std::async(std::launch::async, [this]
+        {
+            basic_window_manager.add_surface(session, creation_parameters,
+                [this](std::shared_ptr<mir::scene::Session> const& session, mir::scene::SurfaceCreationParameters const& params)
+                {
+                    gate.pass();
+                    return create_surface(session, params);
+                });
+        });
+
+    ASSERT_THAT(gate.entered.wait_for(timeout), Eq(std::future_status::ready));
+
+    auto const handled = handle_pointer_motion();
+    EXPECT_THAT(handled.wait_for(timeout), Eq(std::future_status::ready));
+
+    gate.release();
+}
+
+TEST_F(InputDuringWindowChurn, input_is_handled_while_a_surface_is_destroyed)
+{
+    auto const slow_session = std::make_shared<SessionWithSlowDestroy>(gate);
+    basic_window_manager.add_session(slow_session);
+    auto const surface = slow_session->surface(
+        basic_window_manager.add_surface(slow_session, creation_parameters, &create_surface));
+
+    auto const removing = std::async(std::launch::async, [&]
+        {
+            basic_window_manager.remove_surface(slow_session, surface);
+        });
+
+    ASSERT_THAT(gate.entered.wait_for(timeout), Eq(std::future_status::ready));
+
+    auto const handled = handle_pointer_motion();
+    EXPECT_THAT(handled.wait_for(timeout), Eq(std::future_status::ready));
+
+    gate.release();
+}
+
+TEST_F(InputDuringWindowChurn, a_surface_built_for_a_removed_session_is_destroyed)
+{
+    auto const doomed_session = std::make_shared<SessionRecordingDestroy>();
+    basic_window_manager.add_session(doomed_session);
+
+    mir::frontend::SurfaceId surface_id;
+    EXPECT_NO_THROW(surface_id = basic_window_manager.add_surface(doomed_session, creation_parameters,
+        [this](std::shared_ptr<mir::scene::Session> const& session, mir::scene::SurfaceCreationParameters const& params)
+        {
+            basic_window_manager.remove_session(session);
+            return create_surface(session, params);
+        }));
+
+    EXPECT_THAT(doomed_session->destroyed, ElementsAre(surface_id));
+}
+
+TEST_F(InputDuringWindowChurn, a_failure_destroying_a_surface_after_unlocking_is_contained)
+{
+    auto const failing_session = std::make_shared<SessionWithFailingDestroy>();
+    basic_window_manager.add_session(failing_session);
+    auto const surface = failing_session->surface(
+        basic_window_manager.add_surface(failing_session, creation_parameters, &create_surface));
+
+    EXPECT_NO_THROW(basic_window_manager.remove_surface(failing_session, surface));
+
+    auto const handled = handle_pointer_motion();
+    EXPECT_THAT(handled.wait_for(timeout), Eq(std::future_status::ready));
+}
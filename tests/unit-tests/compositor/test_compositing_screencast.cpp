@@ -25,6 +25,7 @@
 #include "mir/geometry/rectangle.h"
 #include "mir/geometry/rectangles.h"
 #include "mir/renderer/gl/render_target.h"
+#include "mir/scene/observer.h"
 
 #include "mir/test/doubles/null_display.h"
 #include "mir/test/doubles/null_display_buffer_compositor_factory.h"
@@ -349,6 +350,88 @@ TEST_F(CompositingScreencastTest, captures_to_buffer_by_compositing_with_reserve
     screencast.capture(session_id, mt::fake_shared(stub_buffer));
 }
 
+TEST_F(CompositingScreencastTest, does_not_recomposite_to_a_buffer_holding_an_unchanged_capture)
+{
+    using namespace testing;
+
+    mtd::StubGLBuffer stub_buffer;
+    NiceMock<mtd::MockScene> mock_scene;
+    MockDisplayBufferCompositorFactory mock_db_compositor_factory;
+
+    EXPECT_CALL(mock_db_compositor_factory.mock_db_compositor, composite_(_))
+        .Times(1);
+
+    mc::CompositingScreencast screencast{
+        mt::fake_shared(mock_scene),
+        mt::fake_shared(stub_display),
+        mt::fake_shared(stub_buffer_allocator),
+        mt::fake_shared(mock_db_compositor_factory)};
+
+    auto session_id = screencast.create_session(
+        default_region, default_size, default_pixel_format,
+        0, default_mirror_mode);
+
+    screencast.capture(session_id, mt::fake_shared(stub_buffer));
+    screencast.capture(session_id, mt::fake_shared(stub_buffer));
+}
+
+TEST_F(CompositingScreencastTest, recomposites_after_damage_to_the_captured_region)
+{
+    using namespace testing;
+
+    mtd::StubGLBuffer stub_buffer;
+    NiceMock<mtd::MockScene> mock_scene;
+    MockDisplayBufferCompositorFactory mock_db_compositor_factory;
+    std::shared_ptr<mir::scene::Observer> observer;
+
+    EXPECT_CALL(mock_scene, add_observer(_))
+        .WillOnce(SaveArg<0>(&observer));
+    EXPECT_CALL(mock_db_compositor_factory.mock_db_compositor, composite_(_))
+        .Times(2);
+
+    mc::CompositingScreencast screencast{
+        mt::fake_shared(mock_scene),
+        mt::fake_shared(stub_display),
+        mt::fake_shared(stub_buffer_allocator),
+        mt::fake_shared(mock_db_compositor_factory)};
+
+    auto session_id = screencast.create_session(
+        default_region, default_size, default_pixel_format,
+        0, default_mirror_mode);
+
+    screencast.capture(session_id, mt::fake_shared(stub_buffer));
+    ASSERT_THAT(observer, NotNull());
+    observer->scene_changed();
+    screencast.capture(session_id, mt::fake_shared(stub_buffer));
+}
+
+TEST_F(CompositingScreencastTest, recomposites_while_frames_are_pending)
+{
+    using namespace testing;
+
+    mtd::StubGLBuffer stub_buffer;
+    NiceMock<mtd::MockScene> mock_scene;
+    MockDisplayBufferCompositorFactory mock_db_compositor_factory;
+
+    ON_CALL(mock_scene, frames_pending(_))
+        .WillByDefault(Return(1));
+    EXPECT_CALL(mock_db_compositor_factory.mock_db_compositor, composite_(_))
+        .Times(2);
+
+    mc::CompositingScreencast screencast{
+        mt::fake_shared(mock_scene),
+        mt::fake_shared(stub_display),
+        mt::fake_shared(stub_buffer_allocator),
+        mt::fake_shared(mock_db_compositor_factory)};
+
+    auto session_id = screencast.create_session(
+        default_region, default_size, default_pixel_format,
+        0, default_mirror_mode);
+
+    screencast.capture(session_id, mt::fake_shared(stub_buffer));
+    screencast.capture(session_id, mt::fake_shared(stub_buffer));
+}
+
 TEST_F(CompositingScreencastTest, allocates_and_uses_buffer_with_provided_size)
 {
     using namespace testing;
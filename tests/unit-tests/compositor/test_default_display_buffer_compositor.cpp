@@ -22,6 +22,9 @@
 #include "mir/compositor/scene.h"
 #include "mir/renderer/renderer.h"
 #include "mir/geometry/rectangle.h"
+#include "mir/geometry/rectangles.h"
+#include "mir/geometry/displacement.h"
+#include "mir/graphics/damage_source.h"
 #include "mir/test/doubles/mock_renderer.h"
 #include "mir/test/fake_shared.h"
 #include "mir/test/gmock_fixes.h"
@@ -388,3 +391,174 @@ TEST_F(DefaultDisplayBufferCompositor, marks_occluded_scene_elements)
     compositor.composite({element0_occluded, element1_rendered, element2_occluded});
 }
 
+
+TEST_F(DefaultDisplayBufferCompositor, first_frame_damages_whole_output)
+{
+    using namespace testing;
+
+    EXPECT_CALL(mock_renderer, set_damage(Eq(geom::Rectangles{screen})));
+
+    mc::DefaultDisplayBufferCompositor compositor(
+        display_buffer,
+        mt::fake_shared(mock_renderer),
+        mr::null_compositor_report());
+
+    compositor.composite(make_scene_elements({big, small}));
+}
+
+TEST_F(DefaultDisplayBufferCompositor, unchanged_scene_has_no_damage)
+{
+    using namespace testing;
+
+    Sequence seq;
+    EXPECT_CALL(mock_renderer, set_damage(Eq(geom::Rectangles{screen})))
+        .InSequence(seq);
+    EXPECT_CALL(mock_renderer, set_damage(Eq(geom::Rectangles{})))
+        .InSequence(seq);
+
+    mc::DefaultDisplayBufferCompositor compositor(
+        display_buffer,
+        mt::fake_shared(mock_renderer),
+        mr::null_compositor_report());
+
+    compositor.composite(make_scene_elements({big, small}));
+    compositor.composite(make_scene_elements({big, small}));
+}
+
+TEST_F(DefaultDisplayBufferCompositor, new_buffer_damages_only_its_renderable)
+{
+    using namespace testing;
+
+    Sequence seq;
+    EXPECT_CALL(mock_renderer, set_damage(Eq(geom::Rectangles{screen})))
+        .InSequence(seq);
+    EXPECT_CALL(mock_renderer, set_damage(Eq(geom::Rectangles{small->screen_position()})))
+        .InSequence(seq);
+
+    mc::DefaultDisplayBufferCompositor compositor(
+        display_buffer,
+        mt::fake_shared(mock_renderer),
+        mr::null_compositor_report());
+
+    compositor.composite(make_scene_elements({big, small}));
+    small->set_buffer(std::make_shared<mtd::StubBuffer>());
+    compositor.composite(make_scene_elements({big, small}));
+}
+
+namespace
+{
+struct StubDamagedBuffer : mtd::StubBuffer, mg::DamageSource
+{
+    StubDamagedBuffer(geom::Size const& size, mg::BufferID base, std::vector<geom::Rectangle> damage)
+        : StubBuffer{size}, base{base}, damage{damage}
+    {
+    }
+
+    std::vector<geom::Rectangle> const* damage_since(mg::BufferID previous) const override
+    {
+        return previous == base ? &damage : nullptr;
+    }
+
+    mg::BufferID const base;
+    std::vector<geom::Rectangle> const damage;
+};
+}
+
+TEST_F(DefaultDisplayBufferCompositor, buffer_damage_is_mapped_to_the_screen)
+{
+    using namespace testing;
+
+    auto const first_buffer = big->buffer();
+    geom::Rectangle const changed{{1, 2}, {3, 4}};
+    geom::Rectangle const changed_on_screen{
+        big->screen_position().top_left + geom::Displacement{1, 2}, {3, 4}};
+
+    Sequence seq;
+    EXPECT_CALL(mock_renderer, set_damage(Eq(geom::Rectangles{screen})))
+        .InSequence(seq);
+    EXPECT_CALL(mock_renderer, set_damage(Eq(geom::Rectangles{changed_on_screen})))
+        .InSequence(seq);
+    EXPECT_CALL(mock_renderer, set_damage(Eq(geom::Rectangles{big->screen_position()})))
+        .InSequence(seq);
+
+    mc::DefaultDisplayBufferCompositor compositor(
+        display_buffer,
+        mt::fake_shared(mock_renderer),
+        mr::null_compositor_report());
+
+    compositor.composite(make_scene_elements({big}));
+
+    big->set_buffer(std::make_shared<StubDamagedBuffer>(
+        big->screen_position().size, first_buffer->id(), std::vector<geom::Rectangle>{changed}));
+    compositor.composite(make_scene_elements({big}));
+
+    // Damage relative to a buffer we didn't show is no use
+    big->set_buffer(std::make_shared<StubDamagedBuffer>(
+        big->screen_position().size, first_buffer->id(), std::vector<geom::Rectangle>{changed}));
+    compositor.composite(make_scene_elements({big}));
+}
+
+TEST_F(DefaultDisplayBufferCompositor, removed_renderable_damages_where_it_was)
+{
+    using namespace testing;
+
+    Sequence seq;
+    EXPECT_CALL(mock_renderer, set_damage(Eq(geom::Rectangles{screen})))
+        .InSequence(seq);
+    EXPECT_CALL(mock_renderer, set_damage(Eq(geom::Rectangles{small->screen_position()})))
+        .InSequence(seq);
+
+    mc::DefaultDisplayBufferCompositor compositor(
+        display_buffer,
+        mt::fake_shared(mock_renderer),
+        mr::null_compositor_report());
+
+    compositor.composite(make_scene_elements({big, small}));
+    compositor.composite(make_scene_elements({big}));
+}
+
+TEST_F(DefaultDisplayBufferCompositor, restacking_damages_the_raised_renderable)
+{
+    using namespace testing;
+
+    auto const lower = std::make_shared<mtd::FakeRenderable>(geom::Rectangle{{0,0},{100,100}});
+    auto const upper = std::make_shared<mtd::FakeRenderable>(geom::Rectangle{{50,50},{100,100}});
+
+    Sequence seq;
+    EXPECT_CALL(mock_renderer, set_damage(Eq(geom::Rectangles{screen})))
+        .InSequence(seq);
+    EXPECT_CALL(mock_renderer, set_damage(Eq(geom::Rectangles{lower->screen_position()})))
+        .InSequence(seq);
+
+    mc::DefaultDisplayBufferCompositor compositor(
+        display_buffer,
+        mt::fake_shared(mock_renderer),
+        mr::null_compositor_report());
+
+    compositor.composite(make_scene_elements({lower, upper}));
+    compositor.composite(make_scene_elements({upper, lower}));
+}
+
+TEST_F(DefaultDisplayBufferCompositor, damages_whole_output_after_overlay)
+{
+    using namespace testing;
+
+    EXPECT_CALL(display_buffer, overlay(_))
+        .WillOnce(Return(false))
+        .WillOnce(Return(true))
+        .WillOnce(Return(false));
+
+    Sequence seq;
+    EXPECT_CALL(mock_renderer, set_damage(Eq(geom::Rectangles{screen})))
+        .Times(2)
+        .InSequence(seq);
+
+    mc::DefaultDisplayBufferCompositor compositor(
+        display_buffer,
+        mt::fake_shared(mock_renderer),
+        mr::null_compositor_report());
+
+    compositor.composite(make_scene_elements({big, small}));
+    compositor.composite(make_scene_elements({big, small}));
+    compositor.composite(make_scene_elements({big, small}));
+}
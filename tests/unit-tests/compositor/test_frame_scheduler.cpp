@@ -0,0 +1,146 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/compositor/frame_scheduler.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace mc = mir::compositor;
+namespace mt = mir::time;
+
+using namespace std::chrono;
+using namespace testing;
+
+namespace
+{
+/// A display refreshing at 60Hz, whose post() blocks until the next vblank
+struct SimulatedVsync
+{
+    mt::Timestamp vblank_after(mt::Timestamp t) const
+    {
+        auto const frames = (t - epoch + period - mt::Duration{1}) / period;
+        return epoch + frames * period;
+    }
+
+    mt::Timestamp const epoch{seconds{1000} + microseconds{1234}};
+    mt::Duration const period = duration_cast<mt::Duration>(microseconds{16667});
+};
+
+struct FrameScheduler : Test
+{
+    /// Composite a frame that's ready at 'now' and takes 'render' to draw
+    mt::Duration run_frame(mt::Duration render)
+    {
+        auto const started = scheduler.start_time(now);
+        auto const rendered = started + render;
+        auto const posted = vsync.vblank_after(rendered);
+
+        now = posted;
+        return scheduler.frame_posted(started, rendered, posted, true);
+    }
+
+    SimulatedVsync const vsync;
+    mt::Timestamp now{vsync.epoch + milliseconds{3}};
+    mc::FrameScheduler scheduler;
+};
+}
+
+TEST_F(FrameScheduler, starts_immediately_until_refresh_is_known)
+{
+    EXPECT_FALSE(scheduler.synchronised());
+    EXPECT_THAT(scheduler.start_time(now), Eq(now));
+}
+
+TEST_F(FrameScheduler, learns_refresh_period_from_posts)
+{
+    for (int i = 0; i != 10; ++i)
+        run_frame(milliseconds{1});
+
+    EXPECT_TRUE(scheduler.synchronised());
+}
+
+TEST_F(FrameScheduler, does_not_learn_from_posts_that_do_not_wait)
+{
+    for (int i = 0; i != 10; ++i)
+    {
+        auto const started = scheduler.start_time(now);
+        now = started + microseconds{500};
+        scheduler.frame_posted(started, now, now, true);
+    }
+
+    EXPECT_FALSE(scheduler.synchronised());
+    EXPECT_THAT(scheduler.start_time(now), Eq(now));
+}
+
+TEST_F(FrameScheduler, starts_frames_shortly_before_vblank)
+{
+    for (int i = 0; i != 10; ++i)
+        run_frame(milliseconds{1});
+
+    auto const start = scheduler.start_time(now);
+    auto const next_vblank = vsync.vblank_after(now + microseconds{1});
+
+    EXPECT_THAT(start, Gt(now + milliseconds{5}));
+    EXPECT_THAT(start, Lt(next_vblank - milliseconds{1}));
+}
+
+TEST_F(FrameScheduler, starts_earlier_for_slower_frames)
+{
+    for (int i = 0; i != 10; ++i)
+        run_frame(milliseconds{1});
+    auto const fast_start = scheduler.start_time(now) - now;
+
+    for (int i = 0; i != 10; ++i)
+        run_frame(milliseconds{8});
+    auto const slow_start = scheduler.start_time(now) - now;
+
+    EXPECT_THAT(slow_start, Lt(fast_start - milliseconds{6}));
+}
+
+TEST_F(FrameScheduler, paced_frames_make_every_vblank)
+{
+    for (int i = 0; i != 10; ++i)
+        run_frame(milliseconds{4});
+
+    for (int i = 0; i != 100; ++i)
+    {
+        auto const previous = now;
+        EXPECT_THAT(run_frame(milliseconds{4}), Eq(mt::Duration::zero()));
+        EXPECT_THAT(now, Eq(vsync.vblank_after(previous + microseconds{1})));
+    }
+}
+
+TEST_F(FrameScheduler, reports_frames_that_miss_their_vblank)
+{
+    for (int i = 0; i != 10; ++i)
+        run_frame(milliseconds{2});
+
+    auto const target = vsync.vblank_after(now + microseconds{1});
+    auto const lateness = run_frame(milliseconds{12});
+
+    EXPECT_THAT(now, Gt(target));
+    EXPECT_THAT(lateness, Eq(now - target));
+}
+
+TEST_F(FrameScheduler, starts_immediately_when_frames_take_most_of_a_period)
+{
+    for (int i = 0; i != 10; ++i)
+        run_frame(milliseconds{15});
+
+    EXPECT_TRUE(scheduler.synchronised());
+    EXPECT_THAT(scheduler.start_time(now), Eq(now));
+}
@@ -202,3 +202,55 @@ TEST_F(OcclusionFilterTest,
     EXPECT_THAT(renderables_from(occlusions), ElementsAre(partially_onscreen));
     EXPECT_THAT(renderables_from(elements), ElementsAre(covering));
 }
+
+TEST_F(OcclusionFilterTest, window_covered_by_several_windows_together_is_occluded)
+{
+    auto const bottom = std::make_shared<mtd::FakeRenderable>(10, 10, 100, 100);
+    auto const left = std::make_shared<mtd::FakeRenderable>(0, 0, 60, 200);
+    auto const right = std::make_shared<mtd::FakeRenderable>(60, 0, 60, 200);
+    auto elements = scene_elements_from({bottom, left, right});
+
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect);
+
+    EXPECT_THAT(renderables_from(occlusions), ElementsAre(bottom));
+    EXPECT_THAT(renderables_from(elements), ElementsAre(left, right));
+}
+
+TEST_F(OcclusionFilterTest, window_with_an_uncovered_gap_is_not_occluded)
+{
+    auto const bottom = std::make_shared<mtd::FakeRenderable>(10, 10, 100, 100);
+    auto const left = std::make_shared<mtd::FakeRenderable>(0, 0, 60, 200);
+    auto const right = std::make_shared<mtd::FakeRenderable>(61, 0, 60, 200);
+    auto elements = scene_elements_from({bottom, left, right});
+
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect);
+
+    EXPECT_THAT(renderables_from(occlusions), IsEmpty());
+    EXPECT_THAT(renderables_from(elements), ElementsAre(bottom, left, right));
+}
+
+TEST_F(OcclusionFilterTest, opaque_region_of_shaped_window_occludes)
+{
+    auto const bottom = std::make_shared<mtd::FakeRenderable>(20, 20, 10, 10);
+    auto const top = std::make_shared<mtd::FakeRenderable>(Rectangle{{0, 0}, {100, 100}}, 1.0f, false);
+    top->set_opaque_region(Rectangle{{10, 10}, {80, 80}});
+    auto elements = scene_elements_from({bottom, top});
+
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect);
+
+    EXPECT_THAT(renderables_from(occlusions), ElementsAre(bottom));
+    EXPECT_THAT(renderables_from(elements), ElementsAre(top));
+}
+
+TEST_F(OcclusionFilterTest, opaque_region_of_translucent_window_occludes_nothing)
+{
+    auto const bottom = std::make_shared<mtd::FakeRenderable>(20, 20, 10, 10);
+    auto const top = std::make_shared<mtd::FakeRenderable>(Rectangle{{0, 0}, {100, 100}}, 0.5f, false);
+    top->set_opaque_region(Rectangle{{10, 10}, {80, 80}});
+    auto elements = scene_elements_from({bottom, top});
+
+    auto const& occlusions = filter_occlusions_from(elements, monitor_rect);
+
+    EXPECT_THAT(renderables_from(occlusions), IsEmpty());
+    EXPECT_THAT(renderables_from(elements), ElementsAre(bottom, top));
+}
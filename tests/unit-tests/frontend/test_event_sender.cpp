@@ -23,6 +23,8 @@
 #include "src/server/frontend/event_sender.h"
 
 #include "mir/events/event_builders.h"
+#include "mir/events/event_private.h"
+#include "mir/cookie/authority.h"
 #include "mir/client_visible_error.h"
 
 #include "mir/test/display_config_matchers.h"
@@ -32,6 +34,7 @@
 #include "mir/test/doubles/stub_buffer.h"
 #include "mir/test/doubles/stub_input_device.h"
 #include "mir/test/doubles/mock_platform_ipc_operations.h"
+#include "mir/test/doubles/fake_alarm_factory.h"
 #include "mir/input/device.h"
 #include "mir/input/device_capability.h"
 #include "mir/input/mir_input_config.h"
@@ -112,14 +115,30 @@ struct MockMsgSender : public mf::MessageSender
 struct EventSender : public testing::Test
 {
     EventSender()
-        : event_sender(mt::fake_shared(mock_msg_sender), mt::fake_shared(mock_buffer_packer))
+        : event_sender(mt::fake_shared(mock_msg_sender), mt::fake_shared(mock_buffer_packer), cookie_authority)
     {
     }
     MockMsgSender mock_msg_sender;
     mtd::MockPlatformIpcOperations mock_buffer_packer;
+    std::shared_ptr<mir::cookie::Authority> const cookie_authority = mir::cookie::Authority::create();
     mfd::EventSender event_sender;
 };
 
+struct BatchingEventSender : EventSender
+{
+    mev::EventUPtr motion_event()
+    {
+        return mev::make_event(MirInputDeviceId(), std::chrono::nanoseconds(0), std::vector<uint8_t>{},
+                               mir_input_event_modifier_none, mir_pointer_action_motion, 0, 1, 1, 0, 0, 1, 1);
+    }
+
+    std::chrono::milliseconds const budget{8};
+    mtd::FakeAlarmFactory alarm_factory;
+    mfd::EventSender batching_sender{
+        mt::fake_shared(mock_msg_sender), mt::fake_shared(mock_buffer_packer), cookie_authority,
+        mt::fake_shared(alarm_factory), budget};
+};
+
 std::function<void(char const*, size_t, mir::frontend::FdSets)>
 make_validator(std::function<void(mir::protobuf::EventSequence const&)> const& sequence_validator)
 {
@@ -179,6 +198,31 @@ TEST_F(EventSender, sends_input_events)
     event_sender.handle_event(move(ev));
 }
 
+TEST_F(EventSender, signs_cookies_of_input_events_it_sends)
+{
+    using namespace testing;
+
+    auto const event_time = std::chrono::nanoseconds(1234);
+    auto ev = mev::make_event(MirInputDeviceId(), event_time, std::vector<uint8_t>{}, mir_keyboard_action_down,
+                              0, 0, MirInputEventModifiers());
+
+    std::vector<uint8_t> sent_cookie;
+    auto msg_validator = make_validator(
+        [&sent_cookie](auto const& seq)
+        {
+            ASSERT_THAT(seq.event_size(), Eq(1));
+            auto const sent = MirEvent::deserialize(seq.event(0).raw());
+            sent_cookie = sent->to_input()->cookie();
+        });
+
+    EXPECT_CALL(mock_msg_sender, send(_, _, _))
+        .WillOnce(Invoke(msg_validator));
+    event_sender.handle_event(move(ev));
+
+    ASSERT_THAT(sent_cookie, Not(IsEmpty()));
+    EXPECT_THAT(cookie_authority->make_cookie(sent_cookie)->timestamp(), Eq(uint64_t(event_time.count())));
+}
+
 TEST_F(EventSender, packs_buffer_with_platform_packer)
 {
     using namespace testing;
@@ -307,3 +351,40 @@ TEST_F(EventSender, sends_errors)
 
     event_sender.handle_error(error);
 }
+
+TEST_F(BatchingEventSender, holds_motion_back_until_the_budget_expires)
+{
+    using namespace testing;
+
+    std::vector<int> event_counts;
+    ON_CALL(mock_msg_sender, send(_, _, _))
+        .WillByDefault(Invoke(make_validator(
+            [&](mir::protobuf::EventSequence const& seq) { event_counts.push_back(seq.event_size()); })));
+
+    batching_sender.handle_event(motion_event());
+    batching_sender.handle_event(motion_event());
+    batching_sender.handle_event(motion_event());
+    EXPECT_THAT(event_counts, IsEmpty());
+
+    alarm_factory.advance_by(budget);
+    EXPECT_THAT(event_counts, ElementsAre(3));
+}
+
+TEST_F(BatchingEventSender, other_input_takes_held_back_motion_with_it)
+{
+    using namespace testing;
+
+    std::vector<int> event_counts;
+    ON_CALL(mock_msg_sender, send(_, _, _))
+        .WillByDefault(Invoke(make_validator(
+            [&](mir::protobuf::EventSequence const& seq) { event_counts.push_back(seq.event_size()); })));
+
+    batching_sender.handle_event(motion_event());
+    batching_sender.handle_event(motion_event());
+    batching_sender.handle_event(mev::make_event(MirInputDeviceId(), std::chrono::nanoseconds(0), std::vector<uint8_t>{},
+                                                 mir_keyboard_action_down, 0, 0, mir_input_event_modifier_none));
+    EXPECT_THAT(event_counts, ElementsAre(3));
+
+    alarm_factory.advance_by(budget);
+    EXPECT_THAT(event_counts, ElementsAre(3));
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/frontend/socket_messenger.h"
+#include "mir/fd.h"
+#include "mir/fd_socket_transmission.h"
+
+#include <boost/asio.hpp>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mf = mir::frontend;
+namespace mfd = mir::frontend::detail;
+namespace ba = boost::asio;
+
+using namespace testing;
+
+namespace
+{
+struct SocketMessenger : Test
+{
+    SocketMessenger()
+    {
+        int fds[2];
+        if (socketpair(AF_LOCAL, SOCK_STREAM, 0, fds))
+            throw std::runtime_error("Failed to create socket pair");
+
+        server_socket->assign(ba::local::stream_protocol(), fds[0]);
+        client_fd = fds[1];
+    }
+
+    ~SocketMessenger()
+    {
+        io_service.stop();
+        if (io_thread.joinable())
+            io_thread.join();
+        close(client_fd);
+    }
+
+    std::shared_ptr<mfd::SocketMessenger> make_messenger(size_t max_queued_bytes)
+    {
+        return std::make_shared<mfd::SocketMessenger>(server_socket, max_queued_bytes);
+    }
+
+    void start_sending_queued_messages()
+    {
+        io_thread = std::thread{[this] { io_service.run(); }};
+    }
+
+    // Reads messages until the server closes the connection or sends expected_messages
+    std::vector<std::string> client_reads(size_t expected_messages)
+    {
+        std::vector<std::string> messages;
+        while (messages.size() != expected_messages)
+        {
+            unsigned char header[2];
+            if (!read_exactly(header, sizeof header))
+                break;
+
+            std::string message(header[0] << 8 | header[1], '\0');
+            if (!read_exactly(&message[0], message.size()))
+                break;
+            messages.push_back(message);
+        }
+        return messages;
+    }
+
+    bool read_exactly(void* buffer, size_t length)
+    {
+        auto const bytes = static_cast<char*>(buffer);
+        for (size_t bytes_read = 0; bytes_read != length;)
+        {
+            auto const result = read(client_fd, bytes + bytes_read, length - bytes_read);
+            if (result <= 0)
+                return false;
+            bytes_read += result;
+        }
+        return true;
+    }
+
+    bool client_sees_end_of_stream()
+    {
+        char byte;
+        return read(client_fd, &byte, 1) == 0;
+    }
+
+    // Comfortably more than the socket will take while the client isn't reading
+    void send_backlog(mf::MessageSender& messenger, std::vector<std::string>& sent)
+    {
+        for (int i = 0; i != backlog_messages; ++i)
+        {
+            sent.push_back(std::to_string(i) + std::string(message_size, 'x'));
+            messenger.send(sent.back().data(), sent.back().size(), {});
+        }
+    }
+
+    static int const backlog_messages{512};
+    static size_t const message_size{1024};
+    static size_t const backlog_bytes{backlog_messages * (message_size + 8)};
+
+    ba::io_service io_service;
+    ba::io_service::work work{io_service};
+    std::shared_ptr<ba::local::stream_protocol::socket> const server_socket =
+        std::make_shared<ba::local::stream_protocol::socket>(io_service);
+    int client_fd;
+    std::thread io_thread;
+};
+}
+
+TEST_F(SocketMessenger, sending_to_a_client_that_is_not_reading_does_not_block)
+{
+    auto const messenger = make_messenger(mfd::SocketMessenger::default_max_queued_bytes);
+    std::vector<std::string> sent;
+
+    send_backlog(*messenger, sent);
+    start_sending_queued_messages();
+
+    EXPECT_THAT(client_reads(sent.size()), ContainerEq(sent));
+}
+
+TEST_F(SocketMessenger, queued_transient_message_is_superseded_by_one_with_the_same_key)
+{
+    auto const messenger = make_messenger(mfd::SocketMessenger::default_max_queued_bytes);
+    std::vector<std::string> sent;
+    std::string const superseded{"superseded"};
+    std::string const other_key{"other key"};
+    std::string const latest{"latest"};
+
+    send_backlog(*messenger, sent);
+    messenger->send_transient(superseded.data(), superseded.size(), 1);
+    messenger->send_transient(other_key.data(), other_key.size(), 2);
+    messenger->send_transient(latest.data(), latest.size(), 1);
+    sent.push_back(other_key);
+    sent.push_back(latest);
+    start_sending_queued_messages();
+
+    EXPECT_THAT(client_reads(sent.size()), ContainerEq(sent));
+}
+
+TEST_F(SocketMessenger, queued_message_keeps_fds_the_sender_has_since_closed)
+{
+    auto const messenger = make_messenger(mfd::SocketMessenger::default_max_queued_bytes);
+    std::vector<std::string> sent;
+    int pipe_fds[2];
+    ASSERT_THAT(pipe(pipe_fds), Eq(0));
+    mir::Fd const pipe_read{pipe_fds[0]};
+
+    send_backlog(*messenger, sent);
+    sent.push_back("with fds");
+    messenger->send(sent.back().data(), sent.back().size(), {{mir::Fd{mir::IntOwnedFd{pipe_fds[1]}}}});
+    close(pipe_fds[1]);
+    start_sending_queued_messages();
+
+    EXPECT_THAT(client_reads(sent.size()), ContainerEq(sent));
+
+    char byte;
+    std::vector<mir::Fd> received_fds(1);
+    mir::receive_data(mir::Fd{mir::IntOwnedFd{client_fd}}, &byte, 1, received_fds);
+    ASSERT_THAT(write(received_fds[0], "!", 1), Eq(1));
+    ASSERT_THAT(read(pipe_read, &byte, 1), Eq(1));
+    EXPECT_THAT(byte, Eq('!'));
+}
+
+TEST_F(SocketMessenger, overflowing_client_loses_transient_messages_first)
+{
+    auto const messenger = make_messenger(backlog_bytes);
+    std::vector<std::string> sent;
+    std::string const transient(message_size, 't');
+
+    for (int i = 0; i != backlog_messages / 4; ++i)
+        messenger->send_transient(transient.data(), transient.size(), 0);
+    send_backlog(*messenger, sent);
+    start_sending_queued_messages();
+
+    // Some transient messages made it into the socket before the queue formed
+    std::vector<std::string> received;
+    while (received.empty() || received.back() != sent.back())
+    {
+        auto const message = client_reads(1);
+        ASSERT_THAT(message.size(), Eq(1u));
+        received.push_back(message.front());
+    }
+
+    ASSERT_THAT(received.size(), Ge(sent.size()));
+    EXPECT_THAT(std::vector<std::string>(received.end() - sent.size(), received.end()), ContainerEq(sent));
+}
+
+TEST_F(SocketMessenger, client_overflowing_with_messages_it_needs_is_disconnected)
+{
+    auto const messenger = make_messenger(backlog_bytes / 4);
+    std::vector<std::string> sent;
+
+    send_backlog(*messenger, sent);
+    start_sending_queued_messages();
+
+    EXPECT_THAT(client_reads(sent.size()).size(), Lt(sent.size()));
+    EXPECT_TRUE(client_sees_end_of_stream());
+}
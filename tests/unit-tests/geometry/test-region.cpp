@@ -0,0 +1,136 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mir/geometry/region.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+using namespace mir::geometry;
+using namespace testing;
+
+TEST(Region, default_region_is_empty)
+{
+    Region const region;
+
+    EXPECT_TRUE(region.empty());
+    EXPECT_THAT(region.rectangles(), IsEmpty());
+    EXPECT_THAT(region.bounding_rectangle(), Eq(Rectangle{}));
+}
+
+TEST(Region, empty_rectangle_gives_empty_region)
+{
+    EXPECT_TRUE(Region(Rectangle{{5, 5}, {0, 10}}).empty());
+    EXPECT_TRUE(Region(Rectangle{{5, 5}, {10, 0}}).empty());
+}
+
+TEST(Region, rectangle_region_is_that_rectangle)
+{
+    Rectangle const rect{{1, 2}, {30, 40}};
+    Region const region{rect};
+
+    EXPECT_FALSE(region.empty());
+    EXPECT_THAT(region.rectangles(), ElementsAre(rect));
+    EXPECT_THAT(region.bounding_rectangle(), Eq(rect));
+}
+
+TEST(Region, union_of_overlapping_rectangles_is_banded)
+{
+    Region region{Rectangle{{0, 0}, {20, 20}}};
+    region.unite(Rectangle{{10, 10}, {20, 20}});
+
+    EXPECT_THAT(region.rectangles(), ElementsAre(
+        Rectangle{{0, 0}, {20, 10}},
+        Rectangle{{0, 10}, {30, 10}},
+        Rectangle{{10, 20}, {20, 10}}));
+    EXPECT_THAT(region.bounding_rectangle(), Eq(Rectangle{{0, 0}, {30, 30}}));
+}
+
+TEST(Region, union_of_adjacent_rectangles_coalesces)
+{
+    Region horizontal{Rectangle{{0, 0}, {10, 10}}};
+    horizontal.unite(Rectangle{{10, 0}, {10, 10}});
+    Region vertical{Rectangle{{0, 0}, {10, 10}}};
+    vertical.unite(Rectangle{{0, 10}, {10, 10}});
+
+    EXPECT_THAT(horizontal.rectangles(), ElementsAre(Rectangle{{0, 0}, {20, 10}}));
+    EXPECT_THAT(vertical.rectangles(), ElementsAre(Rectangle{{0, 0}, {10, 20}}));
+}
+
+TEST(Region, equal_regions_compare_equal_however_they_were_built)
+{
+    Region const a{std::vector<Rectangle>{{{0, 0}, {10, 20}}, {{10, 0}, {10, 20}}}};
+    Region const b{std::vector<Rectangle>{{{0, 10}, {20, 10}}, {{0, 0}, {20, 10}}}};
+
+    EXPECT_THAT(a, Eq(b));
+    EXPECT_THAT(a, Ne(Region{Rectangle{{0, 0}, {20, 21}}}));
+}
+
+TEST(Region, subtracting_leaves_a_hole)
+{
+    Region region{Rectangle{{0, 0}, {30, 30}}};
+    region.subtract(Rectangle{{10, 10}, {10, 10}});
+
+    EXPECT_THAT(region.rectangles(), ElementsAre(
+        Rectangle{{0, 0}, {30, 10}},
+        Rectangle{{0, 10}, {10, 10}},
+        Rectangle{{20, 10}, {10, 10}},
+        Rectangle{{0, 20}, {30, 10}}));
+    EXPECT_FALSE(region.contains(Rectangle{{5, 5}, {20, 20}}));
+    EXPECT_FALSE(region.overlaps(Rectangle{{12, 12}, {5, 5}}));
+    EXPECT_TRUE(region.overlaps(Rectangle{{5, 5}, {10, 10}}));
+}
+
+TEST(Region, subtracting_everything_leaves_nothing)
+{
+    Region region{Rectangle{{10, 10}, {10, 10}}};
+    region.subtract(Rectangle{{0, 0}, {30, 30}});
+
+    EXPECT_TRUE(region.empty());
+}
+
+TEST(Region, intersection_is_the_common_area)
+{
+    Region region{std::vector<Rectangle>{{{0, 0}, {10, 10}}, {{20, 0}, {10, 10}}}};
+    region.intersect(Rectangle{{5, 5}, {20, 20}});
+
+    EXPECT_THAT(region.rectangles(), ElementsAre(
+        Rectangle{{5, 5}, {5, 5}},
+        Rectangle{{20, 5}, {5, 5}}));
+}
+
+TEST(Region, contains_area_covered_by_several_rectangles)
+{
+    Region const region{std::vector<Rectangle>{
+        {{0, 0}, {20, 10}},
+        {{0, 10}, {10, 10}},
+        {{10, 10}, {10, 10}}}};
+
+    EXPECT_TRUE(region.contains(Rectangle{{0, 0}, {20, 20}}));
+    EXPECT_TRUE(region.contains(Rectangle{{5, 5}, {10, 10}}));
+    EXPECT_FALSE(region.contains(Rectangle{{5, 5}, {10, 20}}));
+    EXPECT_FALSE(region.contains(Rectangle{{-1, 0}, {10, 10}}));
+}
+
+TEST(Region, does_not_contain_area_spanning_a_gap_between_bands)
+{
+    Region const region{std::vector<Rectangle>{
+        {{0, 0}, {10, 10}},
+        {{0, 20}, {10, 10}}}};
+
+    EXPECT_FALSE(region.contains(Rectangle{{0, 0}, {10, 30}}));
+    EXPECT_FALSE(region.overlaps(Rectangle{{0, 10}, {10, 10}}));
+}
@@ -18,14 +18,18 @@
  */
 
 #include "src/gl/recently_used_cache.h"
+#include "mir/graphics/damage_source.h"
+#include "mir/renderer/gl/sub_texture_source.h"
 #include "mir/test/doubles/mock_gl_buffer.h"
 #include "mir/test/doubles/mock_renderable.h"
 #include "mir/test/doubles/mock_gl.h"
 #include <gtest/gtest.h>
+#include <gmock/gmock.h>
 
 namespace mtd=mir::test::doubles;
 namespace mgl=mir::gl;
 namespace mg=mir::graphics;
+namespace geom=mir::geometry;
 
 namespace
 {
@@ -140,3 +144,279 @@ TEST_F(RecentlyUsedCache, invalidated_buffers_are_reloaded)
     cache.invalidate();
     cache.load(*renderable);
 }
+
+namespace
+{
+struct MockShmBuffer : mtd::MockGLBuffer, mir::renderer::gl::SubTextureSource, mg::DamageSource
+{
+    using MockGLBuffer::MockGLBuffer;
+
+    MOCK_METHOD1(upload_areas, void(std::vector<geom::Rectangle> const&));
+    MOCK_CONST_METHOD1(damage_since, std::vector<geom::Rectangle> const*(mg::BufferID));
+};
+}
+
+TEST_F(RecentlyUsedCache, uploads_only_damaged_areas_of_a_same_sized_buffer)
+{
+    using namespace testing;
+    geom::Size const size{100, 100};
+    std::vector<geom::Rectangle> const damage{{{10, 20}, {30, 40}}};
+
+    auto first = std::make_shared<NiceMock<MockShmBuffer>>(size, geom::Stride{400}, mir_pixel_format_argb_8888);
+    auto second = std::make_shared<NiceMock<MockShmBuffer>>(size, geom::Stride{400}, mir_pixel_format_argb_8888);
+    ON_CALL(*first, id()).WillByDefault(Return(mg::BufferID(1)));
+    ON_CALL(*second, id()).WillByDefault(Return(mg::BufferID(2)));
+    ON_CALL(*second, damage_since(mg::BufferID(1))).WillByDefault(Return(&damage));
+
+    EXPECT_CALL(*first, bind());
+    EXPECT_CALL(*second, bind()).Times(0);
+    EXPECT_CALL(*second, upload_areas(damage));
+
+    mgl::RecentlyUsedCache cache;
+    ON_CALL(*renderable, buffer()).WillByDefault(Return(first));
+    cache.load(*renderable);
+    ON_CALL(*renderable, buffer()).WillByDefault(Return(second));
+    cache.load(*renderable);
+}
+
+TEST_F(RecentlyUsedCache, uploads_whole_buffer_into_existing_texture_without_damage_information)
+{
+    using namespace testing;
+    geom::Size const size{100, 100};
+
+    auto first = std::make_shared<NiceMock<MockShmBuffer>>(size, geom::Stride{400}, mir_pixel_format_argb_8888);
+    auto second = std::make_shared<NiceMock<MockShmBuffer>>(size, geom::Stride{400}, mir_pixel_format_argb_8888);
+    ON_CALL(*first, id()).WillByDefault(Return(mg::BufferID(1)));
+    ON_CALL(*second, id()).WillByDefault(Return(mg::BufferID(2)));
+    ON_CALL(*second, damage_since(_)).WillByDefault(Return(nullptr));
+
+    EXPECT_CALL(*second, bind()).Times(0);
+    EXPECT_CALL(*second, upload_areas(ElementsAre(geom::Rectangle{{0, 0}, size})));
+
+    mgl::RecentlyUsedCache cache;
+    ON_CALL(*renderable, buffer()).WillByDefault(Return(first));
+    cache.load(*renderable);
+    ON_CALL(*renderable, buffer()).WillByDefault(Return(second));
+    cache.load(*renderable);
+}
+
+TEST_F(RecentlyUsedCache, reallocates_texture_when_buffer_size_changes)
+{
+    using namespace testing;
+
+    auto first = std::make_shared<NiceMock<MockShmBuffer>>(
+        geom::Size{100, 100}, geom::Stride{400}, mir_pixel_format_argb_8888);
+    auto second = std::make_shared<NiceMock<MockShmBuffer>>(
+        geom::Size{200, 100}, geom::Stride{800}, mir_pixel_format_argb_8888);
+    ON_CALL(*first, id()).WillByDefault(Return(mg::BufferID(1)));
+    ON_CALL(*second, id()).WillByDefault(Return(mg::BufferID(2)));
+
+    EXPECT_CALL(*second, bind());
+    EXPECT_CALL(*second, upload_areas(_)).Times(0);
+
+    mgl::RecentlyUsedCache cache;
+    ON_CALL(*renderable, buffer()).WillByDefault(Return(first));
+    cache.load(*renderable);
+    ON_CALL(*renderable, buffer()).WillByDefault(Return(second));
+    cache.load(*renderable);
+}
+
+TEST_F(RecentlyUsedCache, does_not_upload_areas_into_a_texture_bound_to_a_client_buffer)
+{
+    using namespace testing;
+    geom::Size const size{100, 100};
+
+    auto first = std::make_shared<NiceMock<mtd::MockGLBuffer>>(size, geom::Stride{400}, mir_pixel_format_argb_8888);
+    auto second = std::make_shared<NiceMock<MockShmBuffer>>(size, geom::Stride{400}, mir_pixel_format_argb_8888);
+    ON_CALL(*first, id()).WillByDefault(Return(mg::BufferID(1)));
+    ON_CALL(*second, id()).WillByDefault(Return(mg::BufferID(2)));
+
+    EXPECT_CALL(*second, bind());
+    EXPECT_CALL(*second, upload_areas(_)).Times(0);
+
+    mgl::RecentlyUsedCache cache;
+    ON_CALL(*renderable, buffer()).WillByDefault(Return(first));
+    cache.load(*renderable);
+    ON_CALL(*renderable, buffer()).WillByDefault(Return(second));
+    cache.load(*renderable);
+}
+
+TEST_F(RecentlyUsedCache, invalidated_texture_is_fully_reuploaded)
+{
+    using namespace testing;
+
+    auto buffer = std::make_shared<NiceMock<MockShmBuffer>>(
+        geom::Size{100, 100}, geom::Stride{400}, mir_pixel_format_argb_8888);
+    ON_CALL(*buffer, id()).WillByDefault(Return(mg::BufferID(1)));
+    ON_CALL(*renderable, buffer()).WillByDefault(Return(buffer));
+
+    EXPECT_CALL(*buffer, bind()).Times(2);
+    EXPECT_CALL(*buffer, upload_areas(_)).Times(0);
+
+    mgl::RecentlyUsedCache cache;
+    cache.load(*renderable);
+    cache.invalidate();
+    cache.load(*renderable);
+}
+
+TEST_F(RecentlyUsedCache, reuses_the_texture_of_a_vanished_renderable_for_a_same_sized_one)
+{
+    using namespace testing;
+    geom::Size const size{100, 100};
+
+    auto first = std::make_shared<NiceMock<MockShmBuffer>>(size, geom::Stride{400}, mir_pixel_format_argb_8888);
+    auto second = std::make_shared<NiceMock<MockShmBuffer>>(size, geom::Stride{400}, mir_pixel_format_argb_8888);
+    ON_CALL(*first, id()).WillByDefault(Return(mg::BufferID(1)));
+    ON_CALL(*second, id()).WillByDefault(Return(mg::BufferID(2)));
+    auto const other_renderable = std::make_shared<NiceMock<mtd::MockRenderable>>();
+    ON_CALL(*renderable, buffer()).WillByDefault(Return(first));
+    ON_CALL(*other_renderable, buffer()).WillByDefault(Return(second));
+    ON_CALL(*other_renderable, id()).WillByDefault(Return(other_renderable.get()));
+
+    mgl::RecentlyUsedCache cache;
+    EXPECT_CALL(mock_gl, glGenTextures(1, _)).WillOnce(SetArgPointee<1>(stub_texture));
+    cache.load(*renderable);
+    cache.drop_unused();
+    Mock::VerifyAndClearExpectations(&mock_gl);
+
+    EXPECT_CALL(mock_gl, glGenTextures(_, _)).Times(0);
+    EXPECT_CALL(mock_gl, glDeleteTextures(_, _)).Times(0);
+    EXPECT_CALL(*second, bind()).Times(0);
+    EXPECT_CALL(*second, damage_since(_)).Times(0);
+    EXPECT_CALL(*second, upload_areas(ElementsAre(geom::Rectangle{{0, 0}, size})));
+
+    cache.drop_unused();
+    cache.load(*other_renderable);
+    cache.drop_unused();
+    Mock::VerifyAndClearExpectations(&mock_gl);
+}
+
+TEST_F(RecentlyUsedCache, does_not_reuse_the_texture_of_a_vanished_renderable_of_another_size)
+{
+    using namespace testing;
+
+    auto first = std::make_shared<NiceMock<MockShmBuffer>>(
+        geom::Size{100, 100}, geom::Stride{400}, mir_pixel_format_argb_8888);
+    auto second = std::make_shared<NiceMock<MockShmBuffer>>(
+        geom::Size{200, 100}, geom::Stride{800}, mir_pixel_format_argb_8888);
+    auto const other_renderable = std::make_shared<NiceMock<mtd::MockRenderable>>();
+    ON_CALL(*renderable, buffer()).WillByDefault(Return(first));
+    ON_CALL(*other_renderable, buffer()).WillByDefault(Return(second));
+    ON_CALL(*other_renderable, id()).WillByDefault(Return(other_renderable.get()));
+
+    EXPECT_CALL(mock_gl, glGenTextures(1, _)).Times(2);
+    EXPECT_CALL(*second, bind());
+    EXPECT_CALL(*second, upload_areas(_)).Times(0);
+
+    mgl::RecentlyUsedCache cache;
+    cache.load(*renderable);
+    cache.drop_unused();
+    cache.drop_unused();
+    cache.load(*other_renderable);
+}
+
+TEST_F(RecentlyUsedCache, does_not_reuse_the_texture_of_a_vanished_renderable_bound_to_a_client_buffer)
+{
+    using namespace testing;
+    geom::Size const size{100, 100};
+
+    auto first = std::make_shared<NiceMock<mtd::MockGLBuffer>>(size, geom::Stride{400}, mir_pixel_format_argb_8888);
+    auto second = std::make_shared<NiceMock<MockShmBuffer>>(size, geom::Stride{400}, mir_pixel_format_argb_8888);
+    ON_CALL(*first, id()).WillByDefault(Return(mg::BufferID(1)));
+    ON_CALL(*second, id()).WillByDefault(Return(mg::BufferID(2)));
+    auto const other_renderable = std::make_shared<NiceMock<mtd::MockRenderable>>();
+    ON_CALL(*renderable, buffer()).WillByDefault(Return(first));
+    ON_CALL(*other_renderable, buffer()).WillByDefault(Return(second));
+    ON_CALL(*other_renderable, id()).WillByDefault(Return(other_renderable.get()));
+
+    EXPECT_CALL(mock_gl, glGenTextures(1, _)).Times(2);
+    EXPECT_CALL(*second, bind());
+    EXPECT_CALL(*second, upload_areas(_)).Times(0);
+
+    mgl::RecentlyUsedCache cache;
+    cache.load(*renderable);
+    cache.drop_unused();
+    cache.drop_unused();
+    cache.load(*other_renderable);
+}
+
+TEST_F(RecentlyUsedCache, frees_textures_no_renderable_has_taken_up)
+{
+    using namespace testing;
+
+    mgl::RecentlyUsedCache cache;
+    EXPECT_CALL(mock_gl, glGenTextures(1, _)).WillOnce(SetArgPointee<1>(stub_texture));
+    cache.load(*renderable);
+    cache.drop_unused();
+    Mock::VerifyAndClearExpectations(&mock_gl);
+
+    EXPECT_CALL(mock_gl, glDeleteTextures(1, Pointee(stub_texture)));
+    cache.drop_unused();
+    cache.drop_unused();
+    Mock::VerifyAndClearExpectations(&mock_gl);
+}
+
+TEST_F(RecentlyUsedCache, keeps_the_texture_of_a_renderable_touched_but_not_loaded)
+{
+    using namespace testing;
+
+    mgl::RecentlyUsedCache cache;
+    EXPECT_CALL(mock_gl, glGenTextures(1, _)).WillOnce(SetArgPointee<1>(stub_texture));
+    EXPECT_CALL(*mock_buffer, gl_bind_to_texture());
+    cache.load(*renderable);
+    cache.drop_unused();
+    Mock::VerifyAndClearExpectations(&mock_gl);
+
+    EXPECT_CALL(mock_gl, glDeleteTextures(_, _)).Times(0);
+    EXPECT_CALL(mock_gl, glGenTextures(_, _)).Times(0);
+    cache.touch(*renderable);
+    cache.drop_unused();
+    cache.load(*renderable);
+    Mock::VerifyAndClearExpectations(&mock_gl);
+}
+
+TEST_F(RecentlyUsedCache, frees_the_texture_of_a_renderable_no_longer_touched)
+{
+    using namespace testing;
+
+    mgl::RecentlyUsedCache cache;
+    EXPECT_CALL(mock_gl, glGenTextures(1, _)).WillOnce(SetArgPointee<1>(stub_texture));
+    cache.load(*renderable);
+    cache.drop_unused();
+    cache.touch(*renderable);
+    cache.drop_unused();
+    Mock::VerifyAndClearExpectations(&mock_gl);
+
+    EXPECT_CALL(mock_gl, glDeleteTextures(1, Pointee(stub_texture)));
+    cache.drop_unused();
+    cache.drop_unused();
+    Mock::VerifyAndClearExpectations(&mock_gl);
+}
+
+TEST_F(RecentlyUsedCache, keeps_the_textures_of_many_renderables)
+{
+    using namespace testing;
+    int const renderable_count{200};
+
+    std::vector<std::shared_ptr<NiceMock<mtd::MockRenderable>>> renderables;
+    for (int i = 0; i != renderable_count; ++i)
+    {
+        renderables.push_back(std::make_shared<NiceMock<mtd::MockRenderable>>());
+        ON_CALL(*renderables.back(), buffer()).WillByDefault(Return(mock_buffer));
+        ON_CALL(*renderables.back(), id()).WillByDefault(Return(renderables.back().get()));
+    }
+
+    EXPECT_CALL(mock_gl, glGenTextures(1, _)).Times(renderable_count);
+    EXPECT_CALL(*mock_buffer, bind()).Times(renderable_count);
+
+    mgl::RecentlyUsedCache cache;
+    for (int frame = 0; frame != 3; ++frame)
+    {
+        // Every other renderable comes and goes, so the table is churned as well as filled
+        for (int i = 0; i != renderable_count; i += (frame == 1 ? 2 : 1))
+            cache.load(*renderables[i]);
+        if (frame == 1)
+            break;
+        cache.drop_unused();
+    }
+}
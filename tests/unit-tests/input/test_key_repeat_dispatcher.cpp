@@ -22,7 +22,6 @@
 #include "mir/events/event_builders.h"
 #include "mir/time/alarm.h"
 #include "mir/time/alarm_factory.h"
-#include "mir/cookie/authority.h"
 #include "mir/input/input_device_observer.h"
 #include "mir/input/mir_pointer_config.h"
 #include "mir/input/mir_touchpad_config.h"
@@ -34,6 +33,7 @@
 #include "mir/test/event_matchers.h"
 #include "mir/test/doubles/mock_input_dispatcher.h"
 #include "mir/test/doubles/mock_input_device_hub.h"
+#include "mir/test/doubles/advanceable_clock.h"
 
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
@@ -105,7 +105,7 @@ struct StubDevice : public mi::Device
 struct KeyRepeatDispatcher : public testing::Test
 {
     KeyRepeatDispatcher(bool on_arale = false)
-        : dispatcher(mock_next_dispatcher, mock_alarm_factory, cookie_authority, true, repeat_time, repeat_delay, on_arale)
+        : dispatcher(mock_next_dispatcher, mock_alarm_factory, mt::fake_shared(clock), true, repeat_time, repeat_delay, on_arale)
     {
         ON_CALL(hub,add_observer(_)).WillByDefault(SaveArg<0>(&observer));
         dispatcher.set_input_device_hub(mt::fake_shared(hub));
@@ -120,21 +120,22 @@ struct KeyRepeatDispatcher : public testing::Test
     const MirInputDeviceId test_device = 123;
     std::shared_ptr<mtd::MockInputDispatcher> mock_next_dispatcher = std::make_shared<mtd::MockInputDispatcher>();
     std::shared_ptr<MockAlarmFactory> mock_alarm_factory = std::make_shared<MockAlarmFactory>();
-    std::shared_ptr<mir::cookie::Authority> cookie_authority = mir::cookie::Authority::create();
-    std::chrono::milliseconds const repeat_time{2};
-    std::chrono::milliseconds const repeat_delay{1};
+    std::chrono::milliseconds const repeat_time{500};
+    std::chrono::milliseconds const repeat_delay{50};
+    mtd::AdvanceableClock clock;
+    mir::time::Timestamp const start{clock.now()};
     std::shared_ptr<mi::InputDeviceObserver> observer;
     NiceMock<mtd::MockInputDeviceHub> hub;
     mi::KeyRepeatDispatcher dispatcher;
 
-    mir::EventUPtr a_key_down_event()
+    mir::EventUPtr a_key_down_event(MirInputDeviceId device = 123, int scan_code = 0)
     {
-        return mev::make_event(test_device, std::chrono::nanoseconds(0), std::vector<uint8_t>{}, mir_keyboard_action_down, 0, 0, mir_input_event_modifier_alt);
+        return mev::make_event(device, std::chrono::nanoseconds(0), std::vector<uint8_t>{}, mir_keyboard_action_down, 0, scan_code, mir_input_event_modifier_alt);
     }
 
-    mir::EventUPtr a_key_up_event()
+    mir::EventUPtr a_key_up_event(MirInputDeviceId device = 123, int scan_code = 0)
     {
-        return mev::make_event(test_device, std::chrono::nanoseconds(0), std::vector<uint8_t>{}, mir_keyboard_action_up, 0, 0, mir_input_event_modifier_alt);
+        return mev::make_event(device, std::chrono::nanoseconds(0), std::vector<uint8_t>{}, mir_keyboard_action_up, 0, scan_code, mir_input_event_modifier_alt);
     }
 };
 
@@ -177,15 +178,16 @@ TEST_F(KeyRepeatDispatcher, schedules_alarm_to_repeat_key_down)
     EXPECT_CALL(*mock_alarm_factory, create_alarm_adapter(_)).Times(1).
         WillOnce(DoAll(SaveArg<0>(&alarm_function), Return(mock_alarm)));
     // Once for initial down and again when invoked
-    EXPECT_CALL(*mock_alarm, reschedule_in(repeat_time)).Times(1).WillOnce(Return(true));
+    EXPECT_CALL(*mock_alarm, reschedule_for(start + repeat_time)).Times(1).WillOnce(Return(false));
     EXPECT_CALL(*mock_next_dispatcher, dispatch(mt::KeyDownEvent())).Times(1);
+    EXPECT_CALL(*mock_alarm, reschedule_for(start + repeat_time + repeat_delay)).Times(1).WillOnce(Return(false));
     EXPECT_CALL(*mock_next_dispatcher, dispatch(mt::KeyRepeatEvent())).Times(1);
-    EXPECT_CALL(*mock_alarm, reschedule_in(repeat_delay)).Times(1).WillOnce(Return(true));
     EXPECT_CALL(*mock_next_dispatcher, dispatch(mt::KeyUpEvent())).Times(1);
 
     // Schedule the repeat
     dispatcher.dispatch(a_key_down_event());
     // Trigger the repeat
+    clock.advance_by(repeat_time);
     alarm_function();
     // Trigger the cancel
     dispatcher.dispatch(a_key_up_event());
@@ -193,27 +195,63 @@ TEST_F(KeyRepeatDispatcher, schedules_alarm_to_repeat_key_down)
 
 TEST_F(KeyRepeatDispatcher, stops_repeat_on_device_removal)
 {
-    MockAlarm *mock_alarm = new MockAlarm;
+    MockAlarm *mock_alarm = new NiceMock<MockAlarm>;
     std::function<void()> alarm_function;
-    bool alarm_canceled = false;
 
-    InSequence seq;
     EXPECT_CALL(*mock_alarm_factory, create_alarm_adapter(_)).Times(1).
         WillOnce(DoAll(SaveArg<0>(&alarm_function), Return(mock_alarm)));
-    // Once for initial down and again when invoked
-    EXPECT_CALL(*mock_alarm, reschedule_in(repeat_time)).Times(1).WillOnce(Return(true));
     EXPECT_CALL(*mock_next_dispatcher, dispatch(mt::KeyDownEvent())).Times(1);
     EXPECT_CALL(*mock_next_dispatcher, dispatch(mt::KeyRepeatEvent())).Times(1);
-    EXPECT_CALL(*mock_alarm, reschedule_in(repeat_delay)).Times(1).WillOnce(Return(true));
-    ON_CALL(*mock_alarm, cancel()).WillByDefault(Invoke([&](){alarm_canceled = true; return true;}));
 
     dispatcher.dispatch(a_key_down_event());
 
+    clock.advance_by(repeat_time);
     alarm_function();
-    Mock::VerifyAndClearExpectations(mock_alarm); // mock_alarm will be deleted after this
 
     simulate_device_removal();
-    EXPECT_THAT(alarm_canceled, Eq(true));
+    clock.advance_by(repeat_delay);
+    alarm_function();
+}
+
+TEST_F(KeyRepeatDispatcher, one_alarm_repeats_keys_held_on_all_devices)
+{
+    MirInputDeviceId const other_device{124};
+    MockAlarm *mock_alarm = new NiceMock<MockAlarm>;
+    std::function<void()> alarm_function;
+
+    EXPECT_CALL(*mock_alarm_factory, create_alarm_adapter(_)).Times(1).
+        WillOnce(DoAll(SaveArg<0>(&alarm_function), Return(mock_alarm)));
+    EXPECT_CALL(*mock_next_dispatcher, dispatch(mt::KeyDownEvent())).Times(3);
+    EXPECT_CALL(*mock_next_dispatcher, dispatch(mt::KeyRepeatEvent())).Times(3);
+
+    dispatcher.dispatch(a_key_down_event(test_device, 1));
+    dispatcher.dispatch(a_key_down_event(test_device, 2));
+    dispatcher.dispatch(a_key_down_event(other_device, 1));
+
+    // All three fall due in the same tick and go out together
+    clock.advance_by(repeat_time);
+    alarm_function();
+}
+
+TEST_F(KeyRepeatDispatcher, late_alarm_keeps_the_repeat_cadence)
+{
+    MockAlarm *mock_alarm = new NiceMock<MockAlarm>;
+    std::function<void()> alarm_function;
+
+    EXPECT_CALL(*mock_alarm_factory, create_alarm_adapter(_)).Times(1).
+        WillOnce(DoAll(SaveArg<0>(&alarm_function), Return(mock_alarm)));
+    EXPECT_CALL(*mock_next_dispatcher, dispatch(mt::KeyDownEvent())).Times(1);
+
+    dispatcher.dispatch(a_key_down_event());
+    Mock::VerifyAndClearExpectations(mock_alarm);
+
+    // A busy main loop gets round to the alarm most of three repeats late:
+    // one repeat is sent, not a burst, and the next is on the original beat
+    EXPECT_CALL(*mock_next_dispatcher, dispatch(mt::KeyRepeatEvent())).Times(1);
+    EXPECT_CALL(*mock_alarm, reschedule_for(start + repeat_time + 3 * repeat_delay)).Times(1);
+
+    clock.advance_by(repeat_time + 2 * repeat_delay + repeat_delay / 2);
+    alarm_function();
 }
 
 TEST_F(KeyRepeatDispatcherOnArale, no_repeat_alarm_on_mtk_tpd)
@@ -234,12 +272,13 @@ TEST_F(KeyRepeatDispatcherOnArale, repeat_for_regular_keys)
     EXPECT_CALL(*mock_alarm_factory, create_alarm_adapter(_)).Times(1).
         WillOnce(DoAll(SaveArg<0>(&alarm_function), Return(mock_alarm)));
     // Once for initial down and again when invoked
-    EXPECT_CALL(*mock_alarm, reschedule_in(repeat_delay)).Times(1).WillOnce(Return(true));
-    EXPECT_CALL(*mock_alarm, reschedule_in(repeat_time)).Times(1).WillOnce(Return(true));
+    EXPECT_CALL(*mock_alarm, reschedule_for(start + repeat_time + repeat_delay)).Times(1).WillOnce(Return(false));
+    EXPECT_CALL(*mock_alarm, reschedule_for(start + repeat_time)).Times(1).WillOnce(Return(false));
     EXPECT_CALL(*mock_next_dispatcher, dispatch(mt::KeyDownEvent())).Times(1);
     EXPECT_CALL(*mock_next_dispatcher, dispatch(mt::KeyRepeatEvent())).Times(1);
 
     add_mtk_tpd();
     dispatcher.dispatch(a_key_down_event());
+    clock.advance_by(repeat_time);
     alarm_function();
 }
@@ -0,0 +1,157 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/input/surface_spatial_index.h"
+#include "mir/input/surface.h"
+#include "mir/geometry/rectangles.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace mi = mir::input;
+namespace geom = mir::geometry;
+
+using namespace testing;
+
+namespace
+{
+struct StubSurface : mi::Surface
+{
+    StubSurface(geom::Rectangle const& bounds) : bounds{bounds} {}
+
+    std::string name() const override { return {}; }
+    geom::Rectangle input_bounds() const override { return bounds; }
+    bool input_area_contains(geom::Point const& point) const override
+    {
+        return accepts_input && (bounds.contains(point) || (outlier && outlier->contains(point)));
+    }
+    geom::Rectangle input_area_bounds() const override
+    {
+        geom::Rectangles area{bounds};
+        if (outlier)
+            area.add(*outlier);
+        return area.bounding_rectangle();
+    }
+    std::shared_ptr<mir::graphics::CursorImage> cursor_image() const override { return {}; }
+    mi::InputReceptionMode reception_mode() const override { return mi::InputReceptionMode::normal; }
+    void consume(MirEvent const*) override {}
+
+    geom::Rectangle bounds;
+    bool accepts_input = true;
+    /// Input area outside the surface bounds (as a subsurface's may be)
+    std::unique_ptr<geom::Rectangle> outlier;
+};
+
+struct SurfaceSpatialIndex : Test
+{
+    std::shared_ptr<StubSurface> add(geom::Rectangle const& bounds)
+    {
+        auto const surface = std::make_shared<StubSurface>(bounds);
+        stack.push_back(surface);
+        index.restack(stack);
+        return surface;
+    }
+
+    std::vector<std::shared_ptr<mi::Surface>> stack;
+    mi::SurfaceSpatialIndex index;
+};
+}
+
+TEST_F(SurfaceSpatialIndex, finds_nothing_in_empty_space)
+{
+    add({{0, 0}, {100, 100}});
+
+    EXPECT_THAT(index.surface_at({150, 50}), IsNull());
+    EXPECT_THAT(index.surface_at({-1, 50}), IsNull());
+}
+
+TEST_F(SurfaceSpatialIndex, finds_topmost_surface)
+{
+    auto const bottom = add({{0, 0}, {1000, 1000}});
+    auto const top = add({{500, 500}, {100, 100}});
+
+    EXPECT_THAT(index.surface_at({550, 550}), Eq(top));
+    EXPECT_THAT(index.surface_at({450, 450}), Eq(bottom));
+}
+
+TEST_F(SurfaceSpatialIndex, follows_stacking_order)
+{
+    auto const first = add({{0, 0}, {100, 100}});
+    add({{0, 0}, {100, 100}});
+
+    std::swap(stack[0], stack[1]);
+    index.restack(stack);
+
+    EXPECT_THAT(index.surface_at({50, 50}), Eq(first));
+}
+
+TEST_F(SurfaceSpatialIndex, falls_through_surfaces_not_accepting_input)
+{
+    auto const bottom = add({{0, 0}, {100, 100}});
+    auto const top = add({{0, 0}, {100, 100}});
+    top->accepts_input = false;
+
+    EXPECT_THAT(index.surface_at({50, 50}), Eq(bottom));
+}
+
+TEST_F(SurfaceSpatialIndex, follows_surfaces_that_move)
+{
+    auto const surface = add({{0, 0}, {100, 100}});
+
+    surface->bounds = {{2000, 2000}, {100, 100}};
+    index.update(surface.get());
+
+    EXPECT_THAT(index.surface_at({50, 50}), IsNull());
+    EXPECT_THAT(index.surface_at({2050, 2050}), Eq(surface));
+}
+
+TEST_F(SurfaceSpatialIndex, forgets_removed_surfaces)
+{
+    auto const bottom = add({{0, 0}, {100, 100}});
+    auto const top = add({{0, 0}, {100, 100}});
+
+    index.remove(top.get());
+
+    EXPECT_THAT(index.surface_at({50, 50}), Eq(bottom));
+}
+
+TEST_F(SurfaceSpatialIndex, finds_surfaces_at_negative_coordinates)
+{
+    auto const surface = add({{-300, -300}, {100, 100}});
+
+    EXPECT_THAT(index.surface_at({-250, -250}), Eq(surface));
+    EXPECT_THAT(index.surface_at({-150, -150}), IsNull());
+}
+
+TEST_F(SurfaceSpatialIndex, finds_huge_surfaces)
+{
+    auto const huge = add({{-100000, -100000}, {200000, 200000}});
+    auto const small = add({{10, 10}, {10, 10}});
+
+    EXPECT_THAT(index.surface_at({15, 15}), Eq(small));
+    EXPECT_THAT(index.surface_at({50000, -50000}), Eq(huge));
+}
+
+TEST_F(SurfaceSpatialIndex, finds_surfaces_by_input_area_outside_their_bounds)
+{
+    auto const surface = add({{0, 0}, {100, 100}});
+
+    surface->outlier = std::make_unique<geom::Rectangle>(geom::Rectangle{{1000, 1000}, {100, 100}});
+    index.update(surface.get());
+
+    EXPECT_THAT(index.surface_at({1050, 1050}), Eq(surface));
+    EXPECT_THAT(index.surface_at({500, 500}), IsNull());
+}
@@ -32,7 +32,6 @@
 #include "mir/test/doubles/mock_input_device_registry.h"
 #include "mir/test/doubles/mock_x11.h"
 #include "mir/test/fake_shared.h"
-#include "mir/cookie/authority.h"
 #include "mir/test/event_matchers.h"
 
 namespace md = mir::dispatch;
@@ -52,7 +51,7 @@ struct X11PlatformTest : ::testing::Test
     NiceMock<mtd::MockInputSeat> mock_seat;
     NiceMock<mtd::MockX11> mock_x11;
     NiceMock<mtd::MockInputDeviceRegistry> mock_registry;
-    mir::input::DefaultEventBuilder builder{0, mir::cookie::Authority::create(), mt::fake_shared(mock_seat)};
+    mir::input::DefaultEventBuilder builder{0, mt::fake_shared(mock_seat)};
 
     mir::input::X::XInputPlatform x11_platform{
         mt::fake_shared(mock_registry),
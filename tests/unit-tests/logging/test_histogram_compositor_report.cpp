@@ -0,0 +1,196 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/report/histogram/compositor_report.h"
+#include "src/server/report/histogram/histogram.h"
+#include "mir/logging/logger.h"
+#include "mir/test/doubles/advanceable_clock.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace mtd = mir::test::doubles;
+namespace mrh = mir::report::histogram;
+namespace ml = mir::logging;
+
+using namespace testing;
+using namespace std::chrono;
+
+namespace
+{
+struct Recorder : ml::Logger
+{
+    void log(ml::Severity, std::string const& message, std::string const&) override
+    {
+        messages.push_back(message);
+    }
+
+    std::vector<std::string> messages;
+};
+
+struct HistogramCompositorReport : Test
+{
+    void composite_frame(void const* id, microseconds render_time, microseconds post_time)
+    {
+        report.began_frame(id);
+        clock->advance_by(render_time);
+        report.rendered_frame(id);
+        report.finished_frame(id);
+        clock->advance_by(post_time);
+        report.posted_frame(id);
+    }
+
+    std::shared_ptr<mtd::AdvanceableClock> const clock = std::make_shared<mtd::AdvanceableClock>();
+    std::shared_ptr<Recorder> const recorder = std::make_shared<Recorder>();
+    mrh::CompositorReport report{recorder, clock};
+    void const* const display_id = "display";
+};
+}
+
+TEST(Histogram, small_values_are_exact)
+{
+    mrh::Histogram histogram;
+
+    for (int i = 1; i <= 10; ++i)
+        histogram.record(microseconds(i));
+
+    EXPECT_THAT(histogram.count(), Eq(10u));
+    EXPECT_THAT(histogram.percentile(0.5), Eq(microseconds(5)));
+    EXPECT_THAT(histogram.percentile(1.0), Eq(microseconds(10)));
+}
+
+TEST(Histogram, large_values_are_within_a_sixteenth)
+{
+    mrh::Histogram histogram;
+
+    histogram.record(microseconds(16667));
+
+    auto const recorded = histogram.percentile(0.5);
+    EXPECT_THAT(recorded.count(), Ge(16667));
+    EXPECT_THAT(recorded.count(), Le(16667 + 16667 / 16));
+}
+
+TEST(Histogram, tail_percentiles_see_the_outliers)
+{
+    mrh::Histogram histogram;
+
+    for (int i = 0; i != 990; ++i)
+        histogram.record(microseconds(1000));
+    for (int i = 0; i != 10; ++i)
+        histogram.record(microseconds(50000));
+
+    EXPECT_THAT(histogram.percentile(0.5).count(), Lt(1100));
+    EXPECT_THAT(histogram.percentile(0.99).count(), Lt(1100));
+    EXPECT_THAT(histogram.percentile(0.999).count(), Ge(50000));
+}
+
+TEST(Histogram, empty_and_reset_histograms_have_no_percentiles)
+{
+    mrh::Histogram histogram;
+    EXPECT_THAT(histogram.percentile(0.99), Eq(microseconds::zero()));
+
+    histogram.record(microseconds(1234));
+    histogram.reset();
+
+    EXPECT_THAT(histogram.count(), Eq(0u));
+    EXPECT_THAT(histogram.percentile(0.99), Eq(microseconds::zero()));
+}
+
+TEST_F(HistogramCompositorReport, logs_nothing_until_dumped)
+{
+    for (int i = 0; i != 10; ++i)
+        composite_frame(display_id, milliseconds(4), milliseconds(12));
+
+    EXPECT_THAT(recorder->messages, IsEmpty());
+}
+
+TEST_F(HistogramCompositorReport, dumps_percentiles_of_each_timing)
+{
+    report.added_display(1920, 1080, 0, 0, display_id);
+    for (int i = 0; i != 100; ++i)
+    {
+        report.scheduled();
+        clock->advance_by(microseconds(500));
+        composite_frame(display_id, milliseconds(4), milliseconds(12));
+    }
+
+    report.dump();
+
+    EXPECT_THAT(recorder->messages, ElementsAre(
+        HasSubstr("100 frames, 0% bypassed, 0 missed vblanks"),
+        AllOf(HasSubstr("schedule-to-start latency"), HasSubstr("p50 0.5")),
+        AllOf(HasSubstr("render time"), HasSubstr("p50 4.")),
+        AllOf(HasSubstr("post time"), HasSubstr("p99.9 12."))));
+}
+
+TEST_F(HistogramCompositorReport, counts_bypassed_frames_and_missed_vblanks)
+{
+    for (int i = 0; i != 4; ++i)
+    {
+        report.began_frame(display_id);
+        if (i % 2)
+            report.rendered_frame(display_id);
+        report.finished_frame(display_id);
+        report.posted_frame(display_id);
+    }
+    report.missed_deadline(display_id, milliseconds(3));
+
+    report.dump();
+
+    ASSERT_THAT(recorder->messages, Not(IsEmpty()));
+    EXPECT_THAT(recorder->messages.front(), HasSubstr("4 frames, 50% bypassed, 1 missed vblanks"));
+}
+
+TEST_F(HistogramCompositorReport, only_the_first_frame_after_scheduling_waits_on_it)
+{
+    report.scheduled();
+    clock->advance_by(milliseconds(2));
+    for (int i = 0; i != 3; ++i)
+        composite_frame(display_id, milliseconds(1), milliseconds(1));
+
+    report.dump();
+
+    EXPECT_THAT(recorder->messages, Contains(HasSubstr("latency: p50 2.")));
+}
+
+TEST_F(HistogramCompositorReport, reports_each_display_separately)
+{
+    void const* const other_display_id = "other display";
+
+    composite_frame(display_id, milliseconds(1), milliseconds(1));
+    composite_frame(other_display_id, milliseconds(1), milliseconds(1));
+    composite_frame(other_display_id, milliseconds(1), milliseconds(1));
+
+    report.dump();
+
+    EXPECT_THAT(recorder->messages, Contains(HasSubstr(" 1 frames")));
+    EXPECT_THAT(recorder->messages, Contains(HasSubstr(" 2 frames")));
+}
+
+TEST_F(HistogramCompositorReport, stopping_dumps_and_forgets_displays)
+{
+    composite_frame(display_id, milliseconds(1), milliseconds(1));
+
+    report.stopped();
+    EXPECT_THAT(recorder->messages, Not(IsEmpty()));
+
+    recorder->messages.clear();
+    report.dump();
+    EXPECT_THAT(recorder->messages, IsEmpty());
+}
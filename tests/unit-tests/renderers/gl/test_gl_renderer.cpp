@@ -289,6 +289,24 @@ TEST_F(GLRenderer, swaps_buffers_after_rendering)
     renderer.render(renderable_list);
 }
 
+TEST_F(GLRenderer, streams_frame_vertices_through_one_buffer)
+{
+    GLuint const vertex_buffer{7};
+    ON_CALL(mock_gl, glGenBuffers(1, _))
+        .WillByDefault(SetArgPointee<1>(vertex_buffer));
+
+    mrg::Renderer renderer(display_buffer);
+
+    InSequence seq;
+    EXPECT_CALL(mock_gl, glBufferData(GL_ARRAY_BUFFER,
+                                      static_cast<GLsizeiptr>(4 * sizeof(mir::gl::Vertex)),
+                                      _, GL_STREAM_DRAW));
+    EXPECT_CALL(mock_gl, glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+    EXPECT_CALL(mock_gl, glDeleteBuffers(1, Pointee(vertex_buffer)));
+
+    renderer.render(renderable_list);
+}
+
 TEST_F(GLRenderer, unchanged_viewport_avoids_gl_calls)
 {
     int const screen_width = 1920;
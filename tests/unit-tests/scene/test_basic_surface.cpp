@@ -24,6 +24,7 @@
 #include "mir/frontend/event_sink.h"
 #include "mir/geometry/rectangle.h"
 #include "mir/geometry/displacement.h"
+#include "mir/geometry/region.h"
 #include "mir/scene/null_surface_observer.h"
 #include "mir/events/event_builders.h"
 
@@ -68,6 +69,7 @@ public:
     MOCK_METHOD1(client_surface_close_requested, void(ms::Surface const*));
     MOCK_METHOD2(cursor_image_set_to, void(ms::Surface const*, mir::graphics::CursorImage const& image));
     MOCK_METHOD1(cursor_image_removed, void(ms::Surface const*));
+    MOCK_METHOD2(input_region_set_to, void(ms::Surface const*, std::vector<geom::Rectangle> const&));
 };
 
 struct BasicSurfaceTest : public testing::Test
@@ -446,6 +448,31 @@ TEST_F(BasicSurfaceTest, disables_input_when_setting_input_region_with_empty_rec
     EXPECT_FALSE(surface.input_area_contains(rect.top_left));
 }
 
+TEST_F(BasicSurfaceTest, input_region_may_extend_beyond_surface)
+{
+    using namespace testing;
+
+    geom::Rectangle const outside{{rect.size.width.as_int(), 0}, {10, 10}};
+    surface.set_input_region({outside});
+
+    EXPECT_TRUE(surface.input_area_contains(rect.top_left + (outside.top_left - geom::Point{})));
+    EXPECT_THAT(surface.input_area_bounds(),
+        Eq(geom::Rectangle{rect.top_left + (outside.top_left - geom::Point{}), outside.size}));
+}
+
+TEST_F(BasicSurfaceTest, notifies_observers_of_input_region)
+{
+    using namespace testing;
+
+    std::vector<geom::Rectangle> const region{{{0, 0}, {10, 10}}};
+    auto const observer = std::make_shared<NiceMock<MockSurfaceObserver>>();
+    surface.add_observer(observer);
+
+    EXPECT_CALL(*observer, input_region_set_to(&surface, region));
+
+    surface.set_input_region(region);
+}
+
 TEST_F(BasicSurfaceTest, reception_mode_is_normal_by_default)
 {
     EXPECT_EQ(mi::InputReceptionMode::normal, surface.reception_mode());
@@ -866,6 +893,27 @@ TEST_F(BasicSurfaceTest, moving_surface_repositions_all_associated_streams)
     EXPECT_THAT(renderables[1], IsRenderableOfPosition(pt + d));
 }
 
+TEST_F(BasicSurfaceTest, renderables_report_stream_opaque_region_on_screen)
+{
+    using namespace testing;
+    geom::Displacement const d{1, 2};
+    auto buffer_stream = std::make_shared<NiceMock<mtd::MockBufferStream>>();
+
+    std::list<ms::StreamInfo> streams = {
+        { buffer_stream, d, geom::Size{20, 20}, {{{2, 3}, {5, 5}}, {{15, 15}, {10, 10}}} }
+    };
+
+    surface.set_streams(streams);
+    auto renderables = surface.generate_renderables(this);
+    ASSERT_THAT(renderables.size(), Eq(1));
+
+    auto const origin = rect.top_left + d;
+    geom::Region expected{std::vector<geom::Rectangle>{
+        {origin + geom::Displacement{2, 3}, {5, 5}},
+        {origin + geom::Displacement{15, 15}, {5, 5}}}};   // clipped to the stream
+    EXPECT_THAT(renderables[0]->opaque_region(), Eq(expected));
+}
+
 TEST_F(BasicSurfaceTest, can_remove_all_streams)
 {
     using namespace testing;
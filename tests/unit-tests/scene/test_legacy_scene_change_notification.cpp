@@ -21,6 +21,7 @@
 
 #include "mir/test/fake_shared.h"
 #include "mir/test/doubles/mock_surface.h"
+#include "mir/test/doubles/mock_buffer_stream.h"
 
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
@@ -39,6 +40,10 @@ struct MockBufferCallback
 {
     MOCK_METHOD1(invoke, void(int));
 };
+struct MockDamageCallback
+{
+    MOCK_METHOD2(invoke, void(int, mir::geometry::Rectangle const&));
+};
 
 struct LegacySceneChangeNotificationTest : public testing::Test
 {
@@ -48,7 +53,10 @@ struct LegacySceneChangeNotificationTest : public testing::Test
     }
     testing::NiceMock<MockSceneCallback> scene_callback;
     testing::NiceMock<MockBufferCallback> buffer_callback;
+    testing::NiceMock<MockDamageCallback> damage_callback;
     std::function<void(int)> buffer_change_callback{[this](int arg){buffer_callback.invoke(arg);}};
+    std::function<void(int, mir::geometry::Rectangle const&)> damage_change_callback{
+        [this](int frames, mir::geometry::Rectangle const& damage){damage_callback.invoke(frames, damage);}};
     std::function<void()> scene_change_callback{[this](){scene_callback.invoke();}};
     testing::NiceMock<mtd::MockSurface> surface;
 }; 
@@ -114,6 +122,68 @@ TEST_F(LegacySceneChangeNotificationTest, redraws_on_rename)
     surface_observer->renamed(&surface, "Something New");
 }
 
+TEST_F(LegacySceneChangeNotificationTest, moving_a_surface_damages_only_where_it_was_and_is)
+{
+    using namespace ::testing;
+    namespace geom = mir::geometry;
+
+    std::shared_ptr<ms::SurfaceObserver> surface_observer;
+    ON_CALL(surface, size()).WillByDefault(Return(geom::Size{100, 50}));
+    EXPECT_CALL(surface, add_observer(_)).Times(1)
+        .WillOnce(SaveArg<0>(&surface_observer));
+
+    EXPECT_CALL(scene_callback, invoke()).Times(0);
+    EXPECT_CALL(damage_callback, invoke(1, geom::Rectangle{{0, 0}, {100, 50}}));
+    EXPECT_CALL(damage_callback, invoke(1, geom::Rectangle{{500, 10}, {100, 50}})).Times(2);
+    EXPECT_CALL(damage_callback, invoke(1, geom::Rectangle{{500, 10}, {200, 50}}));
+
+    ms::LegacySceneChangeNotification observer(scene_change_callback, damage_change_callback);
+    observer.surface_exists(&surface);
+    surface_observer->moved_to(&surface, {500, 10});
+    surface_observer->resized_to(&surface, {200, 50});
+}
+
+TEST_F(LegacySceneChangeNotificationTest, moving_a_surface_damages_where_its_streams_were_and_are)
+{
+    using namespace ::testing;
+    namespace geom = mir::geometry;
+
+    // A stream (e.g. of a subsurface) extending beyond the surface
+    auto const stream = std::dynamic_pointer_cast<mtd::MockBufferStream>(surface.primary_buffer_stream());
+    ASSERT_THAT(stream, NotNull());
+    ON_CALL(*stream, stream_size()).WillByDefault(Return(geom::Size{300, 200}));
+
+    std::shared_ptr<ms::SurfaceObserver> surface_observer;
+    ON_CALL(surface, size()).WillByDefault(Return(geom::Size{100, 50}));
+    EXPECT_CALL(surface, add_observer(_)).Times(1)
+        .WillOnce(SaveArg<0>(&surface_observer));
+
+    EXPECT_CALL(damage_callback, invoke(1, geom::Rectangle{{0, 0}, {300, 200}}));
+    EXPECT_CALL(damage_callback, invoke(1, geom::Rectangle{{500, 10}, {300, 200}}));
+
+    ms::LegacySceneChangeNotification observer(scene_change_callback, damage_change_callback);
+    observer.surface_exists(&surface);
+    surface.move_to({500, 10});
+    surface_observer->moved_to(&surface, {500, 10});
+}
+
+TEST_F(LegacySceneChangeNotificationTest, moving_an_invisible_surface_damages_nothing)
+{
+    using namespace ::testing;
+
+    std::shared_ptr<ms::SurfaceObserver> surface_observer;
+    ON_CALL(surface, visible()).WillByDefault(Return(false));
+    EXPECT_CALL(surface, add_observer(_)).Times(1)
+        .WillOnce(SaveArg<0>(&surface_observer));
+
+    EXPECT_CALL(scene_callback, invoke()).Times(0);
+    EXPECT_CALL(damage_callback, invoke(_, _)).Times(0);
+
+    ms::LegacySceneChangeNotification observer(scene_change_callback, damage_change_callback);
+    observer.surface_exists(&surface);
+    surface_observer->moved_to(&surface, {500, 10});
+}
+
 TEST_F(LegacySceneChangeNotificationTest, destroying_observer_unregisters_surface_observers)
 {
     using namespace ::testing;
@@ -0,0 +1,148 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 or 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/scene/surface_stack.h"
+#include "src/server/scene/basic_surface.h"
+#include "src/server/report/null_report_factory.h"
+#include "mir/compositor/scene_element.h"
+#include "mir/test/doubles/stub_buffer_stream.h"
+#include "mir/test/doubles/stub_renderable.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <new>
+
+namespace mc = mir::compositor;
+namespace mg = mir::graphics;
+namespace ms = mir::scene;
+namespace geom = mir::geometry;
+namespace mtd = mir::test::doubles;
+namespace mr = mir::report;
+
+using namespace testing;
+
+namespace
+{
+thread_local bool counting_allocations{false};
+thread_local int allocations{0};
+}
+
+// Interposed for the whole test binary (which is why this test has a binary
+// to itself), but only counts when asked to
+void* operator new(std::size_t size)
+{
+    if (counting_allocations)
+        ++allocations;
+
+    if (auto const block = std::malloc(size ? size : 1))
+        return block;
+
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* block) noexcept
+{
+    std::free(block);
+}
+
+void operator delete(void* block, std::size_t) noexcept
+{
+    std::free(block);
+}
+
+namespace
+{
+template<typename F>
+int allocations_during(F f)
+{
+    allocations = 0;
+    counting_allocations = true;
+    f();
+    counting_allocations = false;
+    return allocations;
+}
+
+struct SceneElementAllocation : Test
+{
+    void SetUp() override
+    {
+        for (auto i = 0; i != 3; ++i)
+        {
+            // Streams of a surface with opaque regions of different lengths, so
+            // that their renderables need differently sized storage each frame
+            std::list<ms::StreamInfo> streams;
+            for (auto j = 0; j != i + 1; ++j)
+            {
+                std::vector<geom::Rectangle> opaque_region;
+                for (auto k = 0; k != 2 * j; ++k)
+                    opaque_region.push_back({{10 * k, 0}, {10, 10}});
+
+                streams.push_back({std::make_shared<mtd::StubBufferStream>(), {}, {}, opaque_region});
+            }
+
+            auto const surface = std::make_shared<ms::BasicSurface>(
+                std::string("surface with a name too long for short string optimisation"),
+                geom::Rectangle{{10 * i, 10 * i}, {100, 100}},
+                mir_pointer_unconfined,
+                streams,
+                std::shared_ptr<mg::CursorImage>(),
+                report);
+            stack.add_surface(surface, mir::input::InputReceptionMode::normal);
+        }
+
+        stack.add_input_visualization(std::make_shared<mtd::StubRenderable>());
+        stack.register_compositor(compositor_id);
+    }
+
+    void TearDown() override
+    {
+        stack.unregister_compositor(compositor_id);
+    }
+
+    std::shared_ptr<ms::SceneReport> const report = mr::null_scene_report();
+    ms::SurfaceStack stack{report};
+    int const compositor{0};
+    mc::CompositorID const compositor_id{&compositor};
+};
+}
+
+// Only covers gathering the scene: the renderer still allocates each frame
+TEST_F(SceneElementAllocation, scene_elements_for_allocates_only_the_returned_sequence)
+{
+    for (auto i = 0; i != 3; ++i)
+        stack.scene_elements_for(compositor_id);
+
+    auto const frame_allocations = allocations_during(
+        [this] { stack.scene_elements_for(compositor_id); });
+
+    EXPECT_THAT(frame_allocations, Eq(1));
+}
+
+TEST_F(SceneElementAllocation, elements_still_held_are_not_recycled)
+{
+    auto const first = stack.scene_elements_for(compositor_id);
+    auto const second = stack.scene_elements_for(compositor_id);
+
+    ASSERT_THAT(second.size(), Eq(first.size()));
+    for (auto i = 0u; i != first.size(); ++i)
+    {
+        EXPECT_THAT(second[i], Ne(first[i]));
+        EXPECT_THAT(second[i]->renderable()->id(), Eq(first[i]->renderable()->id()));
+        EXPECT_THAT(second[i]->renderable()->screen_position(), Eq(first[i]->renderable()->screen_position()));
+    }
+}
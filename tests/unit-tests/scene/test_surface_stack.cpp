@@ -330,6 +330,33 @@ TEST_F(SurfaceStack, scene_doesnt_count_pending_frames_from_partially_exposed_su
     EXPECT_EQ(0, stack.frames_pending(comp2));
 }
 
+TEST_F(SurfaceStack, scene_change_is_pending_for_each_compositor_until_it_composites)
+{
+    ms::SurfaceStack stack{report};
+    auto const comp1 = reinterpret_cast<mc::CompositorID>(0);
+    auto const comp2 = reinterpret_cast<mc::CompositorID>(1);
+
+    stack.register_compositor(comp1);
+    stack.register_compositor(comp2);
+
+    EXPECT_EQ(0, stack.frames_pending(comp1));
+    EXPECT_EQ(0, stack.frames_pending(comp2));
+
+    stack.emit_scene_changed();
+
+    EXPECT_EQ(1, stack.frames_pending(comp1));
+    EXPECT_EQ(1, stack.frames_pending(comp2));
+
+    stack.scene_elements_for(comp1);
+
+    EXPECT_EQ(0, stack.frames_pending(comp1));
+    EXPECT_EQ(1, stack.frames_pending(comp2));
+
+    stack.scene_elements_for(comp2);
+
+    EXPECT_EQ(0, stack.frames_pending(comp2));
+}
+
 TEST_F(SurfaceStack, surfaces_are_emitted_by_layer)
 {
     using namespace testing;
@@ -1027,3 +1054,22 @@ TEST_F(SurfaceStack, raise_surfaces_to_top)
             SceneElementForStream(stub_buffer_stream2),
             SceneElementForStream(stub_buffer_stream3)));
 }
+
+TEST_F(SurfaceStack, surfaces_can_be_removed_while_iterating_over_them)
+{
+    using namespace testing;
+
+    stack.add_surface(stub_surface1, default_params.input_mode);
+    stack.add_surface(stub_surface2, default_params.input_mode);
+    stack.add_surface(stub_surface3, default_params.input_mode);
+
+    std::vector<mi::Surface*> seen;
+    stack.for_each([&](std::shared_ptr<mi::Surface> const& surface)
+        {
+            seen.push_back(surface.get());
+            stack.remove_surface(std::dynamic_pointer_cast<ms::Surface>(surface));
+        });
+
+    EXPECT_THAT(seen, ElementsAre(stub_surface1.get(), stub_surface2.get(), stub_surface3.get()));
+    EXPECT_THAT(stack.scene_elements_for(compositor_id), IsEmpty());
+}
@@ -0,0 +1,269 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/frontend_wayland/wlshmbuffer.h"
+#include "src/server/frontend_wayland/wayland_executor.h"
+
+#include "mir/fd.h"
+#include "mir/renderer/gl/sub_texture_source.h"
+#include "mir/renderer/sw/pixel_source.h"
+#include "mir/test/doubles/mock_gl.h"
+
+#include <wayland-client.h>
+#include <wayland-server.h>
+
+#include <GLES2/gl2ext.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+#include <linux/memfd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// As in wlshmbuffer.cpp: older libwayland can't let us read the client's pool in place
+#if (WAYLAND_VERSION_MAJOR == 1) && (WAYLAND_VERSION_MINOR < 16)
+#define MIR_COPY_WL_SHM_BUFFERS
+#endif
+
+namespace mf = mir::frontend;
+namespace mg = mir::graphics;
+namespace mrs = mir::renderer::software;
+namespace mrgl = mir::renderer::gl;
+namespace mtd = mir::test::doubles;
+
+using namespace testing;
+
+namespace
+{
+char const* const pool_name = "wlshmbuffer-test";
+
+/// Whether the server has the client's pool mapped
+bool pool_is_mapped()
+{
+    std::ifstream maps{"/proc/self/maps"};
+    std::string line;
+    while (std::getline(maps, line))
+    {
+        if (line.find(pool_name) != std::string::npos)
+            return true;
+    }
+    return false;
+}
+
+/// A server and a client connected to it over a socketpair, both dispatched from the test's thread
+class WlShmBufferTest : public Test
+{
+public:
+    WlShmBufferTest()
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0)
+            throw std::system_error{errno, std::system_category(), "Failed to create socketpair"};
+
+        wl_display_init_shm(server_display);
+        server_client = wl_client_create(server_display, fds[0]);
+        client_display = wl_display_connect_to_fd(fds[1]);
+
+        static wl_registry_listener const registry_listener{
+            [](void* data, wl_registry* registry, uint32_t name, char const* interface, uint32_t)
+            {
+                if (std::string{interface} == wl_shm_interface.name)
+                {
+                    static_cast<WlShmBufferTest*>(data)->shm = static_cast<wl_shm*>(
+                        wl_registry_bind(registry, name, &wl_shm_interface, 1));
+                }
+            },
+            [](void*, wl_registry*, uint32_t) {}};
+
+        auto const registry = wl_display_get_registry(client_display);
+        wl_registry_add_listener(registry, &registry_listener, this);
+        roundtrip();
+        wl_registry_destroy(registry);
+    }
+
+    ~WlShmBufferTest()
+    {
+        if (client_buffer)
+            wl_buffer_destroy(client_buffer);
+        if (client_pool)
+            wl_shm_pool_destroy(client_pool);
+        if (shm)
+            wl_shm_destroy(shm);
+        wl_display_disconnect(client_display);
+
+        executor.reset();
+        wl_display_destroy(server_display);
+    }
+
+    void roundtrip()
+    {
+        static wl_callback_listener const done_listener{
+            [](void* data, wl_callback*, uint32_t) { *static_cast<bool*>(data) = true; }};
+
+        bool done{false};
+        auto const callback = wl_display_sync(client_display);
+        wl_callback_add_listener(callback, &done_listener, &done);
+
+        while (!done)
+        {
+            wl_display_flush(client_display);
+            dispatch_server();
+            wl_display_flush_clients(server_display);
+            wl_display_dispatch(client_display);
+        }
+
+        wl_callback_destroy(callback);
+    }
+
+    void dispatch_server()
+    {
+        wl_event_loop_dispatch(server_loop, 0);
+        wl_event_loop_dispatch_idle(server_loop);
+    }
+
+    /// Creates a client buffer in a pool of its own, returning the server's resource for it
+    wl_resource* create_buffer(int width, int height, int stride)
+    {
+        auto const pool_size = stride * height;
+        pool_fd = mir::Fd{static_cast<int>(syscall(SYS_memfd_create, pool_name, MFD_CLOEXEC))};
+        if (pool_fd < 0 || ftruncate(pool_fd, pool_size) < 0)
+            throw std::system_error{errno, std::system_category(), "Failed to create pool"};
+
+        client_pool = wl_shm_create_pool(shm, pool_fd, pool_size);
+        client_buffer = wl_shm_pool_create_buffer(client_pool, 0, width, height, stride, WL_SHM_FORMAT_ARGB8888);
+        roundtrip();
+
+        return wl_client_get_object(server_client, wl_proxy_get_id(reinterpret_cast<wl_proxy*>(client_buffer)));
+    }
+
+    std::shared_ptr<mg::Buffer> mir_buffer_for(wl_resource* resource)
+    {
+        return mf::WlShmBuffer::mir_buffer_from_wl_buffer(resource, executor, {}, {}, []{});
+    }
+
+    /// Matches a pointer to the given offset into the client's pixels, if we read them in place
+    static Matcher<GLvoid const*> client_pixels_at(wl_resource* resource, int offset)
+    {
+#ifdef MIR_COPY_WL_SHM_BUFFERS
+        (void)resource; (void)offset;
+        return _;
+#else
+        auto const pixels = static_cast<uint8_t const*>(wl_shm_buffer_get_data(wl_shm_buffer_get(resource)));
+        return Eq(static_cast<GLvoid const*>(pixels + offset));
+#endif
+    }
+
+    wl_display* const server_display{wl_display_create()};
+    wl_event_loop* const server_loop{wl_display_get_event_loop(server_display)};
+    std::shared_ptr<mf::WaylandExecutor> executor{std::make_shared<mf::WaylandExecutor>(server_loop)};
+    wl_client* server_client{nullptr};
+
+    wl_display* client_display{nullptr};
+    wl_shm* shm{nullptr};
+    mir::Fd pool_fd;
+    wl_shm_pool* client_pool{nullptr};
+    wl_buffer* client_buffer{nullptr};
+};
+}
+
+#ifndef MIR_COPY_WL_SHM_BUFFERS
+TEST_F(WlShmBufferTest, reads_the_client_pool_in_place)
+{
+    auto const mir_buffer = mir_buffer_for(create_buffer(4, 4, 16));
+
+    // Drawn by the "client" after the buffer was attached
+    uint32_t const pixel{0x11223344};
+    ASSERT_THAT(pwrite(pool_fd, &pixel, sizeof pixel, 0), Eq(static_cast<ssize_t>(sizeof pixel)));
+
+    uint32_t first_pixel{0};
+    dynamic_cast<mrs::PixelSource&>(*mir_buffer->native_buffer_base()).read(
+        [&](unsigned char const* pixels) { std::memcpy(&first_pixel, pixels, sizeof first_pixel); });
+
+    EXPECT_THAT(first_pixel, Eq(pixel));
+}
+
+TEST_F(WlShmBufferTest, keeps_the_pool_mapped_until_released_on_the_wayland_thread)
+{
+    auto mir_buffer = mir_buffer_for(create_buffer(4, 4, 16));
+
+    wl_buffer_destroy(client_buffer);
+    client_buffer = nullptr;
+    wl_shm_pool_destroy(client_pool);
+    client_pool = nullptr;
+    roundtrip();
+
+    EXPECT_TRUE(pool_is_mapped());
+
+    mir_buffer.reset();
+    EXPECT_TRUE(pool_is_mapped());
+
+    dispatch_server();
+    EXPECT_FALSE(pool_is_mapped());
+}
+#endif
+
+TEST_F(WlShmBufferTest, uploads_each_area_in_one_go_using_unpack_row_length)
+{
+    NiceMock<mtd::MockGL> mock_gl;
+    ON_CALL(mock_gl, glGetString(GL_EXTENSIONS))
+        .WillByDefault(Return(reinterpret_cast<GLubyte const*>("GL_EXT_unpack_subimage")));
+
+    int const width{100}, height{50}, stride{width * 4};
+    auto const resource = create_buffer(width, height, stride);
+    auto const mir_buffer = mir_buffer_for(resource);
+
+    {
+        InSequence seq;
+        EXPECT_CALL(mock_gl, glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, width));
+        EXPECT_CALL(mock_gl, glTexSubImage2D(GL_TEXTURE_2D, 0, 10, 20, 30, 5, _, _,
+                                             client_pixels_at(resource, 20 * stride + 10 * 4)));
+        EXPECT_CALL(mock_gl, glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 45, 100, 5, _, _,
+                                             client_pixels_at(resource, 45 * stride)));
+        EXPECT_CALL(mock_gl, glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, 0));
+    }
+
+    // The second area is clipped to the buffer
+    dynamic_cast<mrgl::SubTextureSource&>(*mir_buffer->native_buffer_base()).upload_areas(
+        {{{10, 20}, {30, 5}}, {{-10, 45}, {200, 10}}});
+}
+
+TEST_F(WlShmBufferTest, uploads_whole_rows_one_at_a_time_when_the_stride_is_not_a_whole_number_of_pixels)
+{
+    NiceMock<mtd::MockGL> mock_gl;
+
+    int const width{9}, height{4}, stride{42};
+    auto const resource = create_buffer(width, height, stride);
+    auto const mir_buffer = mir_buffer_for(resource);
+
+    EXPECT_CALL(mock_gl, glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, _)).Times(0);
+    {
+        InSequence seq;
+        EXPECT_CALL(mock_gl, glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 1, width, 1, _, _,
+                                             client_pixels_at(resource, 1 * stride)));
+        EXPECT_CALL(mock_gl, glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 2, width, 1, _, _,
+                                             client_pixels_at(resource, 2 * stride)));
+    }
+
+    dynamic_cast<mrgl::SubTextureSource&>(*mir_buffer->native_buffer_base()).upload_areas(
+        {{{2, 1}, {3, 2}}});
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/frontend_xwayland/xwayland_cursor_images.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <string>
+#include <vector>
+
+namespace mf = mir::frontend;
+using namespace testing;
+
+namespace
+{
+struct XWaylandCursorImages : Test
+{
+    /// A theme that has every cursor but "missing", recording what it was asked for
+    mf::XWaylandCursorImages::Load theme()
+    {
+        return [this](char const* name) -> XcursorImages*
+            {
+                loaded.push_back(name);
+                return std::string{name} == "missing" ? nullptr : XcursorImagesCreate(0);
+            };
+    }
+
+    std::vector<std::string> loaded;
+};
+}
+
+TEST_F(XWaylandCursorImages, reads_each_cursor_from_the_theme_once)
+{
+    mf::XWaylandCursorImages images{theme()};
+
+    auto const first = images.get("left_ptr");
+    ASSERT_THAT(first, NotNull());
+
+    // As when a restarted X server asks for its cursors again
+    EXPECT_THAT(images.get("left_ptr"), Eq(first));
+    EXPECT_THAT(images.get("top_side"), AllOf(NotNull(), Ne(first)));
+    EXPECT_THAT(images.get("top_side"), NotNull());
+
+    EXPECT_THAT(loaded, ElementsAre("left_ptr", "top_side"));
+}
+
+TEST_F(XWaylandCursorImages, remembers_cursors_the_theme_lacks)
+{
+    mf::XWaylandCursorImages images{theme()};
+
+    EXPECT_THAT(images.get("missing"), IsNull());
+    EXPECT_THAT(images.get("missing"), IsNull());
+
+    EXPECT_THAT(loaded, ElementsAre("missing"));
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/frontend_xwayland/xwayland_pending_replies.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <set>
+#include <vector>
+
+namespace mf = mir::frontend;
+using namespace testing;
+
+namespace
+{
+/// Stands in for an X server connection, answering only the requests it has been told to
+struct FakeConnection
+{
+    mf::XWaylandPendingReplies::Poll poll()
+    {
+        return [this](unsigned int sequence, void **)
+            {
+                polled.push_back(sequence);
+                return answered.count(sequence) != 0;
+            };
+    }
+
+    std::set<unsigned int> answered;
+    std::vector<unsigned int> polled;
+};
+
+struct XWaylandPendingReplies : Test
+{
+    mf::XWaylandPendingReplies::Handler record(unsigned int sequence)
+    {
+        return [this, sequence](void *) { handled.push_back(sequence); };
+    }
+
+    mf::XWaylandPendingReplies pending;
+    FakeConnection connection;
+    std::vector<unsigned int> handled;
+};
+}
+
+TEST_F(XWaylandPendingReplies, handles_replies_in_the_order_requested)
+{
+    pending.expect(1, record(1));
+    pending.expect(2, record(2));
+    pending.expect(3, record(3));
+    connection.answered = {1, 2, 3};
+
+    EXPECT_THAT(pending.handle_arrived(connection.poll()), Eq(3));
+    EXPECT_THAT(handled, ElementsAre(1, 2, 3));
+    EXPECT_TRUE(pending.empty());
+}
+
+TEST_F(XWaylandPendingReplies, stops_at_the_first_reply_still_outstanding)
+{
+    pending.expect(1, record(1));
+    pending.expect(2, record(2));
+    pending.expect(3, record(3));
+    connection.answered = {1, 3};
+
+    EXPECT_THAT(pending.handle_arrived(connection.poll()), Eq(1));
+    EXPECT_THAT(handled, ElementsAre(1));
+
+    connection.answered.insert(2);
+
+    EXPECT_THAT(pending.handle_arrived(connection.poll()), Eq(2));
+    EXPECT_THAT(handled, ElementsAre(1, 2, 3));
+}
+
+// Regression test: requests made before the X server went away used to stay at the head of the queue,
+// so nothing requested on the next connection was ever handled and its windows never mapped
+TEST_F(XWaylandPendingReplies, requests_on_a_lost_connection_do_not_hold_up_those_on_the_next)
+{
+    pending.expect(41, record(41));
+    pending.expect(42, record(42));
+
+    // The X server goes away and a new one is started
+    pending.clear();
+    FakeConnection next_connection;
+    next_connection.answered = {1};
+
+    pending.expect(1, record(1));
+
+    EXPECT_THAT(pending.handle_arrived(next_connection.poll()), Eq(1));
+    EXPECT_THAT(handled, ElementsAre(1));
+    EXPECT_THAT(next_connection.polled, Not(Contains(41u)));
+    EXPECT_TRUE(pending.empty());
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright © 2019 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 or 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "src/server/frontend_xwayland/xwayland_server.h"
+
+#include "mir/options/configuration.h"
+#include "mir/options/program_option.h"
+
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/value_semantic.hpp>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace mf = mir::frontend;
+namespace mo = mir::options;
+namespace bpo = boost::program_options;
+
+using namespace std::chrono;
+using namespace testing;
+
+TEST(XWaylandRetryDelay, starts_at_a_tenth_of_a_second)
+{
+    EXPECT_THAT(mf::xwayland_retry_delay(1), Eq(milliseconds{100}));
+}
+
+TEST(XWaylandRetryDelay, doubles_with_each_retry)
+{
+    for (auto retry = 2; retry != 10; ++retry)
+    {
+        EXPECT_THAT(mf::xwayland_retry_delay(retry), Eq(2 * mf::xwayland_retry_delay(retry - 1)))
+            << "retry " << retry;
+    }
+}
+
+TEST(XWaylandRetryDelay, stops_growing_at_a_minute)
+{
+    EXPECT_THAT(mf::xwayland_retry_delay(10), Eq(milliseconds{51200}));
+    EXPECT_THAT(mf::xwayland_retry_delay(11), Eq(minutes{1}));
+    EXPECT_THAT(mf::xwayland_retry_delay(12), Eq(minutes{1}));
+    EXPECT_THAT(mf::xwayland_retry_delay(1000), Eq(minutes{1}));
+}
+
+namespace
+{
+struct XWaylandPrespawnDelay : Test
+{
+    XWaylandPrespawnDelay()
+    {
+        desc.add_options()
+            (mo::x11_prespawn_delay_opt, bpo::value<int>(), "prespawn delay");
+    }
+
+    void parse(std::vector<char const*> args)
+    {
+        args.insert(args.begin(), __PRETTY_FUNCTION__);
+        options.parse_arguments(desc, args.size(), args.data());
+    }
+
+    bpo::options_description desc;
+    mo::ProgramOption options;
+};
+}
+
+TEST_F(XWaylandPrespawnDelay, is_disabled_unless_the_option_is_set)
+{
+    parse({});
+
+    EXPECT_THAT(mf::xwayland_prespawn_delay(options), Lt(milliseconds::zero()));
+}
+
+TEST_F(XWaylandPrespawnDelay, is_taken_from_the_option_in_milliseconds)
+{
+    parse({"--x11-prespawn-delay", "1500"});
+
+    EXPECT_THAT(mf::xwayland_prespawn_delay(options), Eq(milliseconds{1500}));
+}
+
+TEST_F(XWaylandPrespawnDelay, can_be_disabled_explicitly)
+{
+    parse({"--x11-prespawn-delay", "-1"});
+
+    EXPECT_THAT(mf::xwayland_prespawn_delay(options), Lt(milliseconds::zero()));
+}
+
+TEST(XWaylandPrespawnTimer, fires_once_after_the_delay)
+{
+    auto const spec = mf::xwayland_prespawn_timer(milliseconds{2500});
+
+    EXPECT_THAT(spec.it_value.tv_sec, Eq(2));
+    EXPECT_THAT(spec.it_value.tv_nsec, Eq(500000000));
+    EXPECT_THAT(spec.it_interval.tv_sec, Eq(0));
+    EXPECT_THAT(spec.it_interval.tv_nsec, Eq(0));
+}
+
+TEST(XWaylandPrespawnTimer, with_no_delay_still_fires)
+{
+    auto const spec = mf::xwayland_prespawn_timer(milliseconds::zero());
+
+    // A timerfd set to all zeros is disarmed instead
+    EXPECT_THAT(spec.it_value.tv_sec, Eq(0));
+    EXPECT_THAT(spec.it_value.tv_nsec, Gt(0));
+}